@@ -0,0 +1,433 @@
+#include "bench.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <algorithm>
+#include <utility>
+
+namespace mymuduo {
+
+namespace bench {
+
+namespace {
+
+struct ThreadArgs {
+  OpType op{nullptr};
+  int64_t iter_num{0};
+  int sample_every{0};  // 0 means nothing is sampled
+  pthread_barrier_t* barrier{nullptr};
+  std::vector<int64_t> samples;
+  int64_t begin_ns{0};
+  int64_t end_ns{0};
+};
+
+void* ThreadRoutine(void* args) {
+  auto* thread_args = static_cast<ThreadArgs*>(args);
+  OpType op = thread_args->op;
+  int64_t iter_num = thread_args->iter_num;
+  int sample_every = thread_args->sample_every;
+  auto& samples = thread_args->samples;
+
+  pthread_barrier_wait(thread_args->barrier);
+  thread_args->begin_ns = NowNanoseconds();
+  int countdown = 0;
+  for (int64_t i = 0; i < iter_num; ++i) {
+    if (sample_every && --countdown <= 0) {
+      countdown = sample_every;
+      int64_t begin = NowNanoseconds();
+      op(i);
+      samples.emplace_back(NowNanoseconds() - begin);
+    } else {
+      op(i);
+    }
+  }
+  thread_args->end_ns = NowNanoseconds();
+  return nullptr;
+}
+
+// Cost of the two clock reads around a sampled operation.
+double MeasureTimerOverhead() {
+  constexpr int kRounds = 1 << 12;
+  int64_t best = INT64_MAX;
+  for (int i = 0; i < kRounds; ++i) {
+    int64_t begin = NowNanoseconds();
+    best = std::min(best, NowNanoseconds() - begin);
+  }
+  return static_cast<double>(best);
+}
+
+Percentiles ComputePercentiles(std::vector<int64_t>* samples, double timer_overhead_ns) {
+  Percentiles percentiles;
+  if (samples->empty()) {
+    return percentiles;
+  }
+  std::sort(samples->begin(), samples->end());
+  auto at = [samples, timer_overhead_ns](double quantile) {
+    size_t index = static_cast<size_t>(quantile * (samples->size() - 1));
+    return std::max(0.0, (*samples)[index] - timer_overhead_ns);
+  };
+  percentiles.p50 = at(0.5);
+  percentiles.p99 = at(0.99);
+  percentiles.p999 = at(0.999);
+  percentiles.max = at(1.0);
+  return percentiles;
+}
+
+bool ParseIntList(const char* value, std::vector<int>* list) {
+  list->clear();
+  while (*value) {
+    char* end = nullptr;
+    long num = strtol(value, &end, 10);
+    if (end == value || num < 0) {
+      return false;
+    }
+    list->emplace_back(static_cast<int>(num));
+    value = *end == ',' ? end + 1 : end;
+    if (*end && *end != ',') {
+      return false;
+    }
+  }
+  return !list->empty();
+}
+
+bool ParseInt64(const char* value, int64_t* num) {
+  char* end = nullptr;
+  long long parsed = strtoll(value, &end, 10);
+  if (end == value || *end || parsed < 0) {
+    return false;
+  }
+  *num = parsed;
+  return true;
+}
+
+bool ParseInt(const char* value, int* num) {
+  int64_t parsed = 0;
+  if (!ParseInt64(value, &parsed)) {
+    return false;
+  }
+  *num = static_cast<int>(parsed);
+  return true;
+}
+
+bool HasCounters(const std::vector<Result>& results) {
+  for (const auto& result : results) {
+    if (result.has_counters) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void PrintText(FILE* out, const std::vector<Result>& results) {
+  fprintf(out, "%-24s %7s %7s %10s %12s %9s %9s %9s %12s %12s\n",
+          "name", "readers", "writers", "ms", "reads/s",
+          "r_p50_ns", "r_p99_ns", "r_p999_ns", "w_p50_ns", "w_p99_ns");
+  for (const auto& result : results) {
+    fprintf(out, "%-24s %7d %7d %10.1f %12.0f %9.1f %9.1f %9.1f %12.0f %12.0f\n",
+            result.name.c_str(), result.reader_num, result.writer_num, result.elapsed_ms,
+            result.read_ops_per_sec, result.read_ns.p50, result.read_ns.p99, result.read_ns.p999,
+            result.write_ns.p50, result.write_ns.p99);
+  }
+
+  if (!HasCounters(results)) {
+    return;
+  }
+  fprintf(out, "\nper operation counters\n%-24s %7s %7s", "name", "readers", "writers");
+  for (int i = 0; i < kCounterNum; ++i) {
+    fprintf(out, " %16s", CounterName(i));
+  }
+  fprintf(out, "\n");
+  for (const auto& result : results) {
+    fprintf(out, "%-24s %7d %7d", result.name.c_str(), result.reader_num, result.writer_num);
+    for (int i = 0; i < kCounterNum; ++i) {
+      if (result.counters_per_op.valid[i]) {
+        fprintf(out, " %16.6g", result.counters_per_op.value[i]);
+      } else {
+        fprintf(out, " %16s", "-");
+      }
+    }
+    fprintf(out, "\n");
+  }
+}
+
+void PrintCsv(FILE* out, const std::vector<Result>& results) {
+  fprintf(out, "name,readers,writers,read_ops,write_ops,elapsed_ms,read_ops_per_sec,"
+               "read_p50_ns,read_p99_ns,read_p999_ns,read_max_ns,"
+               "write_p50_ns,write_p99_ns,write_p999_ns,write_max_ns");
+  bool has_counters = HasCounters(results);
+  if (has_counters) {
+    for (int i = 0; i < kCounterNum; ++i) {
+      fprintf(out, ",%s_per_op", CounterName(i));
+    }
+  }
+  fprintf(out, "\n");
+  for (const auto& result : results) {
+    fprintf(out, "%s,%d,%d,%lld,%lld,%.3f,%.0f,%.1f,%.1f,%.1f,%.1f,%.1f,%.1f,%.1f,%.1f",
+            result.name.c_str(), result.reader_num, result.writer_num,
+            static_cast<long long>(result.read_ops), static_cast<long long>(result.write_ops),
+            result.elapsed_ms, result.read_ops_per_sec,
+            result.read_ns.p50, result.read_ns.p99, result.read_ns.p999, result.read_ns.max,
+            result.write_ns.p50, result.write_ns.p99, result.write_ns.p999, result.write_ns.max);
+    if (has_counters) {
+      for (int i = 0; i < kCounterNum; ++i) {
+        if (result.counters_per_op.valid[i]) {
+          fprintf(out, ",%.6g", result.counters_per_op.value[i]);
+        } else {
+          fprintf(out, ",");
+        }
+      }
+    }
+    fprintf(out, "\n");
+  }
+}
+
+void PrintPercentilesJson(FILE* out, const Percentiles& percentiles) {
+  fprintf(out, "{\"p50\": %.1f, \"p99\": %.1f, \"p999\": %.1f, \"max\": %.1f}",
+          percentiles.p50, percentiles.p99, percentiles.p999, percentiles.max);
+}
+
+void PrintJson(FILE* out, const std::vector<Result>& results) {
+  fprintf(out, "[\n");
+  for (size_t i = 0; i < results.size(); ++i) {
+    const auto& result = results[i];
+    fprintf(out, "  {\"name\": \"%s\", \"readers\": %d, \"writers\": %d, "
+                 "\"read_ops\": %lld, \"write_ops\": %lld, \"elapsed_ms\": %.3f, "
+                 "\"read_ops_per_sec\": %.0f, \"read_ns\": ",
+            result.name.c_str(), result.reader_num, result.writer_num,
+            static_cast<long long>(result.read_ops), static_cast<long long>(result.write_ops),
+            result.elapsed_ms, result.read_ops_per_sec);
+    PrintPercentilesJson(out, result.read_ns);
+    fprintf(out, ", \"write_ns\": ");
+    PrintPercentilesJson(out, result.write_ns);
+    if (result.has_counters) {
+      fprintf(out, ", \"counters_per_op\": {");
+      for (int j = 0; j < kCounterNum; ++j) {
+        fprintf(out, "%s\"%s\": ", j ? ", " : "", CounterName(j));
+        if (result.counters_per_op.valid[j]) {
+          fprintf(out, "%.6g", result.counters_per_op.value[j]);
+        } else {
+          fprintf(out, "null");
+        }
+      }
+      fprintf(out, "}");
+    }
+    fprintf(out, "}%s\n", i + 1 == results.size() ? "" : ",");
+  }
+  fprintf(out, "]\n");
+}
+
+}  // namespace
+
+int64_t NowNanoseconds() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+Workload MakeWorkload(std::string name, OpType read_op, int64_t read_iter_num,
+                      OpType write_op, int64_t write_iter_num) {
+  Workload workload;
+  workload.name = std::move(name);
+  workload.read_op = read_op;
+  workload.write_op = write_op;
+  workload.read_iter_num = read_iter_num;
+  workload.write_iter_num = write_iter_num;
+  return workload;
+}
+
+bool ParseOptions(int argc, char* argv[], Options* options) {
+  for (int i = 1; i < argc; ++i) {
+    const char* arg = argv[i];
+    const char* value = strchr(arg, '=');
+    if (strncmp(arg, "--", 2) != 0 || !value) {
+      return false;
+    }
+    std::string key(arg + 2, value - arg - 2);
+    ++value;
+
+    bool ok = true;
+    if (key == "readers") {
+      ok = ParseIntList(value, &options->reader_nums);
+    } else if (key == "writers") {
+      ok = ParseIntList(value, &options->writer_nums);
+    } else if (key == "warmup") {
+      ok = ParseInt(value, &options->warmup);
+    } else if (key == "repeats") {
+      ok = ParseInt(value, &options->repeats) && options->repeats > 0;
+    } else if (key == "sample-every") {
+      ok = ParseInt(value, &options->sample_every);
+    } else if (key == "read-iters") {
+      ok = ParseInt64(value, &options->read_iter_num);
+    } else if (key == "write-iters") {
+      ok = ParseInt64(value, &options->write_iter_num);
+    } else if (key == "filter") {
+      options->filter = value;
+    } else if (key == "format") {
+      options->format = value;
+      ok = options->format == "text" || options->format == "json" || options->format == "csv";
+    } else if (key == "perf-counters") {
+      int enabled = 0;
+      ok = ParseInt(value, &enabled);
+      options->perf_counters = enabled != 0;
+    } else {
+      ok = false;
+    }
+    if (!ok) {
+      return false;
+    }
+  }
+  return true;
+}
+
+Harness::Harness(const Options& options)
+    : options_(options), timer_overhead_ns_(MeasureTimerOverhead()) {
+  if (options_.perf_counters) {
+    PerfCounters perf_counters;
+    if (!perf_counters.Open()) {
+      fprintf(stderr, "perf_event_open is not permitted, counters disabled\n");
+      options_.perf_counters = false;
+    } else if (!perf_counters.HasHardwareCounters()) {
+      fprintf(stderr, "no hardware PMU, reporting software counters only\n");
+    }
+  }
+}
+
+void Harness::Run(const Workload& workload) {
+  if (!options_.filter.empty() && workload.name.find(options_.filter) == std::string::npos) {
+    return;
+  }
+  // A workload without a read or write op runs none of those threads, so
+  // several configurations of the sweep may come down to the same one.
+  std::vector<std::pair<int, int>> configs;
+  for (int writer_num : options_.writer_nums) {
+    for (int reader_num : options_.reader_nums) {
+      const std::pair<int, int> config(workload.read_op ? reader_num : 0,
+                                       workload.write_op ? writer_num : 0);
+      if (config.first + config.second == 0 ||
+          std::find(configs.begin(), configs.end(), config) != configs.end()) {
+        continue;
+      }
+      configs.push_back(config);
+      results_.emplace_back(RunConfig(workload, config.first, config.second));
+      // progress goes to stderr, stdout stays machine readable
+      const auto& result = results_.back();
+      fprintf(stderr, "%s readers=%d writers=%d elapsed(ms)=%.1f\n",
+              result.name.c_str(), config.first, config.second, result.elapsed_ms);
+    }
+  }
+}
+
+Result Harness::RunConfig(const Workload& workload, int reader_num, int writer_num) {
+  int64_t read_iter_num =
+      options_.read_iter_num > 0 ? options_.read_iter_num : workload.read_iter_num;
+  int64_t write_iter_num =
+      options_.write_iter_num > 0 ? options_.write_iter_num : workload.write_iter_num;
+
+  std::vector<int64_t> read_samples;
+  std::vector<int64_t> write_samples;
+  std::vector<double> elapsed_ms;
+  PerfCounters perf_counters;
+  CounterValues counter_sums;
+  bool has_counters = false;
+
+  for (int run = 0; run < options_.warmup + options_.repeats; ++run) {
+    bool measured = run >= options_.warmup;
+    int thread_num = reader_num + writer_num;
+    std::vector<ThreadArgs> thread_args(thread_num);
+    std::vector<pthread_t> tids(thread_num);
+    pthread_barrier_t barrier;
+    pthread_barrier_init(&barrier, nullptr, thread_num + 1);
+
+    // opened before the threads exist so that they inherit the counters
+    bool counting = measured && options_.perf_counters && perf_counters.Open();
+    if (counting) {
+      perf_counters.Start();
+    }
+
+    for (int i = 0; i < thread_num; ++i) {
+      auto& args = thread_args[i];
+      bool reader = i < reader_num;
+      args.op = reader ? workload.read_op : workload.write_op;
+      args.iter_num = reader ? read_iter_num : write_iter_num;
+      args.sample_every = reader ? options_.sample_every : 1;
+      args.barrier = &barrier;
+      if (args.sample_every > 0) {
+        args.samples.reserve(args.iter_num / args.sample_every + 1);
+      }
+      if (pthread_create(&tids[i], nullptr, ThreadRoutine, &args)) {
+        exit(EXIT_FAILURE);
+      }
+    }
+
+    // the run spans from the first thread released to the last one done
+    pthread_barrier_wait(&barrier);
+    int64_t begin = INT64_MAX;
+    int64_t end = 0;
+    for (int i = 0; i < thread_num; ++i) {
+      pthread_join(tids[i], nullptr);
+      begin = std::min(begin, thread_args[i].begin_ns);
+      end = std::max(end, thread_args[i].end_ns);
+    }
+    pthread_barrier_destroy(&barrier);
+
+    if (counting) {
+      CounterValues values;
+      perf_counters.Stop(&values);
+      for (int i = 0; i < kCounterNum; ++i) {
+        counter_sums.value[i] += values.value[i];
+        counter_sums.valid[i] = values.valid[i] && (!has_counters || counter_sums.valid[i]);
+      }
+      has_counters = true;
+    }
+
+    if (!measured) {
+      continue;
+    }
+    elapsed_ms.emplace_back((end - begin) / 1e6);
+    for (int i = 0; i < thread_num; ++i) {
+      auto& samples = i < reader_num ? read_samples : write_samples;
+      samples.insert(samples.end(), thread_args[i].samples.begin(), thread_args[i].samples.end());
+    }
+  }
+
+  Result result;
+  result.name = workload.name;
+  result.reader_num = reader_num;
+  result.writer_num = writer_num;
+  result.read_ops = read_iter_num * reader_num;
+  result.write_ops = write_iter_num * writer_num;
+  std::sort(elapsed_ms.begin(), elapsed_ms.end());
+  result.elapsed_ms = elapsed_ms[elapsed_ms.size() / 2];
+  if (result.elapsed_ms > 0) {
+    result.read_ops_per_sec = result.read_ops / (result.elapsed_ms / 1e3);
+  }
+  result.read_ns = ComputePercentiles(&read_samples, timer_overhead_ns_);
+  result.write_ns = ComputePercentiles(&write_samples, timer_overhead_ns_);
+
+  int64_t total_ops = (result.read_ops + result.write_ops) * options_.repeats;
+  if (has_counters && total_ops > 0) {
+    result.has_counters = true;
+    for (int i = 0; i < kCounterNum; ++i) {
+      result.counters_per_op.valid[i] = counter_sums.valid[i];
+      result.counters_per_op.value[i] = counter_sums.value[i] / total_ops;
+    }
+  }
+  return result;
+}
+
+void Harness::Report(FILE* out) const {
+  if (options_.format == "json") {
+    PrintJson(out, results_);
+  } else if (options_.format == "csv") {
+    PrintCsv(out, results_);
+  } else {
+    PrintText(out, results_);
+  }
+}
+
+}  // namespace bench
+
+}  // namespace mymuduo
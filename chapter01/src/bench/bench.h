@@ -0,0 +1,106 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <string>
+#include <vector>
+
+#include "perf_counters.h"
+
+namespace mymuduo {
+
+namespace bench {
+
+// One operation of a workload, i is the per-thread iteration index.
+using OpType = void (*)(int64_t i);
+
+struct Workload {
+  std::string name;
+  OpType read_op{nullptr};
+  OpType write_op{nullptr};
+  int64_t read_iter_num{0};   // per reader thread
+  int64_t write_iter_num{0};  // per writer thread
+};
+
+// A workload without write_op only runs readers.
+Workload MakeWorkload(std::string name, OpType read_op, int64_t read_iter_num,
+                      OpType write_op = nullptr, int64_t write_iter_num = 0);
+
+struct Options {
+  std::vector<int> reader_nums{1, 2, 4, 8};
+  std::vector<int> writer_nums{1};
+  int warmup{1};               // runs thrown away before measuring
+  int repeats{3};              // measured runs per configuration
+  int sample_every{64};        // time one read out of sample_every
+  int64_t read_iter_num{0};    // overrides Workload::read_iter_num if > 0
+  int64_t write_iter_num{0};   // overrides Workload::write_iter_num if > 0
+  std::string filter;          // only run workloads whose name contains it
+  std::string format{"text"};  // text, json or csv
+  bool perf_counters{false};   // count perf events around each measured run
+};
+
+// Parses --readers=1,2,4 --writers=0,1 --warmup=N --repeats=N --sample-every=N
+// --read-iters=N --write-iters=N --filter=str --format=text|json|csv
+// --perf-counters=0|1.
+// Returns false on an unknown or malformed flag.
+bool ParseOptions(int argc, char* argv[], Options* options);
+
+struct Percentiles {
+  double p50{0};
+  double p99{0};
+  double p999{0};
+  double max{0};
+};
+
+struct Result {
+  std::string name;
+  int reader_num{0};
+  int writer_num{0};
+  int64_t read_ops{0};       // per measured run, all readers
+  int64_t write_ops{0};      // per measured run, all writers
+  double elapsed_ms{0};      // median over repeats
+  double read_ops_per_sec{0};
+  Percentiles read_ns;       // per-operation latency, sampled
+  Percentiles write_ns;      // per-operation latency, every write
+  bool has_counters{false};
+  CounterValues counters_per_op;  // over reads and writes together
+};
+
+// Runs workloads across the reader/writer sweep of its options.
+// Every configuration starts all threads at once from a barrier, runs
+// warmup + repeats times and keeps the latency samples of the measured runs.
+class Harness {
+ public:
+  explicit Harness(const Options& options);
+
+  Harness(const Harness&) = delete;
+  Harness& operator=(const Harness&) = delete;
+
+  void Run(const Workload& workload);
+
+  // Prints every result so far in options.format.
+  void Report(FILE* out) const;
+
+  const std::vector<Result>& results() const { return results_; }
+
+ private:
+  Result RunConfig(const Workload& workload, int reader_num, int writer_num);
+
+ private:
+  Options options_;
+  double timer_overhead_ns_;
+  std::vector<Result> results_;
+};
+
+// Keeps the compiler from dropping a read whose result is unused.
+template<typename T>
+inline void DoNotOptimize(const T& value) {
+  asm volatile("" : : "r,m"(value) : "memory");
+}
+
+int64_t NowNanoseconds();
+
+}  // namespace bench
+
+}  // namespace mymuduo
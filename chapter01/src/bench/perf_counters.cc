@@ -0,0 +1,118 @@
+#include "perf_counters.h"
+
+#include <linux/perf_event.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace mymuduo {
+
+namespace bench {
+
+namespace {
+
+struct CounterConfig {
+  const char* name;
+  uint32_t type;
+  uint64_t config;
+};
+
+const CounterConfig kCounterConfigs[kCounterNum] = {
+  {"cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+  {"instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+  {"cache_misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+  {"task_clock_ns", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK},
+  {"context_switches", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES},
+  {"cpu_migrations", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CPU_MIGRATIONS},
+  {"page_faults", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS},
+};
+
+int PerfEventOpen(const CounterConfig& counter_config, bool exclude_kernel) {
+  struct perf_event_attr attr;
+  memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = counter_config.type;
+  attr.config = counter_config.config;
+  attr.disabled = 1;
+  attr.inherit = 1;  // follow the threads created afterwards
+  attr.exclude_kernel = exclude_kernel;
+  attr.exclude_hv = 1;
+  attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+  return static_cast<int>(::syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+}
+
+}  // namespace
+
+const char* CounterName(int id) {
+  return kCounterConfigs[id].name;
+}
+
+PerfCounters::PerfCounters() {
+  for (auto&& fd : fds_) {
+    fd = -1;
+  }
+}
+
+PerfCounters::~PerfCounters() {
+  Close();
+}
+
+bool PerfCounters::Open() {
+  Close();
+  bool opened = false;
+  for (int i = 0; i < kCounterNum; ++i) {
+    // Kernel side events (switches, faults) need exclude_kernel off; an
+    // unprivileged process may only get the user space part.
+    fds_[i] = PerfEventOpen(kCounterConfigs[i], false);
+    if (fds_[i] < 0) {
+      fds_[i] = PerfEventOpen(kCounterConfigs[i], true);
+    }
+    opened = opened || fds_[i] >= 0;
+  }
+  return opened;
+}
+
+void PerfCounters::Start() {
+  for (auto fd : fds_) {
+    if (fd >= 0) {
+      ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+      ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+  }
+}
+
+void PerfCounters::Stop(CounterValues* values) {
+  for (int i = 0; i < kCounterNum; ++i) {
+    values->valid[i] = false;
+    if (fds_[i] < 0) {
+      continue;
+    }
+    ioctl(fds_[i], PERF_EVENT_IOC_DISABLE, 0);
+
+    uint64_t data[3];  // value, time enabled, time running
+    if (read(fds_[i], data, sizeof(data)) != sizeof(data) || data[2] == 0) {
+      continue;
+    }
+    values->value[i] = static_cast<double>(data[0]) * data[1] / data[2];
+    values->valid[i] = true;
+  }
+}
+
+bool PerfCounters::HasHardwareCounters() const {
+  return fds_[kCycles] >= 0;
+}
+
+void PerfCounters::Close() {
+  for (auto&& fd : fds_) {
+    if (fd >= 0) {
+      close(fd);
+      fd = -1;
+    }
+  }
+}
+
+}  // namespace bench
+
+}  // namespace mymuduo
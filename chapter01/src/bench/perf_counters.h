@@ -0,0 +1,56 @@
+#pragma once
+
+namespace mymuduo {
+
+namespace bench {
+
+enum CounterId {
+  kCycles,
+  kInstructions,
+  kCacheMisses,
+  kTaskClock,        // software, ns on cpu; stands in for cycles without a PMU
+  kContextSwitches,
+  kCpuMigrations,
+  kPageFaults,
+  kCounterNum,
+};
+
+const char* CounterName(int id);
+
+struct CounterValues {
+  double value[kCounterNum] = {0};
+  bool valid[kCounterNum] = {false};
+};
+
+// perf_event_open counters for the calling thread and every thread it
+// creates after Open(), so open them before spawning the workload threads.
+// Hardware events are skipped when there is no PMU (most VMs/containers);
+// the software ones still report scheduling and memory behaviour.
+class PerfCounters {
+ public:
+  PerfCounters();
+  ~PerfCounters();
+
+  PerfCounters(const PerfCounters&) = delete;
+  PerfCounters& operator=(const PerfCounters&) = delete;
+
+  // Returns false if no counter at all could be opened.
+  bool Open();
+
+  void Start();
+
+  // Values are scaled up when the kernel had to multiplex the counters.
+  void Stop(CounterValues* values);
+
+  bool HasHardwareCounters() const;
+
+ private:
+  void Close();
+
+ private:
+  int fds_[kCounterNum];
+};
+
+}  // namespace bench
+
+}  // namespace mymuduo
@@ -1,20 +1,20 @@
 #include <pthread.h>
 #include <stdio.h>
-#include <sys/time.h>
 #include <unistd.h>
 
 #include <atomic>
 #include <memory>
 #include <vector>
 
+#ifdef USE_GPERFTOOLS
 #include "gperftools/profiler.h"
+#endif
 
+#include "bench.h"
 #include "common.h"
+#include "latency_recorder.h"
 #include "mutex.h"
 
-using RoutineType = void*(*)(void *);
-
-constexpr int kReaderNum = 1 << 3;
 constexpr int kReadIterNum = 1 << 25; // 32000000
 constexpr int kWriteIterNum = 1 << 1;
 
@@ -25,13 +25,6 @@ struct Foo {
   int val{0};
 };
 
-long long current_timestamp() {
-    struct timeval te;
-    gettimeofday(&te, NULL); // get current time
-    long long milliseconds = te.tv_sec*1000LL + te.tv_usec/1000; // calculate milliseconds
-    return milliseconds;
-}
-
 namespace version1 {
 
 template<typename T>
@@ -58,21 +51,13 @@ class DoubleBuffer {
 
 DoubleBuffer<Foo> dbd;
 
-void* ReadRoutine(void* args) {
-  for (int i = 0; i < kReadIterNum; ++i) {
-    const auto* ptr = dbd.Read();
-    //printf("val = %d.\n", ptr->val);
-  }
-  (void) args;
-  return nullptr;
+void Read(int64_t) {
+  const auto* ptr = dbd.Read();
+  mymuduo::bench::DoNotOptimize(ptr);
 }
 
-void* WriteRoutine(void* args) {
-  for (int i = 0; i < kWriteIterNum; ++i) {
-    dbd.Write(Foo(i + 1));
-  }
-  (void) args;
-  return nullptr;
+void Write(int64_t i) {
+  dbd.Write(Foo(i + 1));
 }
 
 }  // namespace version1
@@ -106,21 +91,13 @@ class DoubleBuffer {
 
 DoubleBuffer<Foo> dbd;
 
-void* ReadRoutine(void* args) {
-  for (int i = 0; i < kReadIterNum; ++i) {
-    const auto* ptr = dbd.Read();
-    //printf("val = %d.\n", ptr->val);
-  }
-  (void) args;
-  return nullptr;
+void Read(int64_t) {
+  const auto* ptr = dbd.Read();
+  mymuduo::bench::DoNotOptimize(ptr);
 }
 
-void* WriteRoutine(void* args) {
-  for (int i = 0; i < kWriteIterNum; ++i) {
-    dbd.Write(Foo(i + 1));
-  }
-  (void) args;
-  return nullptr;
+void Write(int64_t i) {
+  dbd.Write(Foo(i + 1));
 }
 
 }  // namespace version2
@@ -156,21 +133,13 @@ class DoubleBuffer {
 
 DoubleBuffer<Foo> dbd;
 
-void* ReadRoutine(void* args) {
-  for (int i = 0; i < kReadIterNum; ++i) {
-    auto ptr = dbd.Read();
-    //printf("val = %d.\n", ptr->val);
-  }
-  (void) args;
-  return nullptr;
+void Read(int64_t) {
+  auto ptr = dbd.Read();
+  mymuduo::bench::DoNotOptimize(ptr.get());
 }
 
-void* WriteRoutine(void* args) {
-  for (int i = 0; i < kWriteIterNum; ++i) {
-    dbd.Write(Foo(i + 1));
-  }
-  (void) args;
-  return nullptr;
+void Write(int64_t i) {
+  dbd.Write(Foo(i + 1));
 }
 
 }  // namespace version3
@@ -209,21 +178,13 @@ class DoubleBuffer {
 
 DoubleBuffer<Foo> dbd;
 
-void* ReadRoutine(void* args) {
-  for (int i = 0; i < kReadIterNum; ++i) {
-    auto ptr = dbd.Read();
-    //printf("val = %d.\n", ptr->val);
-  }
-  (void) args;
-  return nullptr;
+void Read(int64_t) {
+  auto ptr = dbd.Read();
+  mymuduo::bench::DoNotOptimize(ptr.get());
 }
 
-void* WriteRoutine(void* args) {
-  for (int i = 0; i < kWriteIterNum; ++i) {
-    dbd.Write(Foo(i + 1));
-  }
-  (void) args;
-  return nullptr;
+void Write(int64_t i) {
+  dbd.Write(Foo(i + 1));
 }
 
 }  // namespace version4
@@ -402,64 +363,58 @@ void DoubleBuffer<T>::RemoveReaderLock(ReaderLock* reader_lock) {
 
 DoubleBuffer<Foo> dbd;
 
-void* ReadRoutine(void* args) {
-  for (int i = 0; i < kReadIterNum; ++i) {
-    DoubleBuffer<Foo>::ScopedPtr reader;
-    dbd.Read(&reader);
-    //printf("val = %d.\n", reader->val);
-  }
-  (void) args;
-  return nullptr;
-}
-
-void* WriteRoutine(void* args) {
-  for (int i = 0; i < kWriteIterNum; ++i) {
-    dbd.Write(Foo(i + 1));
-  }
-  (void) args;
-  return nullptr;
+void Read(int64_t) {
+  DoubleBuffer<Foo>::ScopedPtr reader;
+  dbd.Read(&reader);
+  mymuduo::bench::DoNotOptimize(reader.get());
 }
 
-}  // namespace version5
-
-void benchmark(RoutineType read_routine, RoutineType write_routine) {
-  pthread_t tid_readers[kReaderNum];
-  pthread_t tid_writer;
+// Every read timed, two clock_gettime() included.
+mymuduo::LatencyRecorder read_latency("dbd/version5 Read");
 
-  auto begin = current_timestamp();
-  for (int i = 0; i < kReaderNum; ++i) {
-    if (pthread_create(tid_readers + i, nullptr, read_routine, nullptr)) {
-      exit(EXIT_FAILURE);
-    }
-  }
-  if (pthread_create(&tid_writer, nullptr, write_routine, nullptr)) {
-    exit(EXIT_FAILURE);
-  }
-
-  for (int i = 0; i < kReaderNum; ++i) {
-    pthread_join(tid_readers[i], nullptr);
-  }
-  pthread_join(tid_writer, nullptr);
-  auto end = current_timestamp();
+void TimedRead(int64_t i) {
+  mymuduo::LatencyRecorder::Timer timer(&read_latency);
+  Read(i);
+}
 
-  printf("Time elapsed(ms):%lld.\n", end - begin);
+void Write(int64_t i) {
+  dbd.Write(Foo(i + 1));
 }
 
-void test_version1() { benchmark(version1::ReadRoutine, version1::WriteRoutine); }
-void test_version2() { benchmark(version2::ReadRoutine, version2::WriteRoutine); }
-void test_version3() { benchmark(version3::ReadRoutine, version3::WriteRoutine); }
-void test_version4() { benchmark(version4::ReadRoutine, version4::WriteRoutine); }
-void test_version5() { benchmark(version5::ReadRoutine, version5::WriteRoutine); }
+}  // namespace version5
 
-int main(void) {
-  printf("we need you to start(type anything):");
-  getchar();
-  printf("process is running.\n");
+int main(int argc, char* argv[]) {
+  mymuduo::bench::Options options;
+  if (!mymuduo::bench::ParseOptions(argc, argv, &options)) {
+    fprintf(stderr, "usage: %s [--readers=1,2,4,8] [--writers=1] [--warmup=1] [--repeats=3] "
+                    "[--sample-every=64] [--read-iters=N] [--write-iters=N] [--filter=str] "
+                    "[--format=text|json|csv] [--perf-counters=0|1]\n", argv[0]);
+    return 1;
+  }
 
+#ifdef USE_GPERFTOOLS
   ProfilerStart("dbd_benchmark.prof");
-  //test_version3();
-  test_version4();  // almost 10000ms
-  test_version5();  // almost 1200ms
-  ProfilerStart("dbd_benchmark.prof");
+#endif
+  using mymuduo::bench::MakeWorkload;
+  mymuduo::bench::Harness harness(options);
+  harness.Run(MakeWorkload("dbd/version1", version1::Read, kReadIterNum, version1::Write,
+                           kWriteIterNum));
+  harness.Run(MakeWorkload("dbd/version2", version2::Read, kReadIterNum, version2::Write,
+                           kWriteIterNum));  // sleeps 1s per write
+  harness.Run(MakeWorkload("dbd/version3", version3::Read, kReadIterNum, version3::Write,
+                           kWriteIterNum));
+  harness.Run(MakeWorkload("dbd/version4", version4::Read, kReadIterNum, version4::Write,
+                           kWriteIterNum));
+  harness.Run(MakeWorkload("dbd/version5", version5::Read, kReadIterNum, version5::Write,
+                           kWriteIterNum));
+  harness.Run(MakeWorkload("dbd/version5+latency", version5::TimedRead, kReadIterNum,
+                           version5::Write, kWriteIterNum));
+#ifdef USE_GPERFTOOLS
+  ProfilerStop();
+#endif
+  harness.Report(stdout);
+  version5::read_latency.Merge();
+  // stderr: stdout carries the report, which may be JSON or CSV.
+  fprintf(stderr, "%s\n", version5::read_latency.DumpText().c_str());
   return 0;
 }
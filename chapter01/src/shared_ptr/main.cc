@@ -1,17 +1,16 @@
 #include <pthread.h>
-#include <sys/time.h>
+#include <stdio.h>
 
 #include <atomic>
-#include <iostream>
 #include <memory>
 #include <mutex>
 #include <shared_mutex>
 
-using RoutineType = void*(*)(void *);
+#include "bench.h"
+
 using WriteLock = std::unique_lock<std::shared_mutex>;
 using ReadLock = std::shared_lock<std::shared_mutex>;
 
-constexpr int kReaderNum = 1 << 3;
 constexpr int kReadIterNum = 1 << 21; // almost 2 millon
 constexpr int kWriteIterNum = 1 << 1;
 
@@ -20,6 +19,7 @@ struct Foo {
 };
 
 int ReadFoo(const std::shared_ptr<Foo>& ptr) {
+  mymuduo::bench::DoNotOptimize(ptr->val);
   return ptr->val;
 }
 
@@ -27,13 +27,6 @@ void WriteFoo(const std::shared_ptr<Foo>& ptr, int new_val) {
   ptr->val = new_val;
 }
 
-long long current_timestamp() {
-    struct timeval te;
-    gettimeofday(&te, NULL); // get current time
-    long long milliseconds = te.tv_sec*1000LL + te.tv_usec/1000; // calculate milliseconds
-    return milliseconds;
-}
-
 namespace version1 {
 
 std::shared_ptr<Foo> global_ptr = std::make_shared<Foo>();
@@ -57,18 +50,12 @@ void Writer(int new_val) {
   }
 }
 
-void* ReadRoutine(void* args) {
-  for (int i = 0; i < kReadIterNum; ++i) {
-    Reader();
-  }
-  return nullptr;
+void Read(int64_t) {
+  Reader();
 }
 
-void* WriteRoutine(void* args) {
-  for (int i = 0; i < kWriteIterNum; ++i) {
-    Writer(i + 1);
-  }
-  return nullptr;
+void Write(int64_t i) {
+  Writer(i + 1);
 }
 
 }  // namespace version1
@@ -96,18 +83,12 @@ void Writer(int new_val) {
   }
 }
 
-void* ReadRoutine(void* args) {
-  for (int i = 0; i < kReadIterNum; ++i) {
-    Reader();
-  }
-  return nullptr;
+void Read(int64_t) {
+  Reader();
 }
 
-void* WriteRoutine(void* args) {
-  for (int i = 0; i < kWriteIterNum; ++i) {
-    Writer(i + 1);
-  }
-  return nullptr;
+void Write(int64_t i) {
+  Writer(i + 1);
 }
 
 }  // namespace version2
@@ -154,18 +135,12 @@ class FooMgr {
   mutable std::atomic<int> ver_{0};
 };
 
-void* ReadRoutine(void* args) {
-  for (int i = 0; i < kReadIterNum; ++i) {
-    FooMgr::GetInstance().Reader();
-  }
-  return nullptr;
+void Read(int64_t) {
+  FooMgr::GetInstance().Reader();
 }
 
-void* WriteRoutine(void* args) {
-  for (int i = 0; i < kWriteIterNum; ++i) {
-    FooMgr::GetInstance().Writer(i + 1);
-  }
-  return nullptr;
+void Write(int64_t i) {
+  FooMgr::GetInstance().Writer(i + 1);
 }
 
 }  // namespace version3
@@ -185,49 +160,35 @@ void Writer(int new_val) {
   std::atomic_exchange(&global_ptr, new_ptr);
 }
 
-void* ReadRoutine(void* args) {
-  for (int i = 0; i < kReadIterNum; ++i) {
-    Reader();
-  }
-  return nullptr;
+void Read(int64_t) {
+  Reader();
 }
 
-void* WriteRoutine(void* args) {
-  for (int i = 0; i < kWriteIterNum; ++i) {
-    Writer(i + 1);
-  }
-  return nullptr;
+void Write(int64_t i) {
+  Writer(i + 1);
 }
 
 }  // namespace version4
 
-void benchmark(RoutineType read_routine, RoutineType write_routine) {
-  pthread_t tid_readers[kReaderNum];
-  pthread_t tid_writer;
-
-  auto begin = current_timestamp();
-  for (int i = 0; i < kReaderNum; ++i) {
-    if (pthread_create(tid_readers + i, nullptr, read_routine, nullptr)) {
-      exit(EXIT_FAILURE);
-    }
-  }
-  if (pthread_create(&tid_writer, nullptr, write_routine, nullptr)) {
-    exit(EXIT_FAILURE);
-  }
-
-  for (int i = 0; i < kReaderNum; ++i) {
-    pthread_join(tid_readers[i], nullptr);
-  }
-  pthread_join(tid_writer, nullptr);
-  auto end = current_timestamp();
-
-  std::cout << "Time elapsed(ms):" << end - begin << std::endl;
-}
-
-int main(void) {
-  benchmark(version1::ReadRoutine, version1::WriteRoutine);  // almost 1300ms
-  benchmark(version2::ReadRoutine, version2::WriteRoutine);  // almost 1600ms
-  benchmark(version3::ReadRoutine, version3::WriteRoutine);  // almost 600ms
-  benchmark(version4::ReadRoutine, version4::WriteRoutine);  // almost 1700ms
+int main(int argc, char* argv[]) {
+  mymuduo::bench::Options options;
+  if (!mymuduo::bench::ParseOptions(argc, argv, &options)) {
+    fprintf(stderr, "usage: %s [--readers=1,2,4,8] [--writers=1] [--warmup=1] [--repeats=3] "
+                    "[--sample-every=64] [--read-iters=N] [--write-iters=N] [--filter=str] "
+                    "[--format=text|json|csv] [--perf-counters=0|1]\n", argv[0]);
+    return 1;
+  }
+
+  using mymuduo::bench::MakeWorkload;
+  mymuduo::bench::Harness harness(options);
+  harness.Run(MakeWorkload("shared_ptr/version1", version1::Read, kReadIterNum, version1::Write,
+                           kWriteIterNum));
+  harness.Run(MakeWorkload("shared_ptr/version2", version2::Read, kReadIterNum, version2::Write,
+                           kWriteIterNum));
+  harness.Run(MakeWorkload("shared_ptr/version3", version3::Read, kReadIterNum, version3::Write,
+                           kWriteIterNum));
+  harness.Run(MakeWorkload("shared_ptr/version4", version4::Read, kReadIterNum, version4::Write,
+                           kWriteIterNum));
+  harness.Report(stdout);
   return 0;
 }
@@ -8,4 +8,12 @@ namespace mymuduo {
                        if (__builtin_expect(errnum != 0, 0))    \
                          __assert_perror_fail (errnum, __FILE__, __LINE__, __func__);})
 
+#if defined(__GNUC__)
+#define LIKELY(expr) (__builtin_expect(!!(expr), 1))
+#define UNLIKELY(expr) (__builtin_expect(!!(expr), 0))
+#else
+#define LIKELY(expr) (expr)
+#define UNLIKELY(expr) (expr)
+#endif
+
 }  // namespace mymuduo
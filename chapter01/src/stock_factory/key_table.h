@@ -0,0 +1,72 @@
+#pragma once
+
+#include <stddef.h>
+
+#include <deque>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+
+#include "mutex.h"
+
+namespace mymuduo {
+
+// A key view plus its precomputed hash.
+// Containers keyed by InternedKey never hash the string again, and two
+// interned keys are equal iff they point at the same storage.
+struct InternedKey {
+  std::string_view key;
+  size_t hash{0};
+
+  bool operator==(const InternedKey& rhs) const {
+    return hash == rhs.hash && (key.data() == rhs.key.data() || key == rhs.key);
+  }
+};
+
+struct InternedKeyHash {
+  size_t operator()(const InternedKey& interned_key) const { return interned_key.hash; }
+};
+
+// A probe views the caller's buffer, it is only good for lookups.
+inline InternedKey MakeProbeKey(std::string_view key) {
+  return InternedKey{key, std::hash<std::string_view>()(key)};
+}
+
+// Process wide, grow only table of keys.
+// Interned views stay valid until exit, so objects can hold them without
+// owning a copy, even after the container they came from is gone.
+// The set of symbols is bounded in practice, nothing is ever released.
+class KeyTable {
+ public:
+  KeyTable(const KeyTable&) = delete;
+  KeyTable& operator=(const KeyTable&) = delete;
+
+  static KeyTable& GetInstance() {
+    static KeyTable* key_table = new KeyTable;  // never destroyed
+    return *key_table;
+  }
+
+  InternedKey Intern(const InternedKey& probe) {
+    MutexLockGuard mtx_guard(mtx_);
+    auto it = index_.find(probe);
+    if (it != index_.end()) {
+      return *it;
+    }
+    storage_.emplace_back(probe.key);  // deque never moves its elements
+    InternedKey interned_key{storage_.back(), probe.hash};
+    index_.insert(interned_key);
+    return interned_key;
+  }
+
+ private:
+  KeyTable() = default;
+  ~KeyTable() = default;
+
+ private:
+  MutexLock mtx_;
+  std::deque<std::string> storage_;
+  std::unordered_set<InternedKey, InternedKeyHash> index_;
+};
+
+}  // namespace mymuduo
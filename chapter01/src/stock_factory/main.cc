@@ -1,10 +1,323 @@
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <atomic>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "bench.h"
+#include "latency_recorder.h"
 #include "stock_factory.h"
 
+using RoutineType = void*(*)(void *);
+
+constexpr int kReaderNum = 1 << 3;
+constexpr int kReadIterNum = 1 << 20;
+constexpr int kKeyNum = 1 << 6;
+constexpr int kChurnIterNum = 1 << 18;
+
+std::atomic<long> alloc_count{0};
+
+void* operator new(size_t size) {
+  alloc_count.fetch_add(1, std::memory_order_relaxed);
+  void* ptr = malloc(size);
+  if (!ptr) {
+    throw std::bad_alloc();
+  }
+  return ptr;
+}
+
+void operator delete(void* ptr) noexcept { free(ptr); }
+void operator delete(void* ptr, size_t) noexcept { free(ptr); }
+
+long long current_nanoseconds() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+std::vector<std::string> MakeKeys() {
+  std::vector<std::string> keys;
+  for (int i = 0; i < kKeyNum; ++i) {
+    keys.emplace_back("stock-" + std::to_string(i));
+  }
+  return keys;
+}
+
+const std::vector<std::string> keys = MakeKeys();
+
+// Hits: every lookup finds a live stock. version6 reads its snapshot,
+// version7 takes mtx_ and locks the weak_ptr in the map, the same hit path
+// as version5; version5 itself hands out a weak_ptr, so nothing keeps its
+// stocks alive for a hit.
+namespace version6 {
+
+auto sf = std::make_shared<mymuduo::version6::StockFactory>();
+
+void ReadOp(int64_t i) {
+  auto stock = sf->GetStock(keys[i % kKeyNum]);
+  mymuduo::bench::DoNotOptimize(stock.get());
+}
+
+}  // namespace version6
+
+// Churn: every GetStock misses, creates a stock and drops it again.
+namespace version5 {
+
+auto sf = std::make_shared<mymuduo::version5::StockFactory>();
+
+void* ChurnRoutine(void* args) {
+  for (int i = 0; i < kChurnIterNum; ++i) {
+    // version5 hands out a weak_ptr, the stock dies right here.
+    auto stock = sf->GetStock(keys[i % kKeyNum]);
+  }
+  (void) args;
+  return nullptr;
+}
+
+}  // namespace version5
+
+namespace version7 {
+
+auto sf = std::make_shared<mymuduo::version7::StockFactory>();
+
+void ReadOp(int64_t i) {
+  auto stock = sf->GetStock(keys[i % kKeyNum]);
+  mymuduo::bench::DoNotOptimize(stock.get());
+}
+
+void* ChurnRoutine(void* args) {
+  for (int i = 0; i < kChurnIterNum; ++i) {
+    auto stock = sf->GetStock(keys[i % kKeyNum]);
+  }
+  (void) args;
+  return nullptr;
+}
+
+}  // namespace version7
+
+// Hits parsed straight out of a packet buffer, no std::string per lookup.
+namespace version8 {
+
+auto sf = std::make_shared<mymuduo::version8::StockFactory>();
+
+void* ReadRoutine(void* args) {
+  char packet[kKeyNum * 16];
+  size_t offsets[kKeyNum + 1] = {0};
+  for (int i = 0; i < kKeyNum; ++i) {
+    offsets[i + 1] = offsets[i] + keys[i].copy(packet + offsets[i], keys[i].size());
+  }
+
+  for (int i = 0; i < kReadIterNum; ++i) {
+    int k = i % kKeyNum;
+    auto stock = sf->GetStock(std::string_view(packet + offsets[k], offsets[k + 1] - offsets[k]));
+  }
+  (void) args;
+  return nullptr;
+}
+
+mymuduo::LatencyRecorder get_stock_latency("version8 GetStock");
+
+void* TimedReadRoutine(void* args) {
+  for (int i = 0; i < kReadIterNum; ++i) {
+    mymuduo::LatencyRecorder::Timer timer(&get_stock_latency);
+    auto stock = sf->GetStock(keys[i % kKeyNum]);
+  }
+  (void) args;
+  return nullptr;
+}
+
+}  // namespace version8
+
+namespace version8 {
+
+auto churn_sf = std::make_shared<mymuduo::version8::StockFactory>();
+
+void* ChurnRoutine(void* args) {
+  for (int i = 0; i < kChurnIterNum; ++i) {
+    auto stock = churn_sf->GetStock(keys[i % kKeyNum]);
+  }
+  (void) args;
+  return nullptr;
+}
+
+}  // namespace version8
+
+namespace version10 {
+
+auto sf = std::make_shared<mymuduo::version10::StockFactory>();
+
+void* ChurnRoutine(void* args) {
+  for (int i = 0; i < kChurnIterNum; ++i) {
+    // dropping the stock only pushes it onto the retire list
+    auto stock = sf->GetStock(keys[i % kKeyNum]);
+  }
+  (void) args;
+  return nullptr;
+}
+
+}  // namespace version10
+
+// A packet resolves every key and drops the batch again.
+constexpr int kPacketIterNum = 1 << 12;
+
+namespace version8 {
+
+void* PacketRoutine(void* args) {
+  std::vector<mymuduo::version8::StockFactory::StockPtr> stocks(kKeyNum);
+  for (int i = 0; i < kPacketIterNum; ++i) {
+    for (int k = 0; k < kKeyNum; ++k) {
+      stocks[k] = sf->GetStock(keys[k]);
+    }
+    for (auto&& stock : stocks) {
+      stock.reset();
+    }
+  }
+  (void) args;
+  return nullptr;
+}
+
+}  // namespace version8
+
+namespace version9 {
+
+auto sf = std::make_shared<mymuduo::version9::StockFactory>();
+
+void* PacketRoutine(void* args) {
+  std::vector<std::string_view> packet(keys.begin(), keys.end());
+  std::vector<mymuduo::version9::StockFactory::StockPtr> stocks(kKeyNum);
+  for (int i = 0; i < kPacketIterNum; ++i) {
+    sf->GetStocks(packet.data(), packet.size(), stocks.data());
+    sf->ReleaseStocks(stocks.data(), stocks.size());
+  }
+  (void) args;
+  return nullptr;
+}
+
+}  // namespace version9
+
+void benchmark(RoutineType read_routine, int reader_num) {
+  pthread_t tid_readers[kReaderNum];
+
+  auto begin = current_nanoseconds();
+  for (int i = 0; i < reader_num; ++i) {
+    if (pthread_create(tid_readers + i, nullptr, read_routine, nullptr)) {
+      exit(EXIT_FAILURE);
+    }
+  }
+  for (int i = 0; i < reader_num; ++i) {
+    pthread_join(tid_readers[i], nullptr);
+  }
+  auto end = current_nanoseconds();
+
+  printf("readers:%d, Time elapsed(ms):%.1f.\n", reader_num, (end - begin) / 1e6);
+}
+
+void churn_benchmark(const char* name, RoutineType churn_routine) {
+  pthread_t tid_churners[kReaderNum];
+
+  auto alloc_begin = alloc_count.load();
+  auto begin = current_nanoseconds();
+  for (int i = 0; i < kReaderNum; ++i) {
+    if (pthread_create(tid_churners + i, nullptr, churn_routine, nullptr)) {
+      exit(EXIT_FAILURE);
+    }
+  }
+  for (int i = 0; i < kReaderNum; ++i) {
+    pthread_join(tid_churners[i], nullptr);
+  }
+  auto end = current_nanoseconds();
+  auto allocs = alloc_count.load() - alloc_begin;
+
+  double ops = static_cast<double>(kReaderNum) * kChurnIterNum;
+  printf("%s churn, allocations/op:%.3f, ns/op:%.1f.\n", name, allocs / ops, (end - begin) / ops);
+}
+
+void hit_benchmark(const char* name, RoutineType read_routine) {
+  auto alloc_begin = alloc_count.load();
+  auto begin = current_nanoseconds();
+  read_routine(nullptr);
+  auto end = current_nanoseconds();
+  auto allocs = alloc_count.load() - alloc_begin;
+
+  double ops = kReadIterNum;
+  printf("%s hit, allocations/op:%.3f, ns/op:%.1f.\n", name, allocs / ops, (end - begin) / ops);
+}
+
+void packet_benchmark(const char* name, RoutineType packet_routine) {
+  pthread_t tid_handlers[kReaderNum];
+
+  auto begin = current_nanoseconds();
+  for (int i = 0; i < kReaderNum; ++i) {
+    if (pthread_create(tid_handlers + i, nullptr, packet_routine, nullptr)) {
+      exit(EXIT_FAILURE);
+    }
+  }
+  for (int i = 0; i < kReaderNum; ++i) {
+    pthread_join(tid_handlers[i], nullptr);
+  }
+  auto end = current_nanoseconds();
+
+  double ops = static_cast<double>(kReaderNum) * kPacketIterNum * kKeyNum;
+  printf("%s packet, ns/key:%.1f.\n", name, (end - begin) / ops);
+}
+
+// version6 against the locked hit path on the same hits, 1 to 8 readers.
+void test_version6() {
+  std::vector<mymuduo::version6::StockFactory::StockPtr> holders6;
+  std::vector<mymuduo::version7::StockFactory::StockPtr> holders7;
+  for (const auto& key : keys) {
+    holders6.emplace_back(version6::sf->GetStock(key));
+    holders7.emplace_back(version7::sf->GetStock(key));
+  }
+  mymuduo::bench::Options options;
+  options.writer_nums = {0};
+  mymuduo::bench::Harness harness(options);
+  harness.Run(mymuduo::bench::MakeWorkload("stock_factory/version7(locked) hit",
+                                           version7::ReadOp, kReadIterNum));
+  harness.Run(mymuduo::bench::MakeWorkload("stock_factory/version6(snapshot) hit",
+                                           version6::ReadOp, kReadIterNum));
+  harness.Report(stdout);
+}
+
 int main(void) {
   mymuduo::version1::StockFactory s1;
   mymuduo::version2::StockFactory s2;
   mymuduo::version3::StockFactory s3;
   auto s4 = std::make_shared<mymuduo::version4::StockFactory>();
   auto s5 = std::make_shared<mymuduo::version5::StockFactory>();
+  auto s6 = std::make_shared<mymuduo::version6::StockFactory>();
+
+  auto s7 = std::make_shared<mymuduo::version7::StockFactory>();
+  auto s8 = std::make_shared<mymuduo::version8::StockFactory>();
+  auto s9 = std::make_shared<mymuduo::version9::StockFactory>();
+  auto s10 = std::make_shared<mymuduo::version10::StockFactory>();
+
+  test_version6();
+  churn_benchmark("version5(new + deleter)", version5::ChurnRoutine);
+  churn_benchmark("version7(pooled)", version7::ChurnRoutine);
+
+  std::vector<mymuduo::version8::StockFactory::StockPtr> holders;
+  for (const auto& key : keys) {
+    holders.emplace_back(version8::sf->GetStock(key));
+  }
+  hit_benchmark("version8(string_view)", version8::ReadRoutine);
+  benchmark(version8::TimedReadRoutine, 4);
+  version8::get_stock_latency.Merge();
+  printf("%s\n", version8::get_stock_latency.DumpText().c_str());
+  packet_benchmark("version8(one by one)", version8::PacketRoutine);
+
+  std::vector<mymuduo::version9::StockFactory::StockPtr> holders9;
+  for (const auto& key : keys) {
+    holders9.emplace_back(version9::sf->GetStock(key));
+  }
+  packet_benchmark("version9(batched)", version9::PacketRoutine);
+
+  churn_benchmark("version8(synchronous erase)", version8::ChurnRoutine);
+  churn_benchmark("version10(deferred erase)", version10::ChurnRoutine);
+  mymuduo::version10::StockFactory::FlushRetired();
   return 0;
 }
@@ -0,0 +1,188 @@
+#pragma once
+
+#include <stddef.h>
+
+#include <new>
+#include <vector>
+
+#include "common.h"
+#include "mutex.h"
+
+namespace mymuduo {
+
+namespace internal {
+
+// Fixed size object pool.
+// Every thread keeps a free list of kBlockSize blocks carved from slabs, so
+// allocate/deallocate on the hot path touch no lock and no shared cache line.
+// Blocks freed by another thread go to that thread's list; once a list grows
+// past kMaxCached, half of it is handed back to a global depot, from which
+// empty lists are refilled before a new slab is requested. Slabs are never
+// returned to the system.
+template<size_t kBlockSize>
+class FixedPool {
+  struct Block {
+    Block* next;
+  };
+
+  struct FreeList {
+    Block* head;
+    size_t count;
+  };
+
+  struct Batch {
+    Block* head;
+    size_t count;
+  };
+
+  class Depot {
+   public:
+    bool Pop(FreeList* list) {
+      MutexLockGuard mtx_guard(mtx_);
+      if (batches_.empty()) {
+        return false;
+      }
+      list->head = batches_.back().head;
+      list->count = batches_.back().count;
+      batches_.pop_back();
+      return true;
+    }
+
+    void Push(Block* head, size_t count) {
+      MutexLockGuard mtx_guard(mtx_);
+      batches_.push_back(Batch{head, count});
+    }
+
+   private:
+    MutexLock mtx_;
+    std::vector<Batch> batches_;
+  };
+
+  // Hands the free list back to the depot when its thread exits.
+  class Flusher {
+   public:
+    ~Flusher() {
+      if (t_free_list.head) {
+        GetDepot().Push(t_free_list.head, t_free_list.count);
+        t_free_list.head = nullptr;
+        t_free_list.count = 0;
+      }
+    }
+  };
+
+ public:
+  static constexpr size_t kSlabBlocks = 64;
+  static constexpr size_t kMaxCached = 4 * kSlabBlocks;
+
+  static_assert(kBlockSize >= sizeof(Block), "block too small");
+  static_assert(kBlockSize % alignof(max_align_t) == 0, "block must keep max alignment");
+
+  static void* Allocate() {
+    if (UNLIKELY(!t_free_list.head)) {
+      Refill();
+    }
+    Block* block = t_free_list.head;
+    t_free_list.head = block->next;
+    --t_free_list.count;
+    return block;
+  }
+
+  static void Deallocate(void* ptr) {
+    if (UNLIKELY(!t_free_list.head)) {
+      RegisterFlusher();
+    }
+    Block* block = static_cast<Block*>(ptr);
+    block->next = t_free_list.head;
+    t_free_list.head = block;
+    if (UNLIKELY(++t_free_list.count > kMaxCached)) {
+      Release(kMaxCached / 2);
+    }
+  }
+
+ private:
+  static Depot& GetDepot() {
+    static Depot* depot = new Depot;  // never destroyed, blocks may outlive main
+    return *depot;
+  }
+
+  static void RegisterFlusher() {
+    thread_local Flusher flusher;
+    (void) flusher;
+  }
+
+  static void Refill() {
+    RegisterFlusher();
+    if (GetDepot().Pop(&t_free_list)) {
+      return;
+    }
+    char* slab = static_cast<char*>(::operator new(kSlabBlocks * kBlockSize));
+    for (size_t i = 0; i < kSlabBlocks; ++i) {
+      Block* block = reinterpret_cast<Block*>(slab + i * kBlockSize);
+      block->next = t_free_list.head;
+      t_free_list.head = block;
+    }
+    t_free_list.count += kSlabBlocks;
+  }
+
+  static void Release(size_t count) {
+    Block* head = t_free_list.head;
+    Block* tail = head;
+    for (size_t i = 1; i < count; ++i) {
+      tail = tail->next;
+    }
+    t_free_list.head = tail->next;
+    t_free_list.count -= count;
+    tail->next = nullptr;
+    GetDepot().Push(head, count);
+  }
+
+  static __thread FreeList t_free_list;
+};
+
+template<size_t kBlockSize>
+__thread typename FixedPool<kBlockSize>::FreeList FixedPool<kBlockSize>::t_free_list;
+
+constexpr size_t RoundUpBlockSize(size_t size) {
+  return (size + alignof(max_align_t) - 1) / alignof(max_align_t) * alignof(max_align_t);
+}
+
+}  // namespace internal
+
+// Allocator over per thread FixedPools, one pool per rebound type size.
+// Meant for std::allocate_shared, which rebinds it to the control block type
+// and so gets the object and its control block in a single pooled block.
+template<typename T>
+class PoolAllocator {
+ public:
+  using value_type = T;
+
+  PoolAllocator() noexcept = default;
+  template<typename U>
+  PoolAllocator(const PoolAllocator<U>&) noexcept {}
+
+  T* allocate(size_t n) {
+    if (n != 1 || alignof(T) > alignof(max_align_t)) {
+      return static_cast<T*>(::operator new(n * sizeof(T)));
+    }
+    return static_cast<T*>(Pool::Allocate());
+  }
+
+  void deallocate(T* ptr, size_t n) noexcept {
+    if (n != 1 || alignof(T) > alignof(max_align_t)) {
+      ::operator delete(ptr);
+      return;
+    }
+    Pool::Deallocate(ptr);
+  }
+
+ private:
+  using Pool = internal::FixedPool<internal::RoundUpBlockSize(sizeof(T))>;
+};
+
+template<typename T, typename U>
+bool operator==(const PoolAllocator<T>&, const PoolAllocator<U>&) noexcept { return true; }
+
+template<typename T, typename U>
+bool operator!=(const PoolAllocator<T>&, const PoolAllocator<U>&) noexcept { return false; }
+
+}  // namespace mymuduo
@@ -1,5 +1,13 @@
 #include "stock_factory.h"
 
+#include <sched.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <iterator>
+
+#include "condition.h"
+
 namespace mymuduo {
 
 namespace version1 {
@@ -118,4 +126,613 @@ void StockFactory::RemoveStock(Stock* stock) {
 
 }  // namespace version5
 
+namespace version6 {
+
+class StockFactory::ReaderState {
+ public:
+  explicit ReaderState(StockFactory* factory) : factory_(factory) {}
+
+  ReaderState(const ReaderState&) = delete;
+  ReaderState& operator=(const ReaderState&) = delete;
+
+  ~ReaderState() {
+    if (factory_) {
+      factory_->RemoveReaderState(this);
+    }
+  }
+
+  // seq_ is odd while the owner thread is reading a snapshot.
+  void BeginRead() { seq_.fetch_add(1, std::memory_order_seq_cst); }
+  void EndRead() { seq_.fetch_add(1, std::memory_order_release); }
+
+  void WaitReadDone() const {
+    auto seq = seq_.load(std::memory_order_seq_cst);
+    if (!(seq & 1)) {
+      return;
+    }
+    while (seq_.load(std::memory_order_acquire) == seq) {
+      sched_yield();
+    }
+  }
+
+  void Detach() { factory_ = nullptr; }
+
+ private:
+  StockFactory* factory_;
+  std::atomic<unsigned long> seq_{0};
+};
+
+class StockFactory::TLSMgr {
+ public:
+  explicit TLSMgr(StockFactory* factory) : factory_(factory) {
+    MCHECK(pthread_key_create(&pkey_, &dtor));
+  }
+
+  TLSMgr(const TLSMgr&) = delete;
+  TLSMgr& operator=(const TLSMgr&) = delete;
+
+  ~TLSMgr() { MCHECK(pthread_key_delete(pkey_)); }
+
+  ReaderState* TLSValue() {
+    auto* tls_reader_state = static_cast<ReaderState*>(pthread_getspecific(pkey_));
+    if (tls_reader_state) {
+      return tls_reader_state;
+    }
+
+    std::unique_ptr<ReaderState> new_tls_reader_state(new (std::nothrow) ReaderState(factory_));
+    if (!new_tls_reader_state) {
+      return nullptr;
+    }
+    MCHECK(pthread_setspecific(pkey_, new_tls_reader_state.get()));
+    factory_->AddReaderState(new_tls_reader_state.get());
+    return new_tls_reader_state.release();
+  }
+
+ private:
+  static void dtor(void* x) {
+    auto* val = static_cast<ReaderState*>(x);
+    delete val;
+  }
+
+ private:
+  StockFactory* factory_;
+  pthread_key_t pkey_;
+};
+
+StockFactory::StockFactory() : stock_factory_(new StockMap), tls_mgr_(new TLSMgr(this)) {}
+
+StockFactory::~StockFactory() {
+  // No thread may read through this factory any more, so the remaining
+  // reader states are reclaimed here rather than at thread exit.
+  tls_mgr_.reset();
+  for (auto&& reader_state : reader_state_list_) {
+    reader_state->Detach();
+    delete reader_state;
+  }
+  delete stock_factory_.load(std::memory_order_relaxed);
+}
+
+StockFactory::StockPtr StockFactory::GetStock(const std::string& key) {
+  auto local_ptr = LookUp(key);
+  if (LIKELY(local_ptr)) {
+    return local_ptr;
+  }
+  return CreateStock(key);
+}
+
+StockFactory::StockPtr StockFactory::LookUp(const std::string& key) {
+  auto* tls_reader_state = tls_mgr_->TLSValue();
+  if (!tls_reader_state) {
+    return nullptr;
+  }
+
+  std::shared_ptr<Stock> local_ptr;
+  tls_reader_state->BeginRead();
+  const auto* cur_map = stock_factory_.load(std::memory_order_seq_cst);
+  auto it = cur_map->find(key);
+  if (it != cur_map->end()) {
+    local_ptr = it->second.lock();
+  }
+  tls_reader_state->EndRead();
+  return local_ptr;
+}
+
+StockFactory::StockPtr StockFactory::CreateStock(const std::string& key) {
+  std::shared_ptr<Stock> local_ptr;
+  MutexLockGuard mtx_guard(mtx_);
+  const auto* cur_map = stock_factory_.load(std::memory_order_relaxed);
+  auto it = cur_map->find(key);
+  if (it != cur_map->end()) {
+    local_ptr = it->second.lock();
+    if (local_ptr) {
+      return local_ptr;
+    }
+  }
+
+  using namespace std::placeholders;
+  local_ptr.reset(new Stock(key), std::bind(&StockFactory::StockDeleter, weak_from_this(), _1));
+  auto* new_map = new StockMap(*cur_map);
+  (*new_map)[key] = local_ptr;
+  Publish(new_map);
+  return local_ptr;
+}
+
+void StockFactory::StockDeleter(const std::weak_ptr<StockFactory>& wptr, Stock* stock) {
+  auto sptr = wptr.lock();
+  if (sptr) {
+    sptr->RemoveStock(stock);
+  }
+  delete stock;
+}
+
+void StockFactory::RemoveStock(Stock* stock) {
+  if (!stock) {
+    return;
+  }
+  MutexLockGuard mtx_guard(mtx_);
+  const auto* cur_map = stock_factory_.load(std::memory_order_relaxed);
+  auto it = cur_map->find(stock->GetKey());
+  // The key may already map to a newer stock created after this one died.
+  if (it == cur_map->end() || !it->second.expired()) {
+    return;
+  }
+  auto* new_map = new StockMap(*cur_map);
+  new_map->erase(stock->GetKey());
+  Publish(new_map);
+}
+
+// Must be called with mtx_ held.
+void StockFactory::Publish(const StockMap* new_map) {
+  const auto* old_map = stock_factory_.exchange(new_map, std::memory_order_seq_cst);
+  WaitReadersDone();
+  delete old_map;
+}
+
+void StockFactory::WaitReadersDone() {
+  MutexLockGuard list_mtx_guard(list_mtx_);
+  for (auto&& reader_state : reader_state_list_) {
+    reader_state->WaitReadDone();
+  }
+}
+
+void StockFactory::AddReaderState(ReaderState* reader_state) {
+  if (!reader_state) {
+    return;
+  }
+  MutexLockGuard list_mtx_guard(list_mtx_);
+  reader_state_list_.emplace_back(reader_state);
+}
+
+void StockFactory::RemoveReaderState(ReaderState* reader_state) {
+  if (!reader_state) {
+    return;
+  }
+  MutexLockGuard list_mtx_guard(list_mtx_);
+  for (auto&& a_state : reader_state_list_) {
+    if (a_state == reader_state) {
+      a_state = reader_state_list_.back();
+      reader_state_list_.pop_back();
+      return;
+    }
+  }
+}
+
+}  // namespace version6
+
+namespace version7 {
+
+class StockFactory::PooledStock : public Stock {
+ public:
+  PooledStock(const std::string& key, const std::weak_ptr<StockFactory>& factory)
+      : Stock(key), factory_(factory) {}
+
+  PooledStock(const PooledStock&) = delete;
+  PooledStock& operator=(const PooledStock&) = delete;
+
+  ~PooledStock() {
+    auto sptr = factory_.lock();
+    if (sptr) {
+      sptr->RemoveStock(this);
+    }
+  }
+
+ private:
+  std::weak_ptr<StockFactory> factory_;
+};
+
+StockFactory::StockPtr StockFactory::GetStock(const std::string& key) {
+  std::shared_ptr<Stock> local_ptr;
+  MutexLockGuard mtx_guard(mtx_);
+  auto& wptr = stock_factory_[key];
+  local_ptr = wptr.lock();
+  if (!local_ptr) {
+    local_ptr = std::allocate_shared<PooledStock>(PoolAllocator<PooledStock>(), key, weak_from_this());
+    wptr = local_ptr;
+  }
+  return local_ptr;
+}
+
+void StockFactory::RemoveStock(Stock* stock) {
+  if (stock) {
+    MutexLockGuard mtx_guard(mtx_);
+    auto it = stock_factory_.find(stock->GetKey());
+    // The key may already map to a newer stock created after this one died.
+    if (it != stock_factory_.end() && it->second.expired()) {
+      stock_factory_.erase(it);
+    }
+  }
+}
+
+}  // namespace version7
+
+namespace version8 {
+
+class StockFactory::PooledStock : public Stock {
+ public:
+  PooledStock(const InternedKey& key, const std::weak_ptr<StockFactory>& factory)
+      : Stock(key), factory_(factory) {}
+
+  PooledStock(const PooledStock&) = delete;
+  PooledStock& operator=(const PooledStock&) = delete;
+
+  ~PooledStock() {
+    auto sptr = factory_.lock();
+    if (sptr) {
+      sptr->RemoveStock(this);
+    }
+  }
+
+ private:
+  std::weak_ptr<StockFactory> factory_;
+};
+
+StockFactory::StockPtr StockFactory::GetStock(std::string_view key) {
+  auto probe = MakeProbeKey(key);
+  std::shared_ptr<Stock> local_ptr;
+  MutexLockGuard mtx_guard(mtx_);
+  auto it = stock_factory_.find(probe);
+  if (it != stock_factory_.end()) {
+    local_ptr = it->second.lock();
+    if (local_ptr) {
+      return local_ptr;
+    }
+    // Expired but not yet removed, the map key is already interned.
+    local_ptr = std::allocate_shared<PooledStock>(PoolAllocator<PooledStock>(), it->first, weak_from_this());
+    it->second = local_ptr;
+    return local_ptr;
+  }
+
+  auto interned_key = KeyTable::GetInstance().Intern(probe);
+  local_ptr = std::allocate_shared<PooledStock>(PoolAllocator<PooledStock>(), interned_key, weak_from_this());
+  stock_factory_.emplace(interned_key, local_ptr);
+  return local_ptr;
+}
+
+void StockFactory::RemoveStock(Stock* stock) {
+  if (stock) {
+    MutexLockGuard mtx_guard(mtx_);
+    auto it = stock_factory_.find(stock->GetInternedKey());
+    // The key may already map to a newer stock created after this one died.
+    if (it != stock_factory_.end() && it->second.expired()) {
+      stock_factory_.erase(it);
+    }
+  }
+}
+
+}  // namespace version8
+
+namespace version9 {
+
+namespace {
+
+// The shard a batch holds in this thread, RemoveStock must not relock it.
+__thread const void* t_released_shard = nullptr;
+
+}  // namespace
+
+class StockFactory::PooledStock : public Stock {
+ public:
+  PooledStock(const InternedKey& key, const std::weak_ptr<StockFactory>& factory)
+      : Stock(key), factory_(factory) {}
+
+  PooledStock(const PooledStock&) = delete;
+  PooledStock& operator=(const PooledStock&) = delete;
+
+  ~PooledStock() {
+    auto sptr = factory_.lock();
+    if (sptr) {
+      sptr->RemoveStock(this);
+    }
+  }
+
+ private:
+  std::weak_ptr<StockFactory> factory_;
+};
+
+StockFactory::StockPtr StockFactory::GetStock(std::string_view key) {
+  auto probe = MakeProbeKey(key);
+  auto& shard = GetShard(probe.hash);
+  MutexLockGuard mtx_guard(shard.mtx);
+  return GetStockLocked(&shard, probe);
+}
+
+void StockFactory::GetStocks(const std::string_view* keys, size_t count, StockPtr* stocks) {
+  // Whatever stocks held is dropped once no shard is locked: it may be the
+  // last reference to a stock of another shard, whose lock RemoveStock takes.
+  std::vector<StockPtr> previous(std::make_move_iterator(stocks),
+                                 std::make_move_iterator(stocks + count));
+
+  // Counting sort of the keys by shard.
+  std::vector<InternedKey> probes(count);
+  std::vector<size_t> order(count);
+  size_t shard_begin[kShardNum + 1] = {0};
+  for (size_t i = 0; i < count; ++i) {
+    probes[i] = MakeProbeKey(keys[i]);
+    ++shard_begin[probes[i].hash % kShardNum + 1];
+  }
+  for (size_t i = 0; i < kShardNum; ++i) {
+    shard_begin[i + 1] += shard_begin[i];
+  }
+  size_t shard_end[kShardNum];
+  std::copy(shard_begin, shard_begin + kShardNum, shard_end);
+  for (size_t i = 0; i < count; ++i) {
+    order[shard_end[probes[i].hash % kShardNum]++] = i;
+  }
+
+  for (size_t i = 0; i < kShardNum; ++i) {
+    if (shard_begin[i] == shard_end[i]) {
+      continue;
+    }
+    auto& shard = shards_[i];
+    MutexLockGuard mtx_guard(shard.mtx);
+    for (size_t j = shard_begin[i]; j < shard_end[i]; ++j) {
+      stocks[order[j]] = GetStockLocked(&shard, probes[order[j]]);
+    }
+  }
+}
+
+void StockFactory::ReleaseStocks(StockPtr* stocks, size_t count) {
+  // Shared stocks are unlikely to die here, drop them without any lock. If one
+  // still turns out to be the last reference, RemoveStock locks on its own.
+  for (size_t i = 0; i < count; ++i) {
+    if (stocks[i] && stocks[i].use_count() > 1) {
+      stocks[i].reset();
+    }
+  }
+
+  std::sort(stocks, stocks + count, [](const StockPtr& lhs, const StockPtr& rhs) {
+    size_t lhs_shard = lhs ? lhs->GetInternedKey().hash % kShardNum : kShardNum;
+    size_t rhs_shard = rhs ? rhs->GetInternedKey().hash % kShardNum : kShardNum;
+    return lhs_shard < rhs_shard;
+  });
+
+  for (size_t begin = 0, end = 0; begin < count && stocks[begin]; begin = end) {
+    auto& shard = GetShard(stocks[begin]->GetInternedKey().hash);
+    MutexLockGuard mtx_guard(shard.mtx);
+    t_released_shard = &shard;
+    for (end = begin; end < count && stocks[end] &&
+                      &GetShard(stocks[end]->GetInternedKey().hash) == &shard; ++end) {
+      stocks[end].reset();
+    }
+    t_released_shard = nullptr;
+  }
+}
+
+StockFactory::StockPtr StockFactory::GetStockLocked(Shard* shard, const InternedKey& probe) {
+  std::shared_ptr<Stock> local_ptr;
+  auto it = shard->stock_factory.find(probe);
+  if (it != shard->stock_factory.end()) {
+    local_ptr = it->second.lock();
+    if (local_ptr) {
+      return local_ptr;
+    }
+    // Expired but not yet removed, the map key is already interned.
+    local_ptr = std::allocate_shared<PooledStock>(PoolAllocator<PooledStock>(), it->first, weak_from_this());
+    it->second = local_ptr;
+    return local_ptr;
+  }
+
+  auto interned_key = KeyTable::GetInstance().Intern(probe);
+  local_ptr = std::allocate_shared<PooledStock>(PoolAllocator<PooledStock>(), interned_key, weak_from_this());
+  shard->stock_factory.emplace(interned_key, local_ptr);
+  return local_ptr;
+}
+
+void StockFactory::RemoveStock(Stock* stock) {
+  if (!stock) {
+    return;
+  }
+  auto& shard = GetShard(stock->GetInternedKey().hash);
+  auto erase_expired = [&shard, stock]() {
+    auto it = shard.stock_factory.find(stock->GetInternedKey());
+    // The key may already map to a newer stock created after this one died.
+    if (it != shard.stock_factory.end() && it->second.expired()) {
+      shard.stock_factory.erase(it);
+    }
+  };
+
+  if (t_released_shard == &shard) {
+    erase_expired();  // ReleaseStocks already holds shard.mtx
+  } else {
+    MutexLockGuard mtx_guard(shard.mtx);
+    erase_expired();
+  }
+}
+
+}  // namespace version9
+
+namespace version10 {
+
+class StockFactory::RetirableStock : public Stock {
+ public:
+  RetirableStock(const InternedKey& key, const std::weak_ptr<StockFactory>& factory)
+      : Stock(key), factory_(factory) {}
+
+  RetirableStock(const RetirableStock&) = delete;
+  RetirableStock& operator=(const RetirableStock&) = delete;
+
+  const std::weak_ptr<StockFactory>& GetFactory() const { return factory_; }
+
+ private:
+  friend class Reclaimer;
+  std::weak_ptr<StockFactory> factory_;
+  RetirableStock* next_retired_{nullptr};
+};
+
+class StockFactory::Reclaimer {
+ public:
+  static constexpr double kReclaimIntervalSeconds = 0.01;
+
+  // User space addresses fit in the low 48 bits, the length goes on top.
+  static constexpr int kBacklogShift = 48;
+  static constexpr size_t kBacklogMask = (1UL << (64 - kBacklogShift)) - 1;
+  static_assert(sizeof(uintptr_t) == 8, "head packing needs 64-bit pointers");
+  static_assert(kMaxBacklog < kBacklogMask, "backlog must fit in the head word");
+
+  Reclaimer(const Reclaimer&) = delete;
+  Reclaimer& operator=(const Reclaimer&) = delete;
+
+  // Shared by every factory and never destroyed: dead stocks may be retired
+  // after their factory is gone.
+  static Reclaimer& GetInstance() {
+    static Reclaimer* reclaimer = new Reclaimer;
+    return *reclaimer;
+  }
+
+  void Retire(RetirableStock* stock) {
+    // The head word is the list plus its length, so the push is one CAS and
+    // never touches a retired stock that another thread may be reclaiming.
+    size_t backlog;
+    auto head = head_.load(std::memory_order_relaxed);
+    do {
+      backlog = std::min(GetBacklog(head) + 1, kBacklogMask);
+      stock->next_retired_ = GetStock(head);
+    } while (!head_.compare_exchange_weak(head, MakeHead(stock, backlog), std::memory_order_release,
+                                          std::memory_order_relaxed));
+
+    if (UNLIKELY(backlog > kMaxBacklog)) {
+      Flush();
+    } else if (backlog == 1 || UNLIKELY(backlog == kReclaimBatch)) {
+      // The first one wakes the idle reclaimer, a full batch cuts its wait.
+      MutexLockGuard mtx_guard(mtx_);
+      cond_.Notify();
+    }
+  }
+
+  void Flush() {
+    MutexLockGuard reclaim_mtx_guard(reclaim_mtx_);
+    Reclaim(GetStock(head_.exchange(0, std::memory_order_acquire)));
+  }
+
+ private:
+  Reclaimer() : cond_(mtx_) {
+    pthread_t tid;
+    MCHECK(pthread_create(&tid, nullptr, &Reclaimer::ThreadRoutine, this));
+    MCHECK(pthread_detach(tid));
+  }
+
+  ~Reclaimer() = default;
+
+  static void* ThreadRoutine(void* args) {
+    auto* reclaimer = static_cast<Reclaimer*>(args);
+    for (;;) {
+      {
+        MutexLockGuard mtx_guard(reclaimer->mtx_);
+        // Idle until something is retired, then give a batch time to gather.
+        while (reclaimer->head_.load(std::memory_order_relaxed) == 0) {
+          reclaimer->cond_.Wait();
+        }
+        reclaimer->cond_.WaitForSeconds(kReclaimIntervalSeconds);
+      }
+      reclaimer->Flush();
+    }
+    return nullptr;
+  }
+
+  static uintptr_t MakeHead(RetirableStock* stock, size_t backlog) {
+    return reinterpret_cast<uintptr_t>(stock) | (static_cast<uintptr_t>(backlog) << kBacklogShift);
+  }
+  static RetirableStock* GetStock(uintptr_t head) {
+    return reinterpret_cast<RetirableStock*>(head & ((1UL << kBacklogShift) - 1));
+  }
+  static size_t GetBacklog(uintptr_t head) { return head >> kBacklogShift; }
+
+  // Must be called with reclaim_mtx_ held.
+  void Reclaim(RetirableStock* head) {
+    batch_.clear();
+    for (auto* stock = head; stock; stock = stock->next_retired_) {
+      batch_.emplace_back(stock);
+    }
+    // group the batch by factory, one locked pass each
+    std::sort(batch_.begin(), batch_.end(), [](RetirableStock* lhs, RetirableStock* rhs) {
+      return lhs->GetFactory().owner_before(rhs->GetFactory());
+    });
+    for (size_t begin = 0, end = 0; begin < batch_.size(); begin = end) {
+      const auto& factory = batch_[begin]->GetFactory();
+      for (end = begin + 1; end < batch_.size() && !factory.owner_before(batch_[end]->GetFactory()) &&
+                            !batch_[end]->GetFactory().owner_before(factory); ++end) {
+      }
+      auto sptr = factory.lock();
+      if (sptr) {
+        sptr->RemoveStocks(batch_.data() + begin, end - begin);
+      }
+    }
+
+    PoolAllocator<RetirableStock> alloc;
+    for (auto* stock : batch_) {
+      stock->~RetirableStock();
+      alloc.deallocate(stock, 1);
+    }
+  }
+
+ private:
+  std::atomic<uintptr_t> head_{0};
+  MutexLock mtx_;  // Sequence waiting for a batch
+  Condition cond_;
+  MutexLock reclaim_mtx_;  // Sequence reclaiming
+  std::vector<RetirableStock*> batch_;
+};
+
+void StockFactory::StockDeleter::operator()(Stock* stock) const {
+  Reclaimer::GetInstance().Retire(static_cast<RetirableStock*>(stock));
+}
+
+StockFactory::StockPtr StockFactory::GetStock(std::string_view key) {
+  auto probe = MakeProbeKey(key);
+  std::shared_ptr<Stock> local_ptr;
+  MutexLockGuard mtx_guard(mtx_);
+  auto it = stock_factory_.find(probe);
+  if (it != stock_factory_.end()) {
+    local_ptr = it->second.lock();
+    if (local_ptr) {
+      return local_ptr;
+    }
+  }
+
+  // Expired entries wait for the reclaimer, their key is already interned.
+  auto interned_key = it != stock_factory_.end() ? it->first : KeyTable::GetInstance().Intern(probe);
+  PoolAllocator<RetirableStock> alloc;
+  auto* stock = new (alloc.allocate(1)) RetirableStock(interned_key, weak_from_this());
+  local_ptr = std::shared_ptr<Stock>(stock, StockDeleter(), alloc);
+  stock_factory_[interned_key] = local_ptr;
+  return local_ptr;
+}
+
+void StockFactory::FlushRetired() {
+  Reclaimer::GetInstance().Flush();
+}
+
+void StockFactory::RemoveStocks(RetirableStock** stocks, size_t count) {
+  MutexLockGuard mtx_guard(mtx_);
+  for (size_t i = 0; i < count; ++i) {
+    auto it = stock_factory_.find(stocks[i]->GetInternedKey());
+    // The key may already map to a newer stock created after this one died.
+    if (it != stock_factory_.end() && it->second.expired()) {
+      stock_factory_.erase(it);
+    }
+  }
+}
+
+}  // namespace version10
+
 }  // namespace mymuduo
@@ -1,10 +1,18 @@
 #pragma once
 
+#include <pthread.h>
+
+#include <atomic>
 #include <functional>
 #include <memory>
 #include <string>
+#include <string_view>
 #include <unordered_map>
+#include <vector>
+
+#include "key_table.h"
 #include "mutex.h"
+#include "pool_allocator.h"
 
 namespace mymuduo {
 
@@ -132,4 +140,203 @@ class StockFactory : public std::enable_shared_from_this<StockFactory> {
 
 }  // namespace version5
 
+namespace version6 {
+
+// weak_ptr with weak_from_this, lock-free lookups on an immutable snapshot.
+// Readers never take mtx_: they announce themselves in a thread local
+// ReaderState, look the key up in the published map and leave. Misses and
+// deletions copy the map, publish the copy and wait until every reader has
+// left the old one before freeing it(a grace period, RCU style).
+class StockFactory : public std::enable_shared_from_this<StockFactory> {
+  class ReaderState;
+  class TLSMgr;
+ public:
+  using StockPtr = std::shared_ptr<Stock>;
+
+  StockFactory();
+  ~StockFactory();
+
+  StockFactory(const StockFactory&) = delete;
+  StockFactory& operator=(const StockFactory&) = delete;
+
+  StockPtr GetStock(const std::string& key);
+
+ private:
+  using StockMap = std::unordered_map<std::string, std::weak_ptr<Stock>>;
+
+  StockPtr LookUp(const std::string& key);
+  StockPtr CreateStock(const std::string& key);
+  static void StockDeleter(const std::weak_ptr<StockFactory>& wptr, Stock* stock);
+  void RemoveStock(Stock* stock);
+
+  void Publish(const StockMap* new_map);
+  void WaitReadersDone();
+  void AddReaderState(ReaderState* reader_state);
+  void RemoveReaderState(ReaderState* reader_state);
+
+ private:
+  MutexLock mtx_;  // Sequence writers
+  std::atomic<const StockMap*> stock_factory_;
+  MutexLock list_mtx_;  // Sequence access to reader_state_list_
+  std::vector<ReaderState*> reader_state_list_;
+  std::unique_ptr<TLSMgr> tls_mgr_;
+};
+
+}  // namespace version6
+
+namespace version7 {
+
+// weak_ptr with weak_from_this, pooled allocation.
+// A stock and its control block come from one PoolAllocator block through
+// allocate_shared, so there is no custom deleter any more: the stock removes
+// itself from the factory in its destructor.
+class StockFactory : public std::enable_shared_from_this<StockFactory> {
+  class PooledStock;
+ public:
+  using StockPtr = std::shared_ptr<Stock>;
+
+  StockFactory() = default;
+
+  StockFactory(const StockFactory&) = delete;
+  StockFactory& operator=(const StockFactory&) = delete;
+
+  StockPtr GetStock(const std::string& key);
+
+ private:
+  void RemoveStock(Stock* stock);
+
+ private:
+  MutexLock mtx_;
+  std::unordered_map<std::string, std::weak_ptr<Stock>> stock_factory_;
+};
+
+}  // namespace version7
+
+namespace version8 {
+
+// Stock holding an interned key: GetKey() is a view into KeyTable, no copy.
+class Stock {
+ public:
+  explicit Stock(const InternedKey& key) : key_(key) {}
+  std::string_view GetKey() const { return key_.key; }
+  const InternedKey& GetInternedKey() const { return key_; }
+
+ private:
+  InternedKey key_;
+};
+
+// weak_ptr with weak_from_this, pooled allocation, string_view lookups.
+// The map is keyed by InternedKey, so a lookup hashes the caller's view once
+// and allocates nothing on a hit; RemoveStock reuses the stock's cached hash.
+class StockFactory : public std::enable_shared_from_this<StockFactory> {
+  class PooledStock;
+ public:
+  using StockPtr = std::shared_ptr<Stock>;
+
+  StockFactory() = default;
+
+  StockFactory(const StockFactory&) = delete;
+  StockFactory& operator=(const StockFactory&) = delete;
+
+  StockPtr GetStock(std::string_view key);
+
+ private:
+  void RemoveStock(Stock* stock);
+
+ private:
+  MutexLock mtx_;
+  std::unordered_map<InternedKey, std::weak_ptr<Stock>, InternedKeyHash> stock_factory_;
+};
+
+}  // namespace version8
+
+namespace version9 {
+
+using version8::Stock;
+
+// weak_ptr with weak_from_this, pooled allocation, string_view lookups,
+// sharded by key hash with batch lookup and release.
+// A batch is sorted by shard and every shard it touches is locked once.
+class StockFactory : public std::enable_shared_from_this<StockFactory> {
+  class PooledStock;
+ public:
+  using StockPtr = std::shared_ptr<Stock>;
+
+  static constexpr size_t kShardNum = 16;
+
+  StockFactory() = default;
+
+  StockFactory(const StockFactory&) = delete;
+  StockFactory& operator=(const StockFactory&) = delete;
+
+  StockPtr GetStock(std::string_view key);
+
+  // Resolves keys[0, count) into stocks[0, count). What stocks held before
+  // is released after every shard lock is let go.
+  void GetStocks(const std::string_view* keys, size_t count, StockPtr* stocks);
+
+  // Drops stocks[0, count), all of which must come from this factory.
+  // Entries of the stocks that die are erased in one locked pass per shard
+  // instead of one lock acquisition per stock.
+  void ReleaseStocks(StockPtr* stocks, size_t count);
+
+ private:
+  struct alignas(64) Shard {
+    MutexLock mtx;
+    std::unordered_map<InternedKey, std::weak_ptr<Stock>, InternedKeyHash> stock_factory;
+  };
+
+  Shard& GetShard(size_t hash) { return shards_[hash % kShardNum]; }
+  StockPtr GetStockLocked(Shard* shard, const InternedKey& probe);
+  void RemoveStock(Stock* stock);
+
+ private:
+  Shard shards_[kShardNum];
+};
+
+}  // namespace version9
+
+namespace version10 {
+
+using version8::Stock;
+
+// weak_ptr with weak_from_this, deferred reclamation.
+// The deleter only pushes the dead stock onto a lock-free retire list; a
+// background reclaimer erases the map entries in one locked pass per factory
+// and destroys the stocks. The retire list length is bounded: the thread that
+// pushes it past kMaxBacklog reclaims the backlog itself.
+class StockFactory : public std::enable_shared_from_this<StockFactory> {
+  class RetirableStock;
+  class Reclaimer;
+ public:
+  using StockPtr = std::shared_ptr<Stock>;
+
+  static constexpr size_t kReclaimBatch = 256;
+  static constexpr size_t kMaxBacklog = 16 * kReclaimBatch;
+
+  StockFactory() = default;
+
+  StockFactory(const StockFactory&) = delete;
+  StockFactory& operator=(const StockFactory&) = delete;
+
+  StockPtr GetStock(std::string_view key);
+
+  // Drains the global retire list in the calling thread: every stock that
+  // any thread retired, from any factory, is reclaimed on return.
+  static void FlushRetired();
+
+ private:
+  struct StockDeleter {
+    void operator()(Stock* stock) const;
+  };
+
+  void RemoveStocks(RetirableStock** stocks, size_t count);
+
+ private:
+  MutexLock mtx_;
+  std::unordered_map<InternedKey, std::weak_ptr<Stock>, InternedKeyHash> stock_factory_;
+};
+
+}  // namespace version10
+
 }  // namespace mymuduo
@@ -0,0 +1,109 @@
+#include "arena.h"
+
+#include <stdlib.h>
+
+#include "thread_local.h"
+
+namespace mymuduo {
+
+Arena::Arena(size_t chunk_size) : chunk_size_(chunk_size) {}
+
+Arena::~Arena() {
+  Reset();
+  while (free_chunks_) {
+    Chunk* next = free_chunks_->next;
+    free(free_chunks_);
+    free_chunks_ = next;
+  }
+}
+
+void Arena::Reset() {
+  while (chunks_) {
+    Chunk* next = chunks_->next;
+    if (chunks_->size == chunk_size_) {
+      chunks_->next = free_chunks_;
+      free_chunks_ = chunks_;
+    } else {
+      bytes_reserved_ -= sizeof(Chunk) + chunks_->size;
+      free(chunks_);
+    }
+    chunks_ = next;
+  }
+  chunk_begin_ = cur_ = end_ = nullptr;
+  bytes_used_ = 0;
+}
+
+void* Arena::AllocateSlow(size_t bytes, size_t alignment) {
+  // Big requests get a chunk of their own and leave the current one alone.
+  if (bytes + alignment > chunk_size_ / 4) {
+    Chunk* chunk = NewChunk(bytes + alignment);
+    if (chunks_) {
+      chunk->next = chunks_->next;
+      chunks_->next = chunk;
+    } else {
+      chunk->next = nullptr;
+      chunks_ = chunk;
+    }
+    bytes_used_ += chunk->size;
+    uintptr_t ptr = reinterpret_cast<uintptr_t>(chunk + 1);
+    return reinterpret_cast<void*>((ptr + alignment - 1) & ~(alignment - 1));
+  }
+
+  Chunk* chunk = free_chunks_;
+  if (chunk) {
+    free_chunks_ = chunk->next;
+  } else {
+    chunk = NewChunk(chunk_size_);
+  }
+  UseChunk(chunk);
+  return Allocate(bytes, alignment);
+}
+
+Arena::Chunk* Arena::NewChunk(size_t size) {
+  auto* chunk = static_cast<Chunk*>(malloc(sizeof(Chunk) + size));
+  if (!chunk) {
+    throw std::bad_alloc();
+  }
+  chunk->next = nullptr;
+  chunk->size = size;
+  bytes_reserved_ += sizeof(Chunk) + size;
+  return chunk;
+}
+
+void Arena::UseChunk(Chunk* chunk) {
+  bytes_used_ += cur_ - chunk_begin_;
+  chunk->next = chunks_;
+  chunks_ = chunk;
+  chunk_begin_ = cur_ = reinterpret_cast<char*>(chunk + 1);
+  end_ = cur_ + chunk->size;
+}
+
+namespace ThreadArena {
+
+namespace {
+
+struct ArenaHolder {
+  ArenaHolder() : resource(&arena) {}
+
+  Arena arena;
+  ArenaResource resource;
+};
+
+ThreadLocal<ArenaHolder>& GetHolder() {
+  static ThreadLocal<ArenaHolder>* holder = new ThreadLocal<ArenaHolder>;  // outlives every thread
+  return *holder;
+}
+
+}  // namespace
+
+Arena& GetArena() {
+  return GetHolder().value().arena;
+}
+
+ArenaResource* GetResource() {
+  return &GetHolder().value().resource;
+}
+
+}  // namespace ThreadArena
+
+}  // namespace mymuduo
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <memory_resource>
+#include <new>
+#include <utility>
+
+#include "common.h"
+
+namespace mymuduo {
+
+// Chunked bump allocator.
+// Allocate() bumps a pointer inside the current chunk; nothing is freed one
+// by one, Reset() drops everything at once and keeps the regular chunks for
+// the next round. Destructors are never run, so keep to trivially
+// destructible objects or to containers on ArenaResource whose memory is
+// the only thing they own.
+// Not thread safe: one arena per thread or per request.
+class Arena {
+ public:
+  static constexpr size_t kDefaultChunkSize = 64 * 1024;
+
+  explicit Arena(size_t chunk_size = kDefaultChunkSize);
+  ~Arena();
+
+  Arena(const Arena&) = delete;
+  Arena& operator=(const Arena&) = delete;
+
+  void* Allocate(size_t bytes, size_t alignment = alignof(max_align_t)) {
+    uintptr_t ptr = (reinterpret_cast<uintptr_t>(cur_) + alignment - 1) & ~(alignment - 1);
+    if (LIKELY(ptr + bytes <= reinterpret_cast<uintptr_t>(end_) && ptr)) {
+      cur_ = reinterpret_cast<char*>(ptr + bytes);
+      return reinterpret_cast<void*>(ptr);
+    }
+    return AllocateSlow(bytes, alignment);
+  }
+
+  template<typename T, typename... Args>
+  T* New(Args&&... args) {
+    return new (Allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+  }
+
+  // Releases every allocation at once.
+  void Reset();
+
+  // Bytes handed out since the last Reset(), alignment padding included.
+  size_t BytesUsed() const { return bytes_used_ + (cur_ - chunk_begin_); }
+
+  // Bytes held from the system, retained chunks included.
+  size_t BytesReserved() const { return bytes_reserved_; }
+
+ private:
+  struct Chunk {
+    Chunk* next;
+    size_t size;  // bytes after the header
+  };
+
+  void* AllocateSlow(size_t bytes, size_t alignment);
+  Chunk* NewChunk(size_t size);
+  void UseChunk(Chunk* chunk);
+
+ private:
+  size_t chunk_size_;
+  Chunk* chunks_{nullptr};       // in use, newest first
+  Chunk* free_chunks_{nullptr};  // regular chunks kept by Reset()
+  char* chunk_begin_{nullptr};
+  char* cur_{nullptr};
+  char* end_{nullptr};
+  size_t bytes_used_{0};         // in chunks before the current one
+  size_t bytes_reserved_{0};
+};
+
+// std::pmr adapter, deallocation is a no-op until the arena is Reset().
+class ArenaResource : public std::pmr::memory_resource {
+ public:
+  explicit ArenaResource(Arena* arena) : arena_(arena) {}
+
+  ArenaResource(const ArenaResource&) = delete;
+  ArenaResource& operator=(const ArenaResource&) = delete;
+
+  Arena* arena() const { return arena_; }
+
+ private:
+  void* do_allocate(size_t bytes, size_t alignment) override {
+    return arena_->Allocate(bytes, alignment);
+  }
+
+  void do_deallocate(void*, size_t, size_t) override {}
+
+  bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+    return this == &other;
+  }
+
+ private:
+  Arena* arena_;
+};
+
+namespace ThreadArena {
+
+// The calling thread's arena, created on first use and freed at thread exit.
+Arena& GetArena();
+ArenaResource* GetResource();
+
+}  // namespace ThreadArena
+
+}  // namespace mymuduo
@@ -0,0 +1,80 @@
+#include <stdio.h>
+
+#include <memory_resource>
+#include <string>
+#include <vector>
+
+#include "arena.h"
+#include "bench.h"
+
+// A mixed small-allocation request: tokens, a growing vector and a small
+// parse tree, all dropped when the request is done.
+namespace {
+
+constexpr int kRequestNum = 1 << 16;  // per thread
+constexpr int kTokenNum = 16;
+constexpr int kValueNum = 64;
+constexpr int kNodeNum = 32;
+
+struct Node {
+  Node* left{nullptr};
+  Node* right{nullptr};
+  int val{0};
+};
+
+const char kText[] = "a moderately long market data token that spills out of SSO";
+
+void Request(std::pmr::memory_resource* resource, int64_t i) {
+  std::pmr::vector<std::pmr::string> tokens(resource);
+  for (int t = 0; t < kTokenNum; ++t) {
+    tokens.emplace_back(kText, 8 + (i + t) % 32);
+  }
+
+  std::pmr::vector<int> values(resource);
+  for (int v = 0; v < kValueNum; ++v) {
+    values.emplace_back(v);
+  }
+
+  Node* nodes[kNodeNum];
+  for (int n = 0; n < kNodeNum; ++n) {
+    nodes[n] = new (resource->allocate(sizeof(Node), alignof(Node))) Node;
+    nodes[n]->val = n;
+    if (n) {
+      auto* parent = nodes[(n - 1) / 2];
+      (n % 2 ? parent->left : parent->right) = nodes[n];
+    }
+  }
+  mymuduo::bench::DoNotOptimize(nodes[kNodeNum - 1]->val + tokens.back().size() + values.back());
+  for (auto* node : nodes) {
+    resource->deallocate(node, sizeof(Node), alignof(Node));
+  }
+}
+
+void MallocRequest(int64_t i) {
+  Request(std::pmr::new_delete_resource(), i);
+}
+
+void ArenaRequest(int64_t i) {
+  auto* resource = mymuduo::ThreadArena::GetResource();
+  Request(resource, i);
+  resource->arena()->Reset();
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  mymuduo::bench::Options options;
+  options.reader_nums = {16};
+  options.writer_nums = {0};
+  if (!mymuduo::bench::ParseOptions(argc, argv, &options)) {
+    fprintf(stderr, "usage: %s [--readers=16] [--repeats=3] [--read-iters=N] "
+                    "[--format=text|json|csv] [--perf-counters=0|1]\n", argv[0]);
+    return 1;
+  }
+
+  mymuduo::bench::Harness harness(options);
+  harness.Run(mymuduo::bench::MakeWorkload("request/malloc", MallocRequest, kRequestNum));
+  harness.Run(mymuduo::bench::MakeWorkload("request/arena", ArenaRequest, kRequestNum));
+  harness.Report(stdout);
+  return 0;
+}
@@ -0,0 +1,602 @@
+#include "binary_log.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "condition.h"
+#include "current_thread.h"
+#include "mmap_log_file.h"
+#include "mutex.h"
+#include "thread_local.h"
+
+namespace mymuduo {
+
+namespace internal {
+
+__thread BinaryLogBuffer* t_binary_log_buffer = nullptr;
+
+}  // namespace internal
+
+namespace {
+
+using internal::BinaryLogBuffer;
+
+// Record types in the file, one MmapLogFile record each.
+enum BlockType : uint8_t {
+  kCalibration,  // tsc0, ns0, tsc, ns: two points of timestamp vs wall clock
+  kSite,         // id, line, file length, file, format length, format
+  kEntries,      // tid, entries as the thread buffer holds them
+  kDropped,      // tid, count
+};
+
+// Entries of one thread per kEntries block at most, unless one is larger;
+// a quarter of the segment if that is less.
+const size_t kMaxBlockBytes = 64 * 1024;
+
+MutexLock g_sites_mutex;
+std::vector<const BinaryLog::Site*> g_sites;  // guarded by g_sites_mutex, id - 1
+
+std::atomic<uint64_t> g_dropped{0};
+
+MutexLock g_buffers_mutex;
+std::vector<BinaryLogBuffer*> g_buffers;  // guarded by g_buffers_mutex
+
+// Retires the buffer of its thread at exit.
+struct BufferHolder {
+  ~BufferHolder() {
+    if (buffer) {
+      internal::t_binary_log_buffer = nullptr;
+      buffer->retired.store(true, std::memory_order_release);
+    }
+  }
+
+  BinaryLogBuffer* buffer{nullptr};
+};
+
+ThreadLocal<BufferHolder> g_buffer_holders;
+
+uint64_t NowNanoseconds() {
+  struct timespec ts;
+  clock_gettime(CLOCK_REALTIME, &ts);
+  return static_cast<uint64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+template <typename T>
+void Put(std::string* block, T value) {
+  block->append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+template <typename T>
+T Get(const char* p) {
+  T value;
+  memcpy(&value, p, sizeof(value));
+  return value;
+}
+
+class Writer {
+ public:
+  Writer(const std::string& basename, double flush_interval, size_t segment_bytes)
+      : file_(basename, segment_bytes),
+        max_block_bytes_(std::min(kMaxBlockBytes, segment_bytes / 4)),
+        flush_interval_(flush_interval),
+        cond_(mtx_),
+        tsc0_(BinaryLog::Timestamp()),
+        ns0_(NowNanoseconds()) {
+    file_.SetSegmentCallback([this]() { StartSegment(); });
+    // The first calibration spans at least this much.
+    ::usleep(10 * 1000);
+    MCHECK(pthread_create(&thread_, nullptr, ThreadRoutine, this));
+  }
+
+  ~Writer() {
+    {
+      MutexLockGuard lock(mtx_);
+      running_ = false;
+      cond_.NotifyAll();
+    }
+    MCHECK(pthread_join(thread_, nullptr));
+  }
+
+  void Flush() {
+    MutexLockGuard lock(mtx_);
+    const uint64_t generation = ++flush_requested_;
+    cond_.NotifyAll();
+    while (flush_done_ < generation) {
+      cond_.Wait();
+    }
+  }
+
+ private:
+  static void* ThreadRoutine(void* arg) {
+    static_cast<Writer*>(arg)->Run();
+    return nullptr;
+  }
+
+  void Run() {
+    bool running = true;
+    while (running) {
+      uint64_t generation = 0;
+      {
+        MutexLockGuard lock(mtx_);
+        if (running_ && flush_done_ == flush_requested_) {
+          cond_.WaitForSeconds(flush_interval_);
+        }
+        generation = flush_requested_;
+        running = running_;
+      }
+      DrainAll();
+      MutexLockGuard lock(mtx_);
+      flush_done_ = generation;
+      cond_.NotifyAll();
+    }
+  }
+
+  void DrainAll() {
+    std::vector<BinaryLogBuffer*> buffers;
+    {
+      MutexLockGuard lock(g_buffers_mutex);
+      buffers = g_buffers;
+    }
+    const uint64_t ns = NowNanoseconds();
+    if (ns - last_calibration_ns_ >= 1000000000) {
+      WriteCalibration();
+    }
+    for (BinaryLogBuffer* buffer : buffers) {
+      // Retired before its head is read: nothing comes after that head.
+      const bool retired = buffer->retired.load(std::memory_order_acquire);
+      const uint64_t head = buffer->head();
+      // Sites are registered before their first entry is committed.
+      WriteNewSites();
+      Drain(buffer, head);
+      const uint64_t dropped = buffer->TakeDropped();
+      if (dropped > 0) {
+        g_dropped.fetch_add(dropped, std::memory_order_relaxed);
+        std::string block(1, static_cast<char>(kDropped));
+        Put<int32_t>(&block, buffer->tid());
+        Put<uint64_t>(&block, dropped);
+        file_.Append(block.data(), block.size());
+      }
+      if (retired) {
+        MutexLockGuard lock(g_buffers_mutex);
+        g_buffers.erase(std::find(g_buffers.begin(), g_buffers.end(), buffer));
+        delete buffer;
+      }
+    }
+    file_.Flush();
+  }
+
+  // Copies the entries in runs that do not cross the end of the ring.
+  void Drain(BinaryLogBuffer* buffer, uint64_t head) {
+    const uint64_t mask = BinaryLogBuffer::kCapacity - 1;
+    uint64_t pos = buffer->tail();
+    uint64_t run_begin = pos;
+    while (pos < head) {
+      const uint32_t id = Get<uint32_t>(buffer->At(pos));
+      const uint32_t size = id == 0 ? 0 : Get<uint32_t>(buffer->At(pos) + 4);
+      const bool split =
+          pos > run_begin && ((pos & mask) == 0 || pos + size - run_begin > max_block_bytes_);
+      if (id == 0 || split) {
+        WriteEntries(buffer, run_begin, pos);
+        if (id == 0) {
+          pos += BinaryLogBuffer::kCapacity - (pos & mask);
+        }
+        run_begin = pos;
+        continue;
+      }
+      pos += size;
+    }
+    WriteEntries(buffer, run_begin, pos);
+    buffer->Release(head);
+  }
+
+  void WriteEntries(BinaryLogBuffer* buffer, uint64_t begin, uint64_t end) {
+    if (begin == end) {
+      return;
+    }
+    block_.assign(1, static_cast<char>(kEntries));
+    Put<int32_t>(&block_, buffer->tid());
+    block_.append(buffer->At(begin), end - begin);
+    file_.Append(block_.data(), block_.size());
+  }
+
+  void WriteCalibration() {
+    last_calibration_ns_ = NowNanoseconds();
+    std::string block(1, static_cast<char>(kCalibration));
+    Put<uint64_t>(&block, tsc0_);
+    Put<uint64_t>(&block, ns0_);
+    Put<uint64_t>(&block, BinaryLog::Timestamp());
+    Put<uint64_t>(&block, last_calibration_ns_);
+    file_.Append(block.data(), block.size());
+  }
+
+  // A roll in Append() writes the whole dictionary again from
+  // StartSegment(), so nothing here is held across it.
+  void WriteNewSites() {
+    for (;;) {
+      const BinaryLog::Site* site = nullptr;
+      {
+        MutexLockGuard lock(g_sites_mutex);
+        if (sites_written_ >= g_sites.size()) {
+          break;
+        }
+        site = g_sites[sites_written_++];
+      }
+      const uint32_t file_len = static_cast<uint32_t>(strlen(site->file));
+      const uint32_t format_len = static_cast<uint32_t>(strlen(site->format));
+      std::string block(1, static_cast<char>(kSite));
+      Put<uint32_t>(&block, static_cast<uint32_t>(sites_written_));
+      Put<int32_t>(&block, site->line);
+      Put<uint32_t>(&block, file_len);
+      block.append(site->file, file_len);
+      Put<uint32_t>(&block, format_len);
+      block.append(site->format, format_len);
+      file_.Append(block.data(), block.size());
+    }
+  }
+
+  // Every segment can be decoded alone.
+  void StartSegment() {
+    sites_written_ = 0;
+    WriteCalibration();
+    WriteNewSites();
+  }
+
+ private:
+  MmapLogFile file_;
+  const size_t max_block_bytes_;
+  const double flush_interval_;
+  MutexLock mtx_;
+  Condition cond_;
+  bool running_{true};
+  uint64_t flush_requested_{0};  // guarded by mtx_
+  uint64_t flush_done_{0};       // guarded by mtx_
+  pthread_t thread_;
+
+  // The writer thread's.
+  const uint64_t tsc0_;
+  const uint64_t ns0_;
+  uint64_t last_calibration_ns_{0};
+  size_t sites_written_{0};  // in the current segment
+  std::string block_;        // for WriteEntries() only
+};
+
+std::unique_ptr<Writer> g_writer;
+
+// Appends one conversion of spec, length modifiers stripped, to out.
+template <typename T>
+void AppendFormatted(std::string* out, const std::string& spec, T value) {
+  char buf[128];
+  const int n = snprintf(buf, sizeof(buf), spec.c_str(), value);
+  if (n < 0) {
+    return;
+  }
+  if (static_cast<size_t>(n) < sizeof(buf)) {
+    out->append(buf, n);
+  } else {
+    const size_t old_size = out->size();
+    out->resize(old_size + n + 1);
+    snprintf(&(*out)[old_size], n + 1, spec.c_str(), value);
+    out->resize(old_size + n);
+  }
+}
+
+struct Arg {
+  uint8_t type;
+  uint64_t bits;
+  std::string_view str;
+};
+
+// printf over decoded arguments, one conversion at a time: the integer
+// conversions get "ll" since every integer was stored as 64 bits.
+void Format(const char* format, const std::vector<Arg>& args, std::string* out) {
+  size_t next_arg = 0;
+  for (const char* p = format; *p;) {
+    if (*p != '%') {
+      const char* percent = strchr(p, '%');
+      const size_t len = percent ? static_cast<size_t>(percent - p) : strlen(p);
+      out->append(p, len);
+      p += len;
+      continue;
+    }
+    if (p[1] == '%') {
+      out->push_back('%');
+      p += 2;
+      continue;
+    }
+    std::string spec(1, '%');
+    ++p;
+    while (*p && strchr("-+ #0'", *p)) spec.push_back(*p++);
+    while (*p && (isdigit(static_cast<unsigned char>(*p)) || *p == '.')) spec.push_back(*p++);
+    while (*p && strchr("hlLqjzt", *p)) ++p;
+    const char conversion = *p;
+    if (!conversion) {
+      break;
+    }
+    ++p;
+    if (next_arg >= args.size()) {
+      out->append(spec).push_back(conversion);
+      continue;
+    }
+    const Arg& arg = args[next_arg++];
+    if (conversion == 's' && arg.type != BinaryLog::kString) {
+      out->append("(?)");
+      continue;
+    }
+    double d = 0;
+    memcpy(&d, &arg.bits, sizeof(d));
+    const int64_t i = arg.type == BinaryLog::kDouble ? static_cast<int64_t>(d)
+                                                     : static_cast<int64_t>(arg.bits);
+    switch (conversion) {
+      case 'd':
+      case 'i':
+        AppendFormatted(out, spec + "ll" + conversion, static_cast<long long>(i));
+        break;
+      case 'u':
+      case 'o':
+      case 'x':
+      case 'X':
+        AppendFormatted(out, spec + "ll" + conversion, static_cast<unsigned long long>(i));
+        break;
+      case 'c':
+        AppendFormatted(out, spec + conversion, static_cast<int>(i));
+        break;
+      case 'e':
+      case 'E':
+      case 'f':
+      case 'F':
+      case 'g':
+      case 'G':
+      case 'a':
+      case 'A':
+        AppendFormatted(out, spec + conversion,
+                        arg.type == BinaryLog::kDouble ? d : static_cast<double>(i));
+        break;
+      case 's':
+        AppendFormatted(out, spec + conversion, std::string(arg.str).c_str());
+        break;
+      case 'p':
+        AppendFormatted(out, spec + conversion, reinterpret_cast<void*>(arg.bits));
+        break;
+      default:
+        out->append(spec).push_back(conversion);
+        break;
+    }
+  }
+}
+
+// Reads one entry, the header excluded; false if it is malformed.
+bool DecodeArgs(const char* p, const char* end, std::vector<Arg>* args) {
+  args->clear();
+  while (p < end) {
+    Arg arg;
+    arg.type = static_cast<uint8_t>(*p);
+    if (arg.type == BinaryLog::kString) {
+      if (end - p < 5) {
+        return false;
+      }
+      const uint32_t len = Get<uint32_t>(p + 1);
+      if (static_cast<size_t>(end - p - 5) < len) {
+        return false;
+      }
+      arg.bits = 0;
+      arg.str = std::string_view(p + 5, len);
+      p += 5 + len;
+    } else if (arg.type <= BinaryLog::kPointer) {
+      if (end - p < 9) {
+        return false;
+      }
+      arg.bits = Get<uint64_t>(p + 1);
+      p += 9;
+    } else if (arg.type == BinaryLog::kEnd) {
+      break;
+    } else {
+      return false;
+    }
+    args->push_back(arg);
+  }
+  return true;
+}
+
+struct SiteInfo {
+  int line;
+  std::string file;
+  std::string format;
+};
+
+class Decoder {
+ public:
+  explicit Decoder(FILE* out) : out_(out) {}
+
+  int64_t decoded() const { return decoded_; }
+
+  void OnRecord(const char* data, size_t len) {
+    if (len == 0) {
+      return;
+    }
+    const char* end = data + len;
+    const char* p = data + 1;
+    switch (static_cast<uint8_t>(data[0])) {
+      case kCalibration:
+        if (len >= 33) {
+          tsc0_ = Get<uint64_t>(p);
+          ns0_ = Get<uint64_t>(p + 8);
+          tsc1_ = Get<uint64_t>(p + 16);
+          ns1_ = Get<uint64_t>(p + 24);
+        }
+        break;
+      case kSite:
+        OnSite(p, end);
+        break;
+      case kEntries:
+        if (len >= 5) {
+          OnEntries(Get<int32_t>(p), p + 4, end);
+        }
+        break;
+      case kDropped:
+        if (len >= 13) {
+          fprintf(out_, "tid %d dropped %llu entries\n", Get<int32_t>(p),
+                  static_cast<unsigned long long>(Get<uint64_t>(p + 4)));
+        }
+        break;
+      default:
+        break;
+    }
+  }
+
+ private:
+  void OnSite(const char* p, const char* end) {
+    if (end - p < 12) {
+      return;
+    }
+    const uint32_t id = Get<uint32_t>(p);
+    SiteInfo& site = sites_[id];
+    site.line = Get<int32_t>(p + 4);
+    const uint32_t file_len = Get<uint32_t>(p + 8);
+    p += 12;
+    if (static_cast<size_t>(end - p) < file_len + 4) {
+      return;
+    }
+    site.file.assign(p, file_len);
+    p += file_len;
+    const uint32_t format_len = Get<uint32_t>(p);
+    p += 4;
+    site.format.assign(p, std::min<size_t>(format_len, end - p));
+  }
+
+  void OnEntries(int tid, const char* p, const char* end) {
+    while (end - p >= static_cast<ptrdiff_t>(BinaryLog::kEntryHeaderSize)) {
+      const uint32_t id = Get<uint32_t>(p);
+      const uint32_t size = Get<uint32_t>(p + 4);
+      if (size < BinaryLog::kEntryHeaderSize || size > static_cast<size_t>(end - p)) {
+        return;
+      }
+      const uint64_t timestamp = Get<uint64_t>(p + 8);
+      line_.clear();
+      AppendTime(timestamp);
+      line_.append(" ").append(std::to_string(tid)).append(" ");
+      auto it = sites_.find(id);
+      if (it == sites_.end() ||
+          !DecodeArgs(p + BinaryLog::kEntryHeaderSize, p + size, &args_)) {
+        line_.append("(unknown site ").append(std::to_string(id)).append(")\n");
+      } else {
+        Format(it->second.format.c_str(), args_, &line_);
+        line_.append(" - ").append(it->second.file).append(":");
+        line_.append(std::to_string(it->second.line)).append("\n");
+      }
+      fwrite(line_.data(), 1, line_.size(), out_);
+      ++decoded_;
+      p += size;
+    }
+  }
+
+  void AppendTime(uint64_t timestamp) {
+    int64_t ns = static_cast<int64_t>(timestamp);
+#if defined(__x86_64__) || defined(__i386__)
+    if (tsc1_ > tsc0_) {
+      const double ns_per_tick =
+          static_cast<double>(ns1_ - ns0_) / static_cast<double>(tsc1_ - tsc0_);
+      const double ticks = static_cast<double>(static_cast<int64_t>(timestamp - tsc0_));
+      ns = static_cast<int64_t>(ns0_) + static_cast<int64_t>(ticks * ns_per_tick);
+    } else {
+      ns = static_cast<int64_t>(ns0_);
+    }
+#endif
+    const time_t seconds = static_cast<time_t>(ns / 1000000000);
+    struct tm tm;
+    gmtime_r(&seconds, &tm);
+    char buf[64];
+    snprintf(buf, sizeof(buf), "%4d%02d%02d %02d:%02d:%02d.%06dZ", tm.tm_year + 1900,
+             tm.tm_mon + 1, tm.tm_mday, tm.tm_hour, tm.tm_min, tm.tm_sec,
+             static_cast<int>(ns % 1000000000 / 1000));
+    line_.append(buf);
+  }
+
+ private:
+  FILE* const out_;
+  std::unordered_map<uint32_t, SiteInfo> sites_;
+  uint64_t tsc0_{0};
+  uint64_t ns0_{0};
+  uint64_t tsc1_{0};
+  uint64_t ns1_{0};
+  std::vector<Arg> args_;
+  std::string line_;
+  int64_t decoded_{0};
+};
+
+}  // namespace
+
+namespace internal {
+
+BinaryLogBuffer* NewThreadBinaryLogBuffer() {
+  BinaryLogBuffer* buffer = new BinaryLogBuffer(CurrentThread::Tid());
+  g_buffer_holders.value().buffer = buffer;
+  {
+    MutexLockGuard lock(g_buffers_mutex);
+    g_buffers.push_back(buffer);
+  }
+  t_binary_log_buffer = buffer;
+  return buffer;
+}
+
+}  // namespace internal
+
+uint32_t BinaryLog::Register(const Site* site) {
+  MutexLockGuard lock(g_sites_mutex);
+  g_sites.push_back(site);
+  return static_cast<uint32_t>(g_sites.size());
+}
+
+void BinaryLog::Start(const std::string& basename, double flush_interval, size_t segment_bytes) {
+  assert(!g_writer);
+  g_writer.reset(new Writer(basename, flush_interval, segment_bytes));
+}
+
+void BinaryLog::Stop() {
+  g_writer.reset();
+}
+
+void BinaryLog::Flush() {
+  if (g_writer) {
+    g_writer->Flush();
+  }
+}
+
+uint64_t BinaryLog::Dropped() {
+  return g_dropped.load(std::memory_order_relaxed);
+}
+
+int64_t BinaryLog::DecodeFile(const std::string& filename, FILE* out) {
+  const int fd = ::open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return -1;
+  }
+  struct stat st;
+  if (::fstat(fd, &st) < 0) {
+    ::close(fd);
+    return -1;
+  }
+  Decoder decoder(out);
+  if (st.st_size > 0) {
+    void* data = ::mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED) {
+      ::close(fd);
+      return -1;
+    }
+    MmapLogFile::Scan(static_cast<const char*>(data), st.st_size,
+                      [&decoder](const char* record, size_t len) {
+                        decoder.OnRecord(record, len);
+                      });
+    ::munmap(data, st.st_size);
+  }
+  ::close(fd);
+  return decoder.decoded();
+}
+
+}  // namespace mymuduo
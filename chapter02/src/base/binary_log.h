@@ -0,0 +1,226 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include <atomic>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+#include "common.h"
+
+// Logs a printf style line without formatting it: the hot path stores the
+// id of the call site, a timestamp and the raw arguments in a buffer of
+// the calling thread, a background thread writes them out as they are and
+// BinaryLog::DecodeFile() formats them later. The format must be a string
+// literal; it is checked like printf's, so strings go as const char*.
+//   BLOG("tid=%d, addr=%p", CurrentThread::Tid(), this);
+#define BLOG(fmt, ...)                                                                 \
+  do {                                                                                 \
+    static const ::mymuduo::BinaryLog::Site blog_site_ = {fmt, __FILE__, __LINE__};    \
+    static const uint32_t blog_site_id_ = ::mymuduo::BinaryLog::Register(&blog_site_); \
+    if (false) ::mymuduo::BinaryLog::CheckFormat(fmt, ##__VA_ARGS__);                  \
+    ::mymuduo::BinaryLog::Log(blog_site_id_, ##__VA_ARGS__);                           \
+  } while (0)
+
+namespace mymuduo {
+
+namespace internal {
+
+// Single producer, single consumer byte ring of one logging thread.
+// Entries are 8-byte aligned and never wrap: one that does not fit before
+// the end is put at the start, after a 0 id telling the reader to skip.
+class BinaryLogBuffer {
+ public:
+  static const size_t kCapacity = 1 << 20;
+
+  explicit BinaryLogBuffer(int tid) : data_(new char[kCapacity]), tid_(tid) {}
+  ~BinaryLogBuffer() { delete[] data_; }
+
+  BinaryLogBuffer(const BinaryLogBuffer&) = delete;
+  BinaryLogBuffer& operator=(const BinaryLogBuffer&) = delete;
+
+  // Producer. Null when full: the entry is dropped, the logging thread
+  // never waits.
+  char* Reserve(size_t size) {
+    const uint64_t head = head_.load(std::memory_order_relaxed);
+    const size_t offset = head & (kCapacity - 1);
+    const size_t skip = kCapacity - offset < size ? kCapacity - offset : 0;
+    if (head + skip + size - cached_tail_ > kCapacity) {
+      cached_tail_ = tail_.load(std::memory_order_acquire);
+      if (head + skip + size - cached_tail_ > kCapacity) {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        return nullptr;
+      }
+    }
+    if (skip) {
+      memset(data_ + offset, 0, sizeof(uint32_t));
+    }
+    reserved_ = head + skip;
+    return data_ + (reserved_ & (kCapacity - 1));
+  }
+  // Publishes the entry, and the skip before it.
+  void Commit(size_t size) { head_.store(reserved_ + size, std::memory_order_release); }
+
+  // Consumer.
+  uint64_t head() const { return head_.load(std::memory_order_acquire); }
+  uint64_t tail() const { return tail_.load(std::memory_order_relaxed); }
+  const char* At(uint64_t pos) const { return data_ + (pos & (kCapacity - 1)); }
+  void Release(uint64_t tail) { tail_.store(tail, std::memory_order_release); }
+  uint64_t TakeDropped() { return dropped_.exchange(0, std::memory_order_relaxed); }
+
+  int tid() const { return tid_; }
+  // Set when its thread exits, freed once drained.
+  std::atomic<bool> retired{false};
+
+ private:
+  char* const data_;
+  const int tid_;
+  alignas(64) std::atomic<uint64_t> head_{0};
+  uint64_t cached_tail_{0};
+  uint64_t reserved_{0};
+  std::atomic<uint64_t> dropped_{0};
+  alignas(64) std::atomic<uint64_t> tail_{0};
+};
+
+extern __thread BinaryLogBuffer* t_binary_log_buffer;
+BinaryLogBuffer* NewThreadBinaryLogBuffer();
+
+}  // namespace internal
+
+class BinaryLog {
+ public:
+  struct Site {
+    const char* format;
+    const char* file;
+    int line;
+  };
+
+  // Argument type tags in the log; kEnd starts the padding, if any.
+  enum ArgType : uint8_t { kInt, kUint, kDouble, kPointer, kString, kEnd = 0xff };
+  // id, entry bytes, timestamp.
+  static const size_t kEntryHeaderSize = 16;
+
+  // Starts the thread writing every flush_interval seconds to MmapLogFile
+  // segments named after basename.
+  static void Start(const std::string& basename, double flush_interval = 0.1,
+                    size_t segment_bytes = 64 * 1024 * 1024);
+  // Writes out what is buffered, stops the thread and closes the file.
+  static void Stop();
+  // Returns once everything logged before the call is written.
+  static void Flush();
+  // Entries dropped for a full thread buffer, as far as written out.
+  static uint64_t Dropped();
+
+  // Formats a segment written by the thread, one line per entry:
+  // date time.microseconds tid message - file:line.
+  // Returns the entries decoded, -1 if the file cannot be read.
+  static int64_t DecodeFile(const std::string& filename, FILE* out);
+
+  // For BLOG.
+  static uint32_t Register(const Site* site);
+  static void CheckFormat(const char*, ...) __attribute__((format(printf, 1, 2))) {}
+
+  template <typename... Args>
+  static void Log(uint32_t site_id, const Args&... args) {
+    const size_t size =
+        (kEntryHeaderSize + (size_t{0} + ... + EncodedSize(args)) + 7) & ~size_t{7};
+    internal::BinaryLogBuffer* buffer = internal::t_binary_log_buffer;
+    if (UNLIKELY(!buffer)) {
+      buffer = internal::NewThreadBinaryLogBuffer();
+    }
+    char* entry = buffer->Reserve(size);
+    if (UNLIKELY(!entry)) {
+      return;
+    }
+    const uint32_t size32 = static_cast<uint32_t>(size);
+    const uint64_t timestamp = Timestamp();
+    memcpy(entry, &site_id, sizeof(site_id));
+    memcpy(entry + 4, &size32, sizeof(size32));
+    memcpy(entry + 8, &timestamp, sizeof(timestamp));
+    char* p = entry + kEntryHeaderSize;
+    ((p = Encode(p, args)), ...);
+    if (p != entry + size) {
+      *p = static_cast<char>(kEnd);
+    }
+    buffer->Commit(size);
+  }
+
+  // TSC ticks where there is one, converted when decoding; nanoseconds
+  // otherwise.
+  static uint64_t Timestamp() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+#endif
+  }
+
+ private:
+  template <typename T>
+  static constexpr bool IsString() {
+    return std::is_same_v<T, const char*> || std::is_same_v<T, char*>;
+  }
+
+  static std::string_view AsString(const char* s) { return s ? s : "(null)"; }
+
+  template <typename T>
+  static size_t EncodedSize(const T& arg) {
+    using U = std::decay_t<T>;
+    if constexpr (IsString<U>()) {
+      return 1 + sizeof(uint32_t) + AsString(arg).size();
+    } else {
+      return 1 + 8;
+    }
+  }
+
+  template <typename T>
+  static char* Encode(char* p, const T& arg) {
+    using U = std::decay_t<T>;
+    if constexpr (IsString<U>()) {
+      const std::string_view s = AsString(arg);
+      const uint32_t len = static_cast<uint32_t>(s.size());
+      *p = kString;
+      memcpy(p + 1, &len, sizeof(len));
+      memcpy(p + 1 + sizeof(len), s.data(), len);
+      return p + 1 + sizeof(len) + len;
+    } else {
+      static_assert(std::is_arithmetic_v<U> || std::is_enum_v<U> || std::is_pointer_v<U> ||
+                        std::is_null_pointer_v<U>,
+                    "BLOG takes numbers, pointers and C strings");
+      uint64_t bits = 0;
+      if constexpr (std::is_floating_point_v<U>) {
+        *p = kDouble;
+        const double d = arg;
+        memcpy(&bits, &d, sizeof(d));
+      } else if constexpr (std::is_pointer_v<U>) {
+        *p = kPointer;
+        bits = reinterpret_cast<uintptr_t>(arg);
+      } else if constexpr (std::is_null_pointer_v<U>) {
+        *p = kPointer;
+      } else if constexpr (std::is_enum_v<U>) {
+        *p = std::is_signed_v<std::underlying_type_t<U>> ? kInt : kUint;
+        bits = static_cast<uint64_t>(arg);
+      } else if constexpr (std::is_signed_v<U>) {
+        *p = kInt;
+        bits = static_cast<uint64_t>(static_cast<int64_t>(arg));
+      } else {
+        *p = kUint;
+        bits = static_cast<uint64_t>(arg);
+      }
+      memcpy(p + 1, &bits, sizeof(bits));
+      return p + 1 + 8;
+    }
+  }
+};
+
+}  // namespace mymuduo
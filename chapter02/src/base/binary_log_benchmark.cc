@@ -0,0 +1,75 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <string>
+
+#include "bench.h"
+#include "binary_log.h"
+#include "current_thread.h"
+
+// The same log line two ways: formatted with snprintf into a stack buffer
+// (what a formatting front end pays before any copy or lock), and BLOG
+// into the thread's buffer with the writer thread draining it to MmapLogFile
+// segments in a temporary directory under /tmp, removed at the end.
+namespace {
+
+constexpr int kLineNum = 1 << 14;  // per thread per run, well under a thread buffer
+
+const char* const kName = "bench";
+
+void Snprintf(int64_t i) {
+  char line[128];
+  snprintf(line, sizeof(line), "tid=%d, addr=%p, i=%lld, name=%s, %.3f",
+           mymuduo::CurrentThread::Tid(), static_cast<void*>(line), static_cast<long long>(i),
+           kName, i * 0.5);
+  asm volatile("" : : "r"(line) : "memory");
+}
+
+void BinaryLog(int64_t i) {
+  int local;
+  BLOG("tid=%d, addr=%p, i=%lld, name=%s, %.3f", mymuduo::CurrentThread::Tid(),
+       static_cast<void*>(&local), static_cast<long long>(i), kName, i * 0.5);
+}
+
+mymuduo::bench::Workload MakeWorkload(const char* name, mymuduo::bench::OpType op) {
+  mymuduo::bench::Workload workload;
+  workload.name = name;
+  workload.read_op = op;
+  workload.read_iter_num = kLineNum;
+  return workload;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  mymuduo::bench::Options options;
+  options.reader_nums = {1, 2, 4};
+  options.writer_nums = {0};
+  if (!mymuduo::bench::ParseOptions(argc, argv, &options)) {
+    fprintf(stderr, "usage: %s [--readers=1,2,4] [--repeats=3] [--read-iters=N] "
+                    "[--format=text|json|csv] [--perf-counters=0|1]\n", argv[0]);
+    return 1;
+  }
+  char dir[] = "/tmp/binary_log_benchmark.XXXXXX";
+  if (!::mkdtemp(dir)) {
+    perror("mkdtemp");
+    return 1;
+  }
+
+  mymuduo::bench::Harness harness(options);
+  harness.Run(MakeWorkload("log/snprintf", Snprintf));
+  mymuduo::BinaryLog::Start(std::string(dir) + "/blog", 0.01);
+  harness.Run(MakeWorkload("log/blog", BinaryLog));
+  mymuduo::BinaryLog::Stop();
+  const uint64_t dropped = mymuduo::BinaryLog::Dropped();
+  std::string cleanup = "rm -rf " + std::string(dir);
+  if (::system(cleanup.c_str()) != 0) {
+    fprintf(stderr, "could not remove %s\n", dir);
+  }
+
+  harness.Report(stdout);
+  printf("entries dropped: %llu\n",
+         static_cast<unsigned long long>(dropped));
+  return 0;
+}
@@ -0,0 +1,21 @@
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "binary_log.h"
+
+// Formats BinaryLog segments to stdout, in the order given.
+int main(int argc, char* argv[]) {
+  if (argc < 2) {
+    fprintf(stderr, "usage: %s segment...\n", argv[0]);
+    return 1;
+  }
+  int ret = 0;
+  for (int i = 1; i < argc; ++i) {
+    if (mymuduo::BinaryLog::DecodeFile(argv[i], stdout) < 0) {
+      fprintf(stderr, "%s: %s\n", argv[i], strerror(errno));
+      ret = 1;
+    }
+  }
+  return ret;
+}
@@ -1,8 +1,10 @@
 #pragma once
 
-ifndef NDEBUG
+#ifndef NDEBUG
 #include <assert.h>
 #endif
+#include <string.h>
+
 #include <type_traits>
 
 namespace mymuduo {
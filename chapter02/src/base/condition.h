@@ -1,6 +1,9 @@
 #pragma once
 
+#include <errno.h>
 #include <pthread.h>
+#include <stdint.h>
+#include <time.h>
 
 #include "common.h"
 #include "mutex.h"
@@ -20,6 +23,21 @@ class Condition {
 
   void Wait() { MCHECK(pthread_cond_wait(&cond_, mutex_lock_.GetMutex())); }
 
+  // True if it timed out.
+  bool WaitForSeconds(double seconds) {
+    struct timespec abstime;
+    clock_gettime(CLOCK_REALTIME, &abstime);
+    const int64_t nanoseconds = static_cast<int64_t>(seconds * 1e9) + abstime.tv_nsec;
+    abstime.tv_sec += static_cast<time_t>(nanoseconds / 1000000000);
+    abstime.tv_nsec = static_cast<long>(nanoseconds % 1000000000);
+    const int ret = pthread_cond_timedwait(&cond_, mutex_lock_.GetMutex(), &abstime);
+    if (ret == ETIMEDOUT) {
+      return true;
+    }
+    MCHECK(ret);
+    return false;
+  }
+
   void Notify() { MCHECK(pthread_cond_signal(&cond_)); };
   void NotifyAll() { MCHECK(pthread_cond_broadcast(&cond_)); };
 
@@ -0,0 +1,326 @@
+#include "cpu_topology.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <set>
+#include <tuple>
+
+namespace mymuduo {
+
+namespace {
+
+const char* kSysfsCpuDir = "/sys/devices/system/cpu";
+
+// The first line, empty when the file is missing.
+std::string ReadLine(const std::string& path) {
+  FILE* fp = fopen(path.c_str(), "re");
+  if (!fp) {
+    return std::string();
+  }
+  char buf[4096];
+  std::string line;
+  if (fgets(buf, sizeof(buf), fp)) {
+    line = buf;
+    line.erase(line.find_last_not_of(" \n") + 1);
+  }
+  fclose(fp);
+  return line;
+}
+
+int ReadInt(const std::string& path, int missing) {
+  const std::string line = ReadLine(path);
+  return line.empty() ? missing : atoi(line.c_str());
+}
+
+// "0-3,8,10-11"
+std::vector<int> ParseCpuList(const std::string& list) {
+  std::vector<int> cpus;
+  const char* p = list.c_str();
+  while (*p) {
+    char* end = nullptr;
+    const long first = strtol(p, &end, 10);
+    if (end == p) {
+      break;
+    }
+    long last = first;
+    if (*end == '-') {
+      p = end + 1;
+      last = strtol(p, &end, 10);
+    }
+    for (long cpu = first; cpu <= last; ++cpu) {
+      cpus.push_back(static_cast<int>(cpu));
+    }
+    p = *end == ',' ? end + 1 : end;
+  }
+  std::sort(cpus.begin(), cpus.end());
+  return cpus;
+}
+
+// The node<N> entry of a cpu directory.
+int ReadNode(const std::string& cpu_dir) {
+  int node = 0;
+  DIR* dir = ::opendir(cpu_dir.c_str());
+  if (!dir) {
+    return node;
+  }
+  while (struct dirent* entry = ::readdir(dir)) {
+    if (strncmp(entry->d_name, "node", 4) == 0 && entry->d_name[4] >= '0' &&
+        entry->d_name[4] <= '9') {
+      node = atoi(entry->d_name + 4);
+      break;
+    }
+  }
+  ::closedir(dir);
+  return node;
+}
+
+CpuInfo ReadCpu(const std::string& sysfs_dir, int cpu) {
+  const std::string cpu_dir = sysfs_dir + "/cpu" + std::to_string(cpu);
+  CpuInfo info;
+  info.cpu = cpu;
+  info.package = std::max(ReadInt(cpu_dir + "/topology/physical_package_id", 0), 0);
+  info.node = ReadNode(cpu_dir);
+  const std::vector<int> siblings = ParseCpuList(ReadLine(cpu_dir + "/topology/thread_siblings_list"));
+  info.core = siblings.empty() ? cpu : siblings.front();
+  info.l2 = -1;
+  info.l3 = -1;
+  for (int index = 0;; ++index) {
+    const std::string cache_dir = cpu_dir + "/cache/index" + std::to_string(index);
+    const int level = ReadInt(cache_dir + "/level", -1);
+    if (level < 0) {
+      break;
+    }
+    if (ReadLine(cache_dir + "/type") == "Instruction") {
+      continue;
+    }
+    const std::vector<int> shared = ParseCpuList(ReadLine(cache_dir + "/shared_cpu_list"));
+    const int group = shared.empty() ? cpu : shared.front();
+    if (level == 2) {
+      info.l2 = group;
+    } else if (level == 3) {
+      info.l3 = group;
+    }
+  }
+  if (info.l2 < 0) {
+    info.l2 = info.core;
+  }
+  if (info.l3 < 0) {
+    info.l3 = info.package;
+  }
+  info.smt = 0;
+  return info;
+}
+
+bool CompactLess(const CpuInfo* a, const CpuInfo* b) {
+  return std::tie(a->node, a->package, a->l3, a->l2, a->core, a->smt, a->cpu) <
+         std::tie(b->node, b->package, b->l3, b->l2, b->core, b->smt, b->cpu);
+}
+
+const int kLevels = 4;
+
+int GroupOf(const CpuInfo& info, int level) {
+  switch (level) {
+    case 0:
+      return info.node;
+    case 1:
+      return info.package;
+    case 2:
+      return info.l3;
+    default:
+      return info.l2;
+  }
+}
+
+// Round robin over the groups of a level, each group interleaved the same
+// way one level down, so consecutive picks are as far apart as possible.
+// cpus is in compact order, which keeps every group contiguous.
+std::vector<const CpuInfo*> Interleave(const std::vector<const CpuInfo*>& cpus, int level) {
+  if (cpus.size() <= 1 || level == kLevels) {
+    return cpus;
+  }
+  std::vector<std::vector<const CpuInfo*>> groups;
+  for (const CpuInfo* info : cpus) {
+    if (groups.empty() || GroupOf(*groups.back().front(), level) != GroupOf(*info, level)) {
+      groups.emplace_back();
+    }
+    groups.back().push_back(info);
+  }
+  for (std::vector<const CpuInfo*>& group : groups) {
+    group = Interleave(group, level + 1);
+  }
+  std::vector<const CpuInfo*> interleaved;
+  for (size_t i = 0; interleaved.size() < cpus.size(); ++i) {
+    for (const std::vector<const CpuInfo*>& group : groups) {
+      if (i < group.size()) {
+        interleaved.push_back(group[i]);
+      }
+    }
+  }
+  return interleaved;
+}
+
+}  // namespace
+
+CpuTopology::CpuTopology(const std::string& sysfs_dir)
+    : package_count_(0),
+      core_count_(0),
+      node_count_(0) {
+  for (int cpu : ParseCpuList(ReadLine(sysfs_dir + "/online"))) {
+    cpus_.push_back(ReadCpu(sysfs_dir, cpu));
+  }
+  if (cpus_.empty()) {
+    // No sysfs, e.g. in some containers: a core per CPU.
+    const long cpu_num = std::max(::sysconf(_SC_NPROCESSORS_ONLN), 1L);
+    for (int cpu = 0; cpu < cpu_num; ++cpu) {
+      cpus_.push_back(CpuInfo{cpu, 0, 0, cpu, cpu, 0, 0});
+    }
+  }
+  Summarize();
+}
+
+const CpuTopology& CpuTopology::Get() {
+  static CpuTopology* topology = [] {
+    CpuTopology* parsed = new CpuTopology(kSysfsCpuDir);
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (::sched_getaffinity(0, sizeof(set), &set) == 0) {
+      std::vector<CpuInfo> allowed;
+      for (const CpuInfo& info : parsed->cpus_) {
+        if (info.cpu < CPU_SETSIZE && CPU_ISSET(info.cpu, &set)) {
+          allowed.push_back(info);
+        }
+      }
+      if (!allowed.empty()) {
+        parsed->cpus_.swap(allowed);
+        parsed->Summarize();
+      }
+    }
+    return parsed;
+  }();
+  return *topology;
+}
+
+// Sorts by cpu, numbers the usable SMT siblings of each core and counts
+// the groups.
+void CpuTopology::Summarize() {
+  std::sort(cpus_.begin(), cpus_.end(),
+            [](const CpuInfo& a, const CpuInfo& b) { return a.cpu < b.cpu; });
+  std::set<int> packages;
+  std::set<int> cores;
+  std::set<int> nodes;
+  for (CpuInfo& info : cpus_) {
+    info.smt = 0;
+    for (const CpuInfo& other : cpus_) {
+      if (other.cpu < info.cpu && other.core == info.core) {
+        ++info.smt;
+      }
+    }
+    packages.insert(info.package);
+    cores.insert(info.core);
+    nodes.insert(info.node);
+  }
+  package_count_ = static_cast<int>(packages.size());
+  core_count_ = static_cast<int>(cores.size());
+  node_count_ = static_cast<int>(nodes.size());
+}
+
+std::vector<int> CpuTopology::Order(Placement placement, const std::vector<int>& avoid) const {
+  std::set<int> avoided_cores;
+  for (const CpuInfo& info : cpus_) {
+    if (std::find(avoid.begin(), avoid.end(), info.cpu) != avoid.end()) {
+      avoided_cores.insert(info.core);
+    }
+  }
+  std::vector<const CpuInfo*> cpus;
+  for (const CpuInfo& info : cpus_) {
+    if (!avoided_cores.count(info.core)) {
+      cpus.push_back(&info);
+    }
+  }
+  if (cpus.empty()) {
+    for (const CpuInfo& info : cpus_) {
+      cpus.push_back(&info);
+    }
+  }
+  std::sort(cpus.begin(), cpus.end(), CompactLess);
+
+  std::vector<const CpuInfo*> ordered;
+  switch (placement) {
+    case kCompact:
+      ordered = cpus;
+      break;
+    case kPhysicalCore:
+      for (const CpuInfo* info : cpus) {
+        if (info->smt == 0) {
+          ordered.push_back(info);
+        }
+      }
+      break;
+    case kScatter:
+      for (int smt = 0; ordered.size() < cpus.size(); ++smt) {
+        std::vector<const CpuInfo*> threads;
+        for (const CpuInfo* info : cpus) {
+          if (info->smt == smt) {
+            threads.push_back(info);
+          }
+        }
+        for (const CpuInfo* info : Interleave(threads, 0)) {
+          ordered.push_back(info);
+        }
+      }
+      break;
+  }
+
+  std::vector<int> order;
+  for (const CpuInfo* info : ordered) {
+    order.push_back(info->cpu);
+  }
+  return order;
+}
+
+std::vector<int> CpuTopology::Place(Placement placement, int n,
+                                    const std::vector<int>& avoid) const {
+  const std::vector<int> order = Order(placement, avoid);
+  std::vector<int> cpus;
+  for (int i = 0; i < n; ++i) {
+    cpus.push_back(order[i % order.size()]);
+  }
+  return cpus;
+}
+
+std::string CpuTopology::ToString() const {
+  char buf[128];
+  snprintf(buf, sizeof(buf), "%d packages, %d cores, %zu cpus, %d nodes\n", package_count_,
+           core_count_, cpus_.size(), node_count_);
+  std::string text = buf;
+  for (const CpuInfo& info : cpus_) {
+    snprintf(buf, sizeof(buf), "cpu %d: package %d node %d core %d smt %d l2 %d l3 %d\n",
+             info.cpu, info.package, info.node, info.core, info.smt, info.l2, info.l3);
+    text.append(buf);
+  }
+  return text;
+}
+
+bool PinCurrentThread(int cpu) {
+  if (cpu < 0 || cpu >= CPU_SETSIZE) {
+    fprintf(stderr, "PinCurrentThread: cpu %d out of range\n", cpu);
+    return false;
+  }
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+  if (::sched_setaffinity(0, sizeof(set), &set) < 0) {
+    fprintf(stderr, "PinCurrentThread: cpu %d sched_setaffinity: %s\n", cpu, strerror(errno));
+    return false;
+  }
+  return true;
+}
+
+}  // namespace mymuduo
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+namespace mymuduo {
+
+// One logical CPU. A group (core, shared L2, shared L3) is named by the
+// lowest CPU in it, so CPUs with the same l2 share an L2.
+struct CpuInfo {
+  int cpu;
+  int package;  // physical_package_id
+  int node;     // NUMA node, 0 without NUMA
+  int core;     // lowest of its SMT siblings
+  int l2;       // lowest CPU sharing its L2, core when unknown
+  int l3;       // lowest CPU sharing its L3, package when unknown
+  int smt;      // 0 for the first hyperthread of its core, 1 for the next ...
+};
+
+// The CPUs of the machine as /sys/devices/system/cpu describes them:
+// packages, cores, SMT siblings, shared caches and NUMA nodes, plus the
+// orders to hand them out to threads in.
+class CpuTopology {
+ public:
+  enum Placement {
+    // Fill a core, then its L2, L3, package: threads next to each other
+    // share caches, e.g. a producer and its consumer.
+    kCompact,
+    // Spread over packages, then L3s, then cores; hyperthreads come last.
+    kScatter,
+    // The first hyperthread of each core, compact order: no two threads
+    // share a core.
+    kPhysicalCore,
+  };
+
+  // Parses a sysfs cpu directory, for tests; every online CPU is usable.
+  explicit CpuTopology(const std::string& sysfs_dir);
+
+  CpuTopology(const CpuTopology&) = delete;
+  CpuTopology& operator=(const CpuTopology&) = delete;
+
+  // This machine, parsed once. Only the CPUs in the affinity mask of the
+  // process at that time are usable.
+  static const CpuTopology& Get();
+
+  // Usable CPUs, sorted by cpu.
+  const std::vector<CpuInfo>& cpus() const { return cpus_; }
+  int package_count() const { return package_count_; }
+  int core_count() const { return core_count_; }
+  int node_count() const { return node_count_; }
+
+  // The usable CPUs in the order placement hands them out, leaving out the
+  // cores of avoid, e.g. the CPUs of the I/O threads when placing compute
+  // threads. Ignores avoid when it covers every core.
+  std::vector<int> Order(Placement placement, const std::vector<int>& avoid = {}) const;
+  // CPUs for n threads, thread i on the i-th; wraps around when there are
+  // more threads than CPUs.
+  std::vector<int> Place(Placement placement, int n, const std::vector<int>& avoid = {}) const;
+
+  // e.g. "1 packages, 4 cores, 8 cpus, 1 nodes", then a line per CPU.
+  std::string ToString() const;
+
+ private:
+  void Summarize();
+
+ private:
+  std::vector<CpuInfo> cpus_;
+  int package_count_;
+  int core_count_;
+  int node_count_;
+};
+
+// sched_setaffinity to one CPU. Complains on stderr and returns false when
+// the CPU is not allowed.
+bool PinCurrentThread(int cpu);
+
+}  // namespace mymuduo
@@ -0,0 +1,148 @@
+#include "histogram.h"
+
+#include <assert.h>
+#include <math.h>
+
+#include <algorithm>
+
+namespace mymuduo {
+
+Histogram::Histogram(int64_t highest_trackable, int significant_digits)
+    : highest_trackable_(std::max<int64_t>(highest_trackable, 2)) {
+  significant_digits = std::min(std::max(significant_digits, 1), 5);
+  // Enough sub-buckets to tell 10^digits apart within the top half of each.
+  const int64_t largest_single_unit = 2 * static_cast<int64_t>(pow(10, significant_digits));
+  int sub_bucket_count_magnitude = 0;
+  while ((int64_t{1} << sub_bucket_count_magnitude) < largest_single_unit) {
+    ++sub_bucket_count_magnitude;
+  }
+  sub_bucket_half_count_magnitude_ = sub_bucket_count_magnitude - 1;
+  sub_bucket_half_count_ = int64_t{1} << sub_bucket_half_count_magnitude_;
+  const int64_t sub_bucket_count = int64_t{1} << sub_bucket_count_magnitude;
+  sub_bucket_mask_ = sub_bucket_count - 1;
+
+  int bucket_count = 1;
+  for (int64_t smallest_untrackable = sub_bucket_count;
+       smallest_untrackable <= highest_trackable_ && bucket_count + sub_bucket_count_magnitude < 63;
+       smallest_untrackable <<= 1) {
+    ++bucket_count;
+  }
+  counts_.assign((bucket_count + 1) * sub_bucket_half_count_, 0);
+}
+
+int64_t Histogram::ValueFromIndex(int index) const {
+  int bucket_index = (index >> sub_bucket_half_count_magnitude_) - 1;
+  int64_t sub_bucket_index = (index & (sub_bucket_half_count_ - 1)) + sub_bucket_half_count_;
+  if (bucket_index < 0) {
+    sub_bucket_index -= sub_bucket_half_count_;
+    bucket_index = 0;
+  }
+  return sub_bucket_index << bucket_index;
+}
+
+int64_t Histogram::HighestEquivalentValue(int64_t value) const {
+  const int pow2_ceiling = 64 - __builtin_clzll(static_cast<uint64_t>(value | sub_bucket_mask_));
+  const int bucket_index = pow2_ceiling - (sub_bucket_half_count_magnitude_ + 1);
+  const int64_t lowest = (value >> bucket_index) << bucket_index;
+  return lowest + (int64_t{1} << bucket_index) - 1;
+}
+
+void Histogram::RecordN(int64_t value, int64_t count) {
+  value = std::min(std::max<int64_t>(value, 0), highest_trackable_);
+  counts_[CountsIndex(value)] += count;
+  total_count_ += count;
+  min_ = std::min(min_, value);
+  max_ = std::max(max_, value);
+  sum_ += static_cast<double>(value) * static_cast<double>(count);
+}
+
+void Histogram::RecordBucket(int index, int64_t count) {
+  assert(index >= 0 && index < BucketCount());
+  if (count == 0) {
+    return;
+  }
+  const int64_t value = ValueFromIndex(index);
+  counts_[index] += count;
+  total_count_ += count;
+  min_ = std::min(min_, value);
+  max_ = std::max(max_, std::min(HighestEquivalentValue(value), highest_trackable_));
+  sum_ += static_cast<double>(value) * static_cast<double>(count);
+}
+
+void Histogram::Merge(const Histogram& other) {
+  assert(counts_.size() == other.counts_.size() &&
+         sub_bucket_half_count_ == other.sub_bucket_half_count_);
+  for (size_t i = 0; i < counts_.size(); ++i) {
+    counts_[i] += other.counts_[i];
+  }
+  total_count_ += other.total_count_;
+  min_ = std::min(min_, other.min_);
+  max_ = std::max(max_, other.max_);
+  sum_ += other.sum_;
+}
+
+void Histogram::Reset() {
+  std::fill(counts_.begin(), counts_.end(), 0);
+  total_count_ = 0;
+  min_ = INT64_MAX;
+  max_ = 0;
+  sum_ = 0;
+}
+
+double Histogram::Mean() const {
+  return total_count_ ? sum_ / static_cast<double>(total_count_) : 0;
+}
+
+int64_t Histogram::ValueAtPercentile(double percentile) const {
+  if (total_count_ == 0) {
+    return 0;
+  }
+  percentile = std::min(std::max(percentile, 0.0), 100.0);
+  const int64_t count_at_percentile = std::max<int64_t>(
+      static_cast<int64_t>(ceil(percentile / 100 * static_cast<double>(total_count_))), 1);
+  int64_t total = 0;
+  for (size_t i = 0; i < counts_.size(); ++i) {
+    total += counts_[i];
+    if (total >= count_at_percentile) {
+      return std::min(HighestEquivalentValue(ValueFromIndex(static_cast<int>(i))), max_);
+    }
+  }
+  return max_;
+}
+
+void Histogram::PrintPercentiles(FILE* out, double value_scale) const {
+  const int kTicksPerHalfDistance = 5;
+  fprintf(out, "%12s %14s %10s %14s\n", "Value", "Percentile", "TotalCount", "1/(1-Percentile)");
+  if (total_count_ == 0) {
+    return;
+  }
+  // Walks the counts once, emitting a line each time the cumulative count
+  // passes the next reporting percentile.
+  double percentile = 0;
+  int halvings = 0;
+  int64_t total = 0;
+  for (size_t i = 0; i < counts_.size(); ++i) {
+    if (counts_[i] == 0) {
+      continue;
+    }
+    total += counts_[i];
+    const int64_t value =
+        std::min(HighestEquivalentValue(ValueFromIndex(static_cast<int>(i))), max_);
+    const double reached = 100.0 * static_cast<double>(total) / static_cast<double>(total_count_);
+    while (percentile <= reached && total < total_count_) {
+      fprintf(out, "%12.3f %14.12f %10lld %14.2f\n", static_cast<double>(value) / value_scale,
+              percentile / 100, static_cast<long long>(total), 1 / (1 - percentile / 100));
+      // Every halving of the distance to 100% gets the same number of ticks.
+      while (100 - percentile <= 100 / pow(2, halvings + 1)) {
+        ++halvings;
+      }
+      percentile += 100 / pow(2, halvings + 1) / kTicksPerHalfDistance;
+    }
+  }
+  fprintf(out, "%12.3f %14.12f %10lld %14s\n", static_cast<double>(max_) / value_scale, 1.0,
+          static_cast<long long>(total_count_), "inf");
+  fprintf(out, "#[Mean = %.3f, Max = %.3f, Total count = %lld]\n", Mean() / value_scale,
+          static_cast<double>(max_) / value_scale, static_cast<long long>(total_count_));
+}
+
+}  // namespace mymuduo
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <vector>
+
+namespace mymuduo {
+
+// HDR style histogram of non-negative integer values (latencies in us or ns).
+// Buckets are log-linear: every power of two range is split into the same
+// number of linear sub-buckets, so any recorded value is kept to
+// significant_digits decimal digits over the whole [0, highest_trackable]
+// range at a fixed memory cost (3 digits up to an hour in us: ~100KiB).
+// Values above highest_trackable are counted as highest_trackable.
+// Not thread safe: one histogram per thread, Merge() them for a report.
+class Histogram {
+ public:
+  explicit Histogram(int64_t highest_trackable, int significant_digits = 3);
+
+  void Record(int64_t value) { RecordN(value, 1); }
+  void RecordN(int64_t value, int64_t count);
+  // Adds count values known only by their bucket, for recorders keeping
+  // counts of their own in this layout.
+  void RecordBucket(int index, int64_t count);
+  // Adds every count of other, which must have the same layout.
+  void Merge(const Histogram& other);
+  void Reset();
+
+  int64_t Count() const { return total_count_; }
+  int64_t Min() const { return total_count_ ? min_ : 0; }
+  int64_t Max() const { return max_; }
+  double Mean() const;
+  // The highest value equivalent to the one at percentile (0..100].
+  int64_t ValueAtPercentile(double percentile) const;
+
+  // Percentile curve in the format of HdrHistogram's
+  // outputPercentileDistribution: value, percentile, count up to it and
+  // 1/(1-percentile), five ticks per halving of the distance to 100%.
+  // Values are divided by value_scale, to print ns as us for example.
+  void PrintPercentiles(FILE* out, double value_scale = 1) const;
+
+  // The bucket layout: values map to [0, BucketCount()).
+  int BucketCount() const { return static_cast<int>(counts_.size()); }
+  int BucketIndex(int64_t value) const {
+    return CountsIndex(value < 0 ? 0 : value > highest_trackable_ ? highest_trackable_ : value);
+  }
+
+ private:
+  int CountsIndex(int64_t value) const {
+    const int pow2_ceiling = 64 - __builtin_clzll(static_cast<uint64_t>(value | sub_bucket_mask_));
+    const int bucket_index = pow2_ceiling - (sub_bucket_half_count_magnitude_ + 1);
+    const int64_t sub_bucket_index = value >> bucket_index;
+    return static_cast<int>(((static_cast<int64_t>(bucket_index) + 1)
+                             << sub_bucket_half_count_magnitude_) +
+                            (sub_bucket_index - sub_bucket_half_count_));
+  }
+  int64_t ValueFromIndex(int index) const;
+  int64_t HighestEquivalentValue(int64_t value) const;
+
+ private:
+  const int64_t highest_trackable_;
+  int sub_bucket_half_count_magnitude_;
+  int64_t sub_bucket_half_count_;
+  int64_t sub_bucket_mask_;
+  std::vector<int64_t> counts_;
+  int64_t total_count_{0};
+  int64_t min_{INT64_MAX};
+  int64_t max_{0};
+  double sum_{0};
+};
+
+}  // namespace mymuduo
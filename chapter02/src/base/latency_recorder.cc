@@ -0,0 +1,180 @@
+#include "latency_recorder.h"
+
+#include <stdio.h>
+
+#include <algorithm>
+
+#include "mutex.h"
+
+namespace mymuduo {
+
+namespace {
+
+void AppendSummary(const Histogram& histogram, double value_scale, bool json, std::string* out) {
+  const struct {
+    const char* name;
+    double value;
+  } fields[] = {
+      {"min", static_cast<double>(histogram.Min()) / value_scale},
+      {"mean", histogram.Mean() / value_scale},
+      {"p50", static_cast<double>(histogram.ValueAtPercentile(50)) / value_scale},
+      {"p90", static_cast<double>(histogram.ValueAtPercentile(90)) / value_scale},
+      {"p99", static_cast<double>(histogram.ValueAtPercentile(99)) / value_scale},
+      {"p999", static_cast<double>(histogram.ValueAtPercentile(99.9)) / value_scale},
+      {"max", static_cast<double>(histogram.Max()) / value_scale},
+  };
+  char buf[64];
+  snprintf(buf, sizeof(buf), json ? "{\"count\": %lld" : "count=%lld",
+           static_cast<long long>(histogram.Count()));
+  out->append(buf);
+  for (const auto& field : fields) {
+    snprintf(buf, sizeof(buf), json ? ", \"%s\": %.3f" : " %s=%.3f", field.name, field.value);
+    out->append(buf);
+  }
+  if (json) {
+    out->push_back('}');
+  }
+}
+
+// Who uses the shared key. Taken before the mutex of a recorder.
+struct SlotRegistry {
+  MutexLock mtx;
+  std::vector<LatencyRecorder*> recorders;                    // guarded by mtx, by id
+  std::vector<std::vector<std::atomic<int64_t>*>*> threads;  // guarded by mtx, their slots
+};
+
+// Never destroyed, like the key: threads exit after static destructors.
+SlotRegistry& GetSlotRegistry() {
+  static SlotRegistry* registry = new SlotRegistry;
+  return *registry;
+}
+
+size_t AllocateId(LatencyRecorder* recorder) {
+  SlotRegistry& registry = GetSlotRegistry();
+  MutexLockGuard lock(registry.mtx);
+  auto free_id = std::find(registry.recorders.begin(), registry.recorders.end(), nullptr);
+  if (free_id == registry.recorders.end()) {
+    free_id = registry.recorders.insert(free_id, nullptr);
+  }
+  *free_id = recorder;
+  return static_cast<size_t>(free_id - registry.recorders.begin());
+}
+
+}  // namespace
+
+LatencyRecorder::ThreadSlots::ThreadSlots() {
+  SlotRegistry& registry = GetSlotRegistry();
+  MutexLockGuard lock(registry.mtx);
+  registry.threads.push_back(&counts);
+}
+
+LatencyRecorder::ThreadSlots::~ThreadSlots() {
+  SlotRegistry& registry = GetSlotRegistry();
+  MutexLockGuard lock(registry.mtx);
+  registry.threads.erase(std::find(registry.threads.begin(), registry.threads.end(), &counts));
+  for (size_t id = 0; id < counts.size(); ++id) {
+    if (counts[id]) {
+      registry.recorders[id]->Retire(counts[id]);
+    }
+  }
+}
+
+LatencyRecorder::LatencyRecorder(const std::string& name, int64_t highest_trackable,
+                                 int significant_digits)
+    : name_(name),
+      layout_(highest_trackable, significant_digits),
+      id_(AllocateId(this)),
+      mtx_(new MutexLock),
+      retired_counts_(layout_.BucketCount(), 0),
+      merged_counts_(layout_.BucketCount(), 0),
+      snapshot_(highest_trackable, significant_digits),
+      interval_(highest_trackable, significant_digits) {}
+
+LatencyRecorder::~LatencyRecorder() {
+  {
+    SlotRegistry& registry = GetSlotRegistry();
+    MutexLockGuard lock(registry.mtx);
+    for (std::vector<std::atomic<int64_t>*>* slots : registry.threads) {
+      if (id_ < slots->size()) {
+        (*slots)[id_] = nullptr;
+      }
+    }
+    registry.recorders[id_] = nullptr;
+  }
+  for (std::atomic<int64_t>* counts : thread_counts_) {
+    delete[] counts;
+  }
+}
+
+std::atomic<int64_t>* LatencyRecorder::Register() {
+  std::atomic<int64_t>* counts = new std::atomic<int64_t>[layout_.BucketCount()]();
+  std::vector<std::atomic<int64_t>*>& slots = GetThreadSlots().value().counts;
+  SlotRegistry& registry = GetSlotRegistry();
+  MutexLockGuard registry_lock(registry.mtx);
+  if (slots.size() <= id_) {
+    slots.resize(id_ + 1, nullptr);
+  }
+  slots[id_] = counts;
+  MutexLockGuard lock(*mtx_);
+  thread_counts_.push_back(counts);
+  return counts;
+}
+
+void LatencyRecorder::Retire(std::atomic<int64_t>* counts) {
+  {
+    MutexLockGuard lock(*mtx_);
+    for (int i = 0; i < layout_.BucketCount(); ++i) {
+      retired_counts_[i] += counts[i].load(std::memory_order_relaxed);
+    }
+    thread_counts_.erase(std::find(thread_counts_.begin(), thread_counts_.end(), counts));
+  }
+  delete[] counts;
+}
+
+void LatencyRecorder::Merge() {
+  MutexLockGuard lock(*mtx_);
+  snapshot_.Reset();
+  interval_.Reset();
+  // A count read here is never older than one read before: every bucket
+  // only grows, so the interval is never negative.
+  for (int i = 0; i < layout_.BucketCount(); ++i) {
+    int64_t count = retired_counts_[i];
+    for (std::atomic<int64_t>* counts : thread_counts_) {
+      count += counts[i].load(std::memory_order_relaxed);
+    }
+    snapshot_.RecordBucket(i, count);
+    interval_.RecordBucket(i, count - merged_counts_[i]);
+    merged_counts_[i] = count;
+  }
+}
+
+Histogram LatencyRecorder::Snapshot() const {
+  MutexLockGuard lock(*mtx_);
+  return snapshot_;
+}
+
+Histogram LatencyRecorder::Interval() const {
+  MutexLockGuard lock(*mtx_);
+  return interval_;
+}
+
+std::string LatencyRecorder::DumpText(double value_scale) const {
+  std::string text = name_ + ": ";
+  MutexLockGuard lock(*mtx_);
+  AppendSummary(snapshot_, value_scale, false, &text);
+  text.append(" | interval ");
+  AppendSummary(interval_, value_scale, false, &text);
+  return text;
+}
+
+std::string LatencyRecorder::DumpJson(double value_scale) const {
+  std::string json = "{\"name\": \"" + name_ + "\", \"total\": ";
+  MutexLockGuard lock(*mtx_);
+  AppendSummary(snapshot_, value_scale, true, &json);
+  json.append(", \"interval\": ");
+  AppendSummary(interval_, value_scale, true, &json);
+  json.push_back('}');
+  return json;
+}
+
+}  // namespace mymuduo
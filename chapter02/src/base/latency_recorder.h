@@ -0,0 +1,117 @@
+#pragma once
+
+#include <stdint.h>
+#include <time.h>
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "histogram.h"
+#include "thread_local.h"
+
+namespace mymuduo {
+
+class MutexLock;
+
+// Latency histogram recorded from any number of threads with no shared
+// lock or atomic read-modify-write: each thread counts into buckets of
+// its own, in the layout of Histogram, with plain relaxed loads and
+// stores since it is their only writer. Merge() adds every thread's
+// buckets up into a snapshot, and into an interval since the Merge()
+// before, so a reporter calling it every second sees both.
+// Counts of a thread that exits are kept. Destroy a recorder only once no
+// thread records into it. All recorders share one pthread key, so there
+// can be any number of them.
+//   LatencyRecorder get_stock("GetStock");
+//   { LatencyRecorder::Timer timer(&get_stock); sf->GetStock(key); }
+class LatencyRecorder {
+ public:
+  // Values are clamped to [0, highest_trackable], ns for Timer. Two
+  // significant digits take ~28KB a thread up to 10s.
+  explicit LatencyRecorder(const std::string& name,
+                           int64_t highest_trackable = 10 * int64_t{1000000000},
+                           int significant_digits = 2);
+  ~LatencyRecorder();
+
+  LatencyRecorder(const LatencyRecorder&) = delete;
+  LatencyRecorder& operator=(const LatencyRecorder&) = delete;
+
+  void Record(int64_t value) {
+    const std::vector<std::atomic<int64_t>*>& slots = GetThreadSlots().value().counts;
+    std::atomic<int64_t>* counts = id_ < slots.size() ? slots[id_] : nullptr;
+    if (UNLIKELY(!counts)) {
+      counts = Register();
+    }
+    std::atomic<int64_t>& count = counts[layout_.BucketIndex(value)];
+    count.store(count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+  }
+
+  // Adds up what every thread recorded so far.
+  void Merge();
+  // As of the last Merge(): everything, and what came since the one before.
+  Histogram Snapshot() const;
+  Histogram Interval() const;
+
+  // One line of count, min, mean, p50, p90, p99, p999 and max for the
+  // snapshot then the interval, values divided by value_scale (1000 for
+  // ns as us).
+  std::string DumpText(double value_scale = 1) const;
+  // {"name": ..., "total": {"count": ..., "p99": ...}, "interval": {...}}
+  std::string DumpJson(double value_scale = 1) const;
+
+  const std::string& name() const { return name_; }
+
+  // Records the ns from its construction to its destruction.
+  class Timer {
+   public:
+    explicit Timer(LatencyRecorder* recorder) : recorder_(recorder), start_(Now()) {}
+    ~Timer() { recorder_->Record(Now() - start_); }
+
+    Timer(const Timer&) = delete;
+    Timer& operator=(const Timer&) = delete;
+
+   private:
+    static int64_t Now() {
+      struct timespec ts;
+      clock_gettime(CLOCK_MONOTONIC, &ts);
+      return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+    }
+
+    LatencyRecorder* const recorder_;
+    const int64_t start_;
+  };
+
+ private:
+  // The counts of a thread in every recorder it recorded into, by recorder
+  // id. Gives them to their recorders when the thread exits.
+  struct ThreadSlots {
+    ThreadSlots();
+    ~ThreadSlots();
+
+    std::vector<std::atomic<int64_t>*> counts;  // written by other threads only to clear
+  };
+
+  static ThreadLocal<ThreadSlots>& GetThreadSlots() {
+    static ThreadLocal<ThreadSlots>* slots = new ThreadLocal<ThreadSlots>;  // outlives every thread
+    return *slots;
+  }
+
+  std::atomic<int64_t>* Register();
+  void Retire(std::atomic<int64_t>* counts);
+
+ private:
+  const std::string name_;
+  const Histogram layout_;  // never recorded into
+  const size_t id_;         // reused once the recorder is destroyed
+
+  std::unique_ptr<MutexLock> mtx_;
+  std::vector<std::atomic<int64_t>*> thread_counts_;  // guarded by mtx_
+  std::vector<int64_t> retired_counts_;              // guarded by mtx_, of exited threads
+  std::vector<int64_t> merged_counts_;               // guarded by mtx_, at the last Merge()
+  Histogram snapshot_;                               // guarded by mtx_
+  Histogram interval_;                               // guarded by mtx_
+};
+
+}  // namespace mymuduo
@@ -0,0 +1,93 @@
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <memory>
+#include <string>
+
+#include "bench.h"
+#include "mmap_log_file.h"
+
+// One 128-byte log record per operation, into three sinks: stdio with a
+// 64KB buffer (a syscall and a copy every 64KB), write(2) per record (a
+// backend flushing every record) and MmapLogFile (a memcpy into the
+// mapped segment, writeback started every 1MB). Files go to a temporary
+// directory under /tmp and are removed at the end.
+namespace {
+
+constexpr int kRecordNum = 1 << 17;  // per run
+constexpr size_t kRecordBytes = 128;
+constexpr size_t kStdioBuffer = 64 * 1024;
+
+std::string g_dir;
+char g_record[kRecordBytes];
+FILE* g_fp = nullptr;
+int g_fd = -1;
+std::unique_ptr<mymuduo::MmapLogFile> g_mmap_file;
+
+void StdioAppend(int64_t) {
+  fwrite_unlocked(g_record, 1, kRecordBytes, g_fp);
+}
+
+void WriteAppend(int64_t) {
+  ::write(g_fd, g_record, kRecordBytes);
+}
+
+void MmapAppend(int64_t) {
+  g_mmap_file->Append(g_record, kRecordBytes);
+}
+
+mymuduo::bench::Workload MakeWorkload(const char* name, mymuduo::bench::OpType op) {
+  mymuduo::bench::Workload workload;
+  workload.name = name;
+  workload.read_op = op;
+  workload.read_iter_num = kRecordNum;
+  return workload;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  mymuduo::bench::Options options;
+  options.reader_nums = {1};
+  options.writer_nums = {0};
+  if (!mymuduo::bench::ParseOptions(argc, argv, &options)) {
+    fprintf(stderr, "usage: %s [--repeats=3] [--read-iters=N] [--format=text|json|csv] "
+                    "[--perf-counters=0|1]\n", argv[0]);
+    return 1;
+  }
+  char dir[] = "/tmp/log_file_benchmark.XXXXXX";
+  if (!::mkdtemp(dir)) {
+    perror("mkdtemp");
+    return 1;
+  }
+  g_dir = dir;
+  memset(g_record, 'r', sizeof(g_record));
+  g_record[kRecordBytes - 1] = '\n';
+
+  mymuduo::bench::Harness harness(options);
+  g_fp = fopen((g_dir + "/stdio.log").c_str(), "we");
+  static char buffer[kStdioBuffer];
+  setbuffer(g_fp, buffer, sizeof(buffer));
+  harness.Run(MakeWorkload("append/stdio", StdioAppend));
+  fclose(g_fp);
+  ::unlink((g_dir + "/stdio.log").c_str());
+
+  g_fd = ::open((g_dir + "/write.log").c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  harness.Run(MakeWorkload("append/write", WriteAppend));
+  ::close(g_fd);
+  ::unlink((g_dir + "/write.log").c_str());
+
+  g_mmap_file.reset(new mymuduo::MmapLogFile(g_dir + "/mmap"));
+  harness.Run(MakeWorkload("append/mmap", MmapAppend));
+  g_mmap_file.reset();
+  std::string cleanup = "rm -rf " + g_dir;
+  if (::system(cleanup.c_str()) != 0) {
+    fprintf(stderr, "could not remove %s\n", dir);
+  }
+
+  harness.Report(stdout);
+  return 0;
+}
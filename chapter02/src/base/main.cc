@@ -1,10 +1,32 @@
+#include <dirent.h>
+#include <sched.h>
+#include <fcntl.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <memory>
+#include <memory_resource>
 #include <string>
+#include <vector>
 
 #include "mutex.h"
 #include "condition.h"
 
+#include "arena.h"
+#include "binary_log.h"
+#include "count_down_latch.h"
+#include "cpu_topology.h"
 #include "current_thread.h"
+#include "histogram.h"
+#include "latency_recorder.h"
+#include "mmap_log_file.h"
+#include "stats.h"
+#include "thread_pool.h"
 #include "thread_local.h"
 
 namespace test_thread_local {
@@ -67,7 +89,418 @@ void TEST_thread_local() {
   MCHECK(pthread_join(tid2, nullptr));
 }
 
+void TEST_arena() {
+  auto& arena = mymuduo::ThreadArena::GetArena();
+  {
+    std::pmr::vector<std::pmr::string> tokens(mymuduo::ThreadArena::GetResource());
+    for (int i = 0; i < 100; ++i) {
+      tokens.emplace_back("a token long enough to leave the small string buffer");
+    }
+    int* big = static_cast<int*>(arena.Allocate(1 << 20, alignof(int)));
+    big[(1 << 18) - 1] = 1;
+    printf("tid=%d, arena used=%zu, reserved=%zu\n",
+           ::mymuduo::CurrentThread::Tid(), arena.BytesUsed(), arena.BytesReserved());
+  }
+  arena.Reset();
+  printf("tid=%d, arena reset, used=%zu, reserved=%zu\n",
+         ::mymuduo::CurrentThread::Tid(), arena.BytesUsed(), arena.BytesReserved());
+}
+
+void TEST_histogram() {
+  mymuduo::Histogram histogram(3600LL * 1000 * 1000);
+  for (int64_t value = 1; value <= 1000000; ++value) {
+    histogram.Record(value);
+  }
+  mymuduo::Histogram outliers(3600LL * 1000 * 1000);
+  outliers.RecordN(100000000, 10000);
+  histogram.Merge(outliers);
+  // 3 significant digits: p50 within 0.1% of 505000, p99 of 999900.
+  printf("histogram count=%lld min=%lld max=%lld p50=%lld p99=%lld p99.9=%lld\n",
+         static_cast<long long>(histogram.Count()), static_cast<long long>(histogram.Min()),
+         static_cast<long long>(histogram.Max()),
+         static_cast<long long>(histogram.ValueAtPercentile(50)),
+         static_cast<long long>(histogram.ValueAtPercentile(99)),
+         static_cast<long long>(histogram.ValueAtPercentile(99.9)));
+}
+
+void TEST_thread_pool() {
+  mymuduo::ThreadPool pool("test");
+  mymuduo::MutexLock mtx;
+  int inits = 0;
+  pool.SetThreadInitCallback([&]() {
+    mymuduo::MutexLockGuard lock(mtx);
+    ++inits;
+  });
+  pool.Start(3);
+  mymuduo::CountDownLatch latch(100);
+  int sum = 0;
+  for (int i = 1; i <= 100; ++i) {
+    pool.Run([&, i]() {
+      {
+        mymuduo::MutexLockGuard lock(mtx);
+        sum += i;
+      }
+      latch.CountDown();
+    });
+  }
+  latch.Wait();
+  pool.Stop();
+  printf("thread pool: threads initialized=%d, sum=%d\n", inits, sum);
+  const pthread_t caller = pthread_self();
+  bool inline_after_stop = false;
+  pool.Run([&]() { inline_after_stop = pthread_equal(pthread_self(), caller); });
+  printf("thread pool: run after stop in the caller: %s\n", inline_after_stop ? "yes" : "no");
+}
+
+namespace test_mmap_log_file {
+
+std::vector<std::string> ListDir(const std::string& dir) {
+  std::vector<std::string> files;
+  DIR* d = ::opendir(dir.c_str());
+  while (struct dirent* entry = ::readdir(d)) {
+    if (entry->d_name[0] != '.') {
+      files.push_back(dir + "/" + entry->d_name);
+    }
+  }
+  ::closedir(d);
+  return files;
+}
+
+void RemoveDir(const std::string& dir) {
+  for (const std::string& file : ListDir(dir)) {
+    ::unlink(file.c_str());
+  }
+  ::rmdir(dir.c_str());
+}
+
+}  // namespace test_mmap_log_file
+
+void TEST_mmap_log_file() {
+  using namespace test_mmap_log_file;
+  using mymuduo::MmapLogFile;
+
+  char dir[] = "/tmp/mmap_log_file.XXXXXX";
+  if (!::mkdtemp(dir)) {
+    perror("mkdtemp");
+    return;
+  }
+  char record[128];
+  {
+    MmapLogFile file(std::string(dir) + "/roll", 4096);
+    for (int i = 0; i < 100; ++i) {
+      int n = snprintf(record, sizeof(record), "record %-90d", i);
+      file.Append(record, n);
+    }
+    printf("mmap log file: %d segments for 100 records\n", file.segment_num());
+  }
+  int records = 0;
+  bool sized = true;
+  for (const std::string& segment : ListDir(dir)) {
+    struct stat st;
+    ::stat(segment.c_str(), &st);
+    // Closed segments hold only their records.
+    sized = sized && MmapLogFile::Recover(segment, [&](const char*, size_t) { ++records; }) ==
+                     st.st_size;
+  }
+  printf("mmap log file: %d records back, segments cut to size: %s\n", records,
+         sized ? "yes" : "no");
+  RemoveDir(dir);
+
+  // A crash: the segment stays at full size, with a torn record at the end.
+  ::mkdtemp(strcpy(dir, "/tmp/mmap_log_file.XXXXXX"));
+  pid_t pid = ::fork();
+  if (pid == 0) {
+    MmapLogFile* file = new MmapLogFile(std::string(dir) + "/crash", 1 << 20);
+    for (int i = 0; i < 10; ++i) {
+      int n = snprintf(record, sizeof(record), "record %d", i);
+      file->Append(record, n);
+    }
+    // Half a record: its header, and the payload only partly there.
+    const uint32_t header[2] = {100, 12345};
+    ::pwrite(::open(file->filename().c_str(), O_WRONLY), header, sizeof(header),
+             static_cast<off_t>(file->written_bytes()));
+    _exit(0);
+  }
+  ::waitpid(pid, nullptr, 0);
+  const std::string segment = ListDir(dir).at(0);
+  std::string last;
+  records = 0;
+  MmapLogFile::Recover(segment, [&](const char* data, size_t len) {
+    ++records;
+    last.assign(data, len);
+  });
+  struct stat st;
+  ::stat(segment.c_str(), &st);
+  printf("mmap log file: after a crash %d records kept, last \"%s\", file cut to %lld of %d\n",
+         records, last.c_str(), static_cast<long long>(st.st_size), 1 << 20);
+  RemoveDir(dir);
+}
+
+void TEST_binary_log() {
+  using mymuduo::BinaryLog;
+
+  char dir[] = "/tmp/binary_log.XXXXXX";
+  if (!::mkdtemp(dir)) {
+    perror("mkdtemp");
+    return;
+  }
+  // Small segments: every one of them must decode alone.
+  BinaryLog::Start(std::string(dir) + "/blog", 0.01, 64 * 1024);
+  {
+    mymuduo::ThreadPool pool("BinaryLogTest");
+    pool.Start(4);
+    for (int t = 0; t < 4; ++t) {
+      pool.Run([t]() {
+        const std::string name = "worker" + std::to_string(t);
+        for (int i = 0; i < 1000; ++i) {
+          BLOG("%s line %d, %.2f %c %p", name.c_str(), i, i / 4.0, 'a' + t, nullptr);
+        }
+      });
+    }
+    pool.Stop();
+  }
+  BLOG("main %s %llu", "done", static_cast<unsigned long long>(-1));
+  BinaryLog::Stop();
+
+  int64_t entries = 0;
+  int segments = 0;
+  std::string first;
+  std::string last;
+  for (const std::string& segment : test_mmap_log_file::ListDir(dir)) {
+    FILE* fp = tmpfile();
+    entries += BinaryLog::DecodeFile(segment, fp);
+    ++segments;
+    rewind(fp);
+    char line[256];
+    while (fgets(line, sizeof(line), fp)) {
+      if (strstr(line, "unknown site") || strstr(line, "dropped")) {
+        printf("binary log: undecoded %s", line);
+      }
+      if (strstr(line, "worker0 line 0,")) {
+        first = line;
+      }
+      if (strstr(line, "main done")) {
+        last = line;
+      }
+    }
+    fclose(fp);
+  }
+  printf("binary log: %lld entries in %d segments\n", static_cast<long long>(entries), segments);
+  printf("binary log: %s", first.c_str());
+  printf("binary log: %s", last.c_str());
+  test_mmap_log_file::RemoveDir(dir);
+}
+
+void TEST_latency_recorder() {
+  mymuduo::LatencyRecorder recorder("test", 1000000);
+  mymuduo::ThreadPool pool("LatencyTest");
+  pool.Start(4);
+  mymuduo::CountDownLatch latch(4);
+  for (int t = 0; t < 4; ++t) {
+    pool.Run([&]() {
+      for (int i = 1; i <= 10000; ++i) {
+        recorder.Record(i);
+      }
+      latch.CountDown();
+    });
+  }
+  latch.Wait();
+  recorder.Merge();  // the threads are still there
+  printf("latency recorder: %s\n", recorder.DumpText().c_str());
+  pool.Stop();
+  recorder.Merge();  // their counts kept once they are gone
+  printf("latency recorder: %s\n", recorder.DumpText().c_str());
+  for (int i = 0; i < 1000; ++i) {
+    recorder.Record(42000);
+  }
+  recorder.Merge();
+  printf("latency recorder: %s\n", recorder.DumpJson(1000).c_str());
+
+  // More recorders at once than there are pthread keys.
+  std::vector<std::unique_ptr<mymuduo::LatencyRecorder>> recorders;
+  int64_t count = 0;
+  for (int i = 0; i < 1100; ++i) {
+    recorders.emplace_back(new mymuduo::LatencyRecorder("many", 1000));
+    recorders.back()->Record(i % 1000);
+  }
+  for (const auto& many : recorders) {
+    many->Merge();
+    count += many->Snapshot().Count();
+  }
+  recorders.clear();
+  // Takes the id of one just destroyed, with none of its counts.
+  mymuduo::LatencyRecorder reused("reused", 1000);
+  reused.Record(1);
+  reused.Merge();
+  printf("latency recorder: 1100 recorders counted %lld, a reused one %lld\n",
+         static_cast<long long>(count), static_cast<long long>(reused.Snapshot().Count()));
+}
+
+void TEST_stats() {
+  using mymuduo::Stats;
+
+  Stats::GetCounter("test.requests")->Add(3);
+  Stats::GetCounter("test.requests")->Add();  // the same series
+  Stats::GetGauge("test.depth", mymuduo::CurrentThread::Tid())->Set(7);
+  mymuduo::MutexLock mtx;
+  mymuduo::LatencyRecorder* wait_ns = Stats::GetHistogram("test.lock_wait_ns");
+  for (int i = 0; i < 1000; ++i) {
+    mymuduo::TimedMutexLockGuard lock(mtx, wait_ns);
+  }
+  // TEST_thread_pool() ran a pool named "test".
+  const std::string text = Stats::DumpText();
+  size_t begin = 0;
+  for (size_t end = text.find('\n'); end != std::string::npos; end = text.find('\n', begin)) {
+    const std::string line = text.substr(begin, end - begin);
+    if (line.find(" test.") != std::string::npos ||
+        line.find("thread_pool.test.tasks") != std::string::npos) {
+      printf("stats: %.120s\n", line.c_str());
+    }
+    begin = end + 1;
+  }
+  const std::string json = Stats::DumpJson();
+  printf("stats: json %zu bytes, %s\n", json.size(),
+         json.find("\"test.requests\": 4") != std::string::npos ? "test.requests 4" : "missing");
+}
+
+namespace test_cpu_topology {
+
+// A fake sysfs tree, removed in reverse when done.
+class FakeSysfs {
+ public:
+  explicit FakeSysfs(const std::string& root) : root_(root) {}
+
+  ~FakeSysfs() {
+    for (auto it = paths_.rbegin(); it != paths_.rend(); ++it) {
+      if (::unlink(it->c_str()) < 0) {
+        ::rmdir(it->c_str());
+      }
+    }
+    ::rmdir(root_.c_str());
+  }
+
+  void Write(const std::string& file, const std::string& content) {
+    std::string path = root_;
+    for (size_t slash = file.find('/'); slash != std::string::npos;
+         slash = file.find('/', slash + 1)) {
+      path = root_ + "/" + file.substr(0, slash);
+      if (::mkdir(path.c_str(), 0755) == 0) {
+        paths_.push_back(path);
+      }
+    }
+    path = root_ + "/" + file;
+    FILE* fp = fopen(path.c_str(), "w");
+    fprintf(fp, "%s\n", content.c_str());
+    fclose(fp);
+    paths_.push_back(path);
+  }
+
+ private:
+  const std::string root_;
+  std::vector<std::string> paths_;
+};
+
+std::string Join(const std::vector<int>& cpus) {
+  std::string joined;
+  for (int cpu : cpus) {
+    joined.append(joined.empty() ? "" : ",").append(std::to_string(cpu));
+  }
+  return joined;
+}
+
+}  // namespace test_cpu_topology
+
+void TEST_cpu_topology() {
+  using namespace test_cpu_topology;
+  using mymuduo::CpuTopology;
+
+  // 2 packages (and NUMA nodes) x 2 cores x 2 hyperthreads, numbered the
+  // way Intel does: cpu 0-3 are the first threads, 4-7 their siblings.
+  char dir[] = "/tmp/cpu_topology.XXXXXX";
+  if (!::mkdtemp(dir)) {
+    perror("mkdtemp");
+    return;
+  }
+  {
+    FakeSysfs sysfs(dir);
+    sysfs.Write("online", "0-7");
+    for (int cpu = 0; cpu < 8; ++cpu) {
+      const std::string cpu_dir = "cpu" + std::to_string(cpu) + "/";
+      const int core = cpu % 4;
+      const int package = core / 2;
+      const std::string siblings = std::to_string(core) + "," + std::to_string(core + 4);
+      const std::string package_cpus = package ? "2-3,6-7" : "0-1,4-5";
+      sysfs.Write(cpu_dir + "topology/physical_package_id", std::to_string(package));
+      sysfs.Write(cpu_dir + "topology/thread_siblings_list", siblings);
+      sysfs.Write(cpu_dir + "node" + std::to_string(package) + "/cpulist", package_cpus);
+      const struct {
+        const char* level;
+        const char* type;
+        std::string shared;
+      } caches[] = {{"1", "Data", siblings},
+                    {"1", "Instruction", siblings},
+                    {"2", "Unified", siblings},
+                    {"3", "Unified", package_cpus}};
+      for (int index = 0; index < 4; ++index) {
+        const std::string cache_dir = cpu_dir + "cache/index" + std::to_string(index) + "/";
+        sysfs.Write(cache_dir + "level", caches[index].level);
+        sysfs.Write(cache_dir + "type", caches[index].type);
+        sysfs.Write(cache_dir + "shared_cpu_list", caches[index].shared);
+      }
+    }
+    CpuTopology topology(dir);
+    printf("cpu topology: fake %d packages, %d cores, %zu cpus, %d nodes\n",
+           topology.package_count(), topology.core_count(), topology.cpus().size(),
+           topology.node_count());
+    printf("cpu topology: compact %s (expect 0,4,1,5,2,6,3,7)\n",
+           Join(topology.Order(CpuTopology::kCompact)).c_str());
+    printf("cpu topology: scatter %s (expect 0,2,1,3,4,6,5,7)\n",
+           Join(topology.Order(CpuTopology::kScatter)).c_str());
+    printf("cpu topology: physical core %s (expect 0,1,2,3)\n",
+           Join(topology.Order(CpuTopology::kPhysicalCore)).c_str());
+    // Compute threads off the cores of the I/O threads on cpu 0 and 2.
+    printf("cpu topology: 4 compute threads avoiding 0,2 %s (expect 1,3,1,3)\n",
+           Join(topology.Place(CpuTopology::kPhysicalCore, 4, {0, 2})).c_str());
+  }
+
+  const CpuTopology& topology = CpuTopology::Get();
+  const std::string text = topology.ToString();
+  printf("cpu topology: this machine %s", text.substr(0, text.find('\n') + 1).c_str());
+  const std::vector<int> cpus = topology.Place(CpuTopology::kPhysicalCore, 2);
+  mymuduo::ThreadPool pool("cpu_topology");
+  pool.SetThreadCpus(cpus);
+  pool.Start(2);
+  mymuduo::CountDownLatch latch(2);
+  mymuduo::MutexLock mtx;
+  std::vector<int> ran_on;
+  for (int i = 0; i < 2; ++i) {
+    pool.Run([&]() {
+      {
+        mymuduo::MutexLockGuard lock(mtx);
+        ran_on.push_back(::sched_getcpu());
+      }
+      latch.CountDown();
+    });
+  }
+  latch.Wait();
+  pool.Stop();
+  bool pinned = true;
+  for (int cpu : ran_on) {
+    pinned = pinned && std::find(cpus.begin(), cpus.end(), cpu) != cpus.end();
+  }
+  printf("cpu topology: pool pinned to %s, ran on %s: %s\n", Join(cpus).c_str(),
+         Join(ran_on).c_str(), pinned ? "ok" : "FAIL");
+}
+
 int main(void) {
   TEST_thread_local();
+  TEST_arena();
+  TEST_histogram();
+  TEST_latency_recorder();
+  TEST_thread_pool();
+  TEST_mmap_log_file();
+  TEST_binary_log();
+  TEST_stats();
+  TEST_cpu_topology();
   return 0;
 }
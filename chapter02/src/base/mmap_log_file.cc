@@ -0,0 +1,239 @@
+#include "mmap_log_file.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+#include "common.h"
+
+namespace mymuduo {
+
+namespace {
+
+// Appends between two looks at the clock for the time based roll.
+const int kCheckTimeRoll = 1024;
+const size_t kPageSize = 4096;
+
+// Eight bytes at a time, multiply and fold: enough to tell a torn record
+// from a complete one at a few ns per record. Never 0, so an all zero
+// header, the preallocated space after the last record, never matches.
+uint32_t Checksum(uint32_t len, const char* data) {
+  uint64_t hash = 0x9e3779b97f4a7c15ull ^ len;
+  size_t i = 0;
+  for (; i + 8 <= len; i += 8) {
+    uint64_t word;
+    memcpy(&word, data + i, sizeof(word));
+    hash = (hash ^ word) * 0xff51afd7ed558ccdull;
+    hash ^= hash >> 32;
+  }
+  if (i < len) {
+    uint64_t word = 0;
+    memcpy(&word, data + i, len - i);
+    hash = (hash ^ word) * 0xff51afd7ed558ccdull;
+    hash ^= hash >> 32;
+  }
+  return static_cast<uint32_t>(hash) | 1;
+}
+
+}  // namespace
+
+MmapLogFile::MmapLogFile(const std::string& basename, size_t segment_bytes, int roll_seconds,
+                         size_t sync_bytes)
+    : basename_(basename),
+      segment_bytes_(segment_bytes),
+      roll_seconds_(roll_seconds > 0 ? roll_seconds : 24 * 3600),
+      sync_bytes_(sync_bytes),
+      syncer_("MmapLogSync") {
+  syncer_.Start(1);
+}
+
+MmapLogFile::~MmapLogFile() {
+  CloseSegment();
+  syncer_.Stop();
+}
+
+bool MmapLogFile::Append(const char* data, size_t len) {
+  const size_t record_bytes = kHeaderSize + len;
+  if (record_bytes > segment_bytes_) {
+    return false;
+  }
+  if (++appends_since_check_ >= kCheckTimeRoll && !rolling_) {
+    appends_since_check_ = 0;
+    const time_t now = ::time(nullptr);
+    if (now / roll_seconds_ * roll_seconds_ != period_start_ && !RollFile(now)) {
+      return false;
+    }
+  }
+  if (UNLIKELY(!data_ || written_ + record_bytes > segment_bytes_)) {
+    if (rolling_ || !RollFile(::time(nullptr))) {
+      return false;
+    }
+    if (written_ + record_bytes > segment_bytes_) {
+      return false;  // what the segment callback put left no room
+    }
+  }
+
+  // The payload first: a header is never complete in memory before it.
+  char* record = data_ + written_;
+  memcpy(record + kHeaderSize, data, len);
+  const uint32_t len32 = static_cast<uint32_t>(len);
+  const uint32_t checksum = Checksum(len32, data);
+  memcpy(record, &len32, sizeof(len32));
+  memcpy(record + sizeof(len32), &checksum, sizeof(checksum));
+  written_ += record_bytes;
+  if (written_ - synced_ >= sync_bytes_) {
+    Flush();
+  }
+  return true;
+}
+
+void MmapLogFile::Flush() {
+  if (fd_ < 0 || written_ == synced_) {
+    return;
+  }
+  // Submitting the writeback takes about as long as the disk needs to
+  // take the batch in, off this thread.
+  const int fd = fd_;
+  const off_t offset = static_cast<off_t>(synced_);
+  const off_t len = static_cast<off_t>(written_ - synced_);
+  syncer_.Run([fd, offset, len]() { ::sync_file_range(fd, offset, len, SYNC_FILE_RANGE_WRITE); });
+  synced_ = written_;
+  Prefault();
+}
+
+void MmapLogFile::Prefault() {
+  // One call maps the pages of the next batch, instead of a write fault
+  // every 4KB in Append().
+  const size_t begin = std::max(prefaulted_, written_) & ~(kPageSize - 1);
+  const size_t end = std::min(written_ + 2 * sync_bytes_, segment_bytes_) & ~(kPageSize - 1);
+  if (begin < end && ::madvise(data_ + begin, end - begin, MADV_POPULATE_WRITE) == 0) {
+    prefaulted_ = end;
+  }
+}
+
+bool MmapLogFile::RollFile(time_t now) {
+  CloseSegment();
+  period_start_ = now / roll_seconds_ * roll_seconds_;
+  appends_since_check_ = 0;
+
+  char timebuf[32];
+  struct tm tm;
+  ::localtime_r(&now, &tm);
+  strftime(timebuf, sizeof(timebuf), ".%Y%m%d-%H%M%S.", &tm);
+  filename_ = basename_ + timebuf + std::to_string(::getpid()) + "." +
+              std::to_string(segment_num_) + ".log";
+
+  fd_ = ::open(filename_.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd_ < 0) {
+    fprintf(stderr, "MmapLogFile: open %s: %s\n", filename_.c_str(), strerror(errno));
+    return false;
+  }
+  // Blocks reserved up front: no page fault has to allocate one later.
+  int err = ::posix_fallocate(fd_, 0, static_cast<off_t>(segment_bytes_));
+  if (err == EOPNOTSUPP || err == EINVAL) {
+    err = ::ftruncate(fd_, static_cast<off_t>(segment_bytes_)) < 0 ? errno : 0;
+  }
+  void* data = MAP_FAILED;
+  if (err == 0) {
+    data = ::mmap(nullptr, segment_bytes_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+    err = data == MAP_FAILED ? errno : 0;
+  }
+  if (err != 0) {
+    fprintf(stderr, "MmapLogFile: segment %s: %s\n", filename_.c_str(), strerror(err));
+    ::close(fd_);
+    fd_ = -1;
+    return false;
+  }
+  data_ = static_cast<char*>(data);
+  prefaulted_ = 0;
+  Prefault();
+  ++segment_num_;
+  if (segment_callback_) {
+    rolling_ = true;
+    segment_callback_();
+    rolling_ = false;
+  }
+  return true;
+}
+
+void MmapLogFile::CloseSegment() {
+  if (fd_ < 0) {
+    return;
+  }
+  Flush();
+  ::munmap(data_, segment_bytes_);
+  const int fd = fd_;
+  const off_t written = static_cast<off_t>(written_);
+  const std::string filename = filename_;
+  syncer_.Run([fd, written, filename]() {
+    if (::ftruncate(fd, written) < 0) {
+      fprintf(stderr, "MmapLogFile: ftruncate %s: %s\n", filename.c_str(), strerror(errno));
+    }
+    ::close(fd);
+  });
+  fd_ = -1;
+  data_ = nullptr;
+  written_ = 0;
+  synced_ = 0;
+}
+
+size_t MmapLogFile::Scan(const char* data, size_t len, const RecordCallback& cb) {
+  size_t pos = 0;
+  while (len - pos >= kHeaderSize) {
+    uint32_t record_len = 0;
+    uint32_t checksum = 0;
+    memcpy(&record_len, data + pos, sizeof(record_len));
+    memcpy(&checksum, data + pos + sizeof(record_len), sizeof(checksum));
+    if (record_len > len - pos - kHeaderSize ||
+        Checksum(record_len, data + pos + kHeaderSize) != checksum) {
+      break;
+    }
+    if (cb) {
+      cb(data + pos + kHeaderSize, record_len);
+    }
+    pos += kHeaderSize + record_len;
+  }
+  return pos;
+}
+
+int64_t MmapLogFile::Recover(const std::string& filename, const RecordCallback& cb) {
+  const int fd = ::open(filename.c_str(), O_RDWR | O_CLOEXEC);
+  if (fd < 0) {
+    return -1;
+  }
+  struct stat st;
+  if (::fstat(fd, &st) < 0) {
+    const int saved_errno = errno;
+    ::close(fd);
+    errno = saved_errno;
+    return -1;
+  }
+  size_t valid = 0;
+  if (st.st_size > 0) {
+    void* data = ::mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    if (data == MAP_FAILED) {
+      const int saved_errno = errno;
+      ::close(fd);
+      errno = saved_errno;
+      return -1;
+    }
+    valid = Scan(static_cast<const char*>(data), st.st_size, cb);
+    ::munmap(data, st.st_size);
+  }
+  if (valid < static_cast<size_t>(st.st_size) && ::ftruncate(fd, static_cast<off_t>(valid)) < 0) {
+    const int saved_errno = errno;
+    ::close(fd);
+    errno = saved_errno;
+    return -1;
+  }
+  ::close(fd);
+  return static_cast<int64_t>(valid);
+}
+
+}  // namespace mymuduo
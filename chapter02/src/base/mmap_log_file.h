@@ -0,0 +1,89 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+#include <functional>
+#include <string>
+
+#include "thread_pool.h"
+
+namespace mymuduo {
+
+// Log file sink over preallocated, memory mapped segments.
+// A segment is fallocate()d to its full size and mmap()ed, Append() is a
+// memcpy into it. Every sync_bytes a background thread is asked to start
+// writeback of the batch with sync_file_range(), never waited for;
+// msync(MS_ASYNC) would do nothing on Linux. A new segment starts when a
+// record does not fit or at the next multiple of roll_seconds; the
+// background thread cuts the old one to what it holds and closes it.
+//
+// Each record is a 4-byte length, a 4-byte checksum of length and
+// payload, then the payload, so after a crash the segment left at full
+// size can be scanned up to its last complete record, see Recover().
+// Not thread safe: it is meant for the one thread flushing the log.
+class MmapLogFile {
+ public:
+  static const size_t kHeaderSize = 8;
+  using RecordCallback = std::function<void(const char* data, size_t len)>;
+  using SegmentCallback = std::function<void()>;
+
+  // Segments are named basename.YYYYmmdd-HHMMSS.pid.seq.log.
+  // The first segment is opened by the first Append().
+  MmapLogFile(const std::string& basename, size_t segment_bytes = 64 * 1024 * 1024,
+              int roll_seconds = 24 * 3600, size_t sync_bytes = 1024 * 1024);
+  ~MmapLogFile();
+
+  MmapLogFile(const MmapLogFile&) = delete;
+  MmapLogFile& operator=(const MmapLogFile&) = delete;
+
+  // Runs when a segment has been opened, the first one included if set
+  // before it; Append() from there puts records every segment must start
+  // with, such as what a reader of that segment alone needs to decode it.
+  void SetSegmentCallback(SegmentCallback cb) { segment_callback_ = std::move(cb); }
+
+  // False if the record can never fit a segment, or a segment cannot be
+  // created.
+  bool Append(const char* data, size_t len);
+  // Has writeback of what was appended since the last one started.
+  void Flush();
+
+  // The current segment.
+  const std::string& filename() const { return filename_; }
+  size_t written_bytes() const { return written_; }
+  int segment_num() const { return segment_num_; }
+
+  // Calls cb for every complete record in data; returns the bytes they
+  // take, where the valid part ends.
+  static size_t Scan(const char* data, size_t len, const RecordCallback& cb = nullptr);
+  // Cuts a segment left by a crash after its last complete record.
+  // Returns the bytes kept, -1 with errno if it cannot be opened.
+  static int64_t Recover(const std::string& filename, const RecordCallback& cb = nullptr);
+
+ private:
+  bool RollFile(time_t now);
+  void CloseSegment();
+  void Prefault();
+
+ private:
+  const std::string basename_;
+  const size_t segment_bytes_;
+  const int roll_seconds_;
+  const size_t sync_bytes_;
+
+  std::string filename_;
+  int fd_{-1};
+  char* data_{nullptr};
+  size_t written_{0};
+  size_t synced_{0};
+  size_t prefaulted_{0};
+  time_t period_start_{0};
+  int appends_since_check_{0};
+  int segment_num_{0};
+  bool rolling_{false};
+  SegmentCallback segment_callback_;
+  ThreadPool syncer_;  // one thread: a segment is closed after its syncs
+};
+
+}  // namespace mymuduo
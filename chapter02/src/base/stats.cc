@@ -0,0 +1,123 @@
+#include "stats.h"
+
+#include <map>
+#include <memory>
+#include <utility>
+
+namespace mymuduo {
+
+namespace {
+
+struct Registry {
+  MutexLock mtx;
+  std::map<std::string, std::unique_ptr<Counter>> counters;          // guarded by mtx
+  std::map<std::string, std::unique_ptr<Gauge>> gauges;              // guarded by mtx
+  std::map<std::string, std::unique_ptr<LatencyRecorder>> histograms;  // guarded by mtx
+};
+
+// Never destroyed: series are used from destructors of statics too.
+Registry& GetRegistry() {
+  static Registry* registry = new Registry;
+  return *registry;
+}
+
+std::string SeriesName(const std::string& name, int tid) {
+  return tid ? name + "{tid=" + std::to_string(tid) + "}" : name;
+}
+
+template <typename T, typename... Args>
+T* GetSeries(std::map<std::string, std::unique_ptr<T>>* series, const std::string& name,
+             Args&&... args) {
+  std::unique_ptr<T>& entry = (*series)[name];
+  if (!entry) {
+    entry.reset(new T(std::forward<Args>(args)...));
+  }
+  return entry.get();
+}
+
+std::string JsonString(const std::string& s) {
+  std::string quoted(1, '"');
+  for (char c : s) {
+    if (c == '"' || c == '\\') {
+      quoted.push_back('\\');
+    }
+    quoted.push_back(c);
+  }
+  quoted.push_back('"');
+  return quoted;
+}
+
+template <typename T>
+void AppendValues(const char* kind, const std::map<std::string, std::unique_ptr<T>>& series,
+                  bool json, std::string* out) {
+  if (json) {
+    out->append("\"").append(kind).append("s\": {");
+  }
+  bool first = true;
+  for (const auto& entry : series) {
+    const std::string value = std::to_string(entry.second->value());
+    if (json) {
+      out->append(first ? "" : ", ").append(JsonString(entry.first)).append(": ").append(value);
+    } else {
+      out->append(kind).append(" ").append(entry.first).append(" ").append(value).append("\n");
+    }
+    first = false;
+  }
+  if (json) {
+    out->append("}");
+  }
+}
+
+}  // namespace
+
+Counter* Stats::GetCounter(const std::string& name, int tid) {
+  Registry& registry = GetRegistry();
+  MutexLockGuard lock(registry.mtx);
+  return GetSeries(&registry.counters, SeriesName(name, tid));
+}
+
+Gauge* Stats::GetGauge(const std::string& name, int tid) {
+  Registry& registry = GetRegistry();
+  MutexLockGuard lock(registry.mtx);
+  return GetSeries(&registry.gauges, SeriesName(name, tid));
+}
+
+LatencyRecorder* Stats::GetHistogram(const std::string& name, int tid) {
+  Registry& registry = GetRegistry();
+  MutexLockGuard lock(registry.mtx);
+  const std::string series_name = SeriesName(name, tid);
+  return GetSeries(&registry.histograms, series_name, series_name);
+}
+
+std::string Stats::DumpText() {
+  Registry& registry = GetRegistry();
+  std::string text;
+  MutexLockGuard lock(registry.mtx);
+  AppendValues("counter", registry.counters, false, &text);
+  AppendValues("gauge", registry.gauges, false, &text);
+  for (const auto& entry : registry.histograms) {
+    entry.second->Merge();
+    text.append("histogram ").append(entry.second->DumpText()).append("\n");
+  }
+  return text;
+}
+
+std::string Stats::DumpJson() {
+  Registry& registry = GetRegistry();
+  std::string json = "{";
+  MutexLockGuard lock(registry.mtx);
+  AppendValues("counter", registry.counters, true, &json);
+  json.append(", ");
+  AppendValues("gauge", registry.gauges, true, &json);
+  json.append(", \"histograms\": [");
+  bool first = true;
+  for (const auto& entry : registry.histograms) {
+    entry.second->Merge();
+    json.append(first ? "" : ", ").append(entry.second->DumpJson());
+    first = false;
+  }
+  json.append("]}\n");
+  return json;
+}
+
+}  // namespace mymuduo
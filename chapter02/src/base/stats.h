@@ -0,0 +1,76 @@
+#pragma once
+
+#include <pthread.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <string>
+
+#include "latency_recorder.h"
+#include "mutex.h"
+
+namespace mymuduo {
+
+// Any thread. Monotonic.
+class Counter {
+ public:
+  void Add(int64_t n = 1) { value_.fetch_add(n, std::memory_order_relaxed); }
+  int64_t value() const { return value_.load(std::memory_order_relaxed); }
+
+ private:
+  std::atomic<int64_t> value_{0};
+};
+
+// Any thread. The last value set, e.g. a queue depth.
+class Gauge {
+ public:
+  void Set(int64_t value) { value_.store(value, std::memory_order_relaxed); }
+  void Add(int64_t n) { value_.fetch_add(n, std::memory_order_relaxed); }
+  int64_t value() const { return value_.load(std::memory_order_relaxed); }
+
+ private:
+  std::atomic<int64_t> value_{0};
+};
+
+// Named statistics of the process, to look inside it while it runs.
+// A series is created on first use and never freed, so a pointer looked up
+// once, e.g. in a constructor, stays good for the whole process. A tid
+// label makes one series per thread, named name{tid=1234}; it outlives
+// the thread, and a thread that gets the id again adds to it.
+class Stats {
+ public:
+  static Counter* GetCounter(const std::string& name, int tid = 0);
+  static Gauge* GetGauge(const std::string& name, int tid = 0);
+  // Values in ns.
+  static LatencyRecorder* GetHistogram(const std::string& name, int tid = 0);
+
+  // Every series sorted by name, one per line. Histograms are merged
+  // first; their interval is what came since the previous dump.
+  static std::string DumpText();
+  // {"counters": {name: value}, "gauges": {...}, "histograms": [...]}
+  static std::string DumpJson();
+};
+
+// MutexLockGuard that records how long the lock was waited for, 0 when it
+// was free. The fast path costs a trylock and a LatencyRecorder::Record().
+class TimedMutexLockGuard {
+ public:
+  TimedMutexLockGuard(MutexLock& mtx_lock, LatencyRecorder* wait_ns) : mtx_lock_(mtx_lock) {
+    if (pthread_mutex_trylock(mtx_lock_.GetMutex()) == 0) {
+      wait_ns->Record(0);
+    } else {
+      LatencyRecorder::Timer timer(wait_ns);
+      mtx_lock_.Lock();
+    }
+  }
+
+  TimedMutexLockGuard(const TimedMutexLockGuard&) = delete;
+  TimedMutexLockGuard& operator=(const TimedMutexLockGuard&) = delete;
+
+  ~TimedMutexLockGuard() { mtx_lock_.UnLock(); }
+
+ private:
+  MutexLock& mtx_lock_;
+};
+
+}  // namespace mymuduo
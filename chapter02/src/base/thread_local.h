@@ -25,6 +25,15 @@ class ThreadLocal {
     return *per_thread_val;
   }
 
+  // Destroys the value of the calling thread, if it has one.
+  void Reset() {
+    T* per_thread_val = static_cast<T*>(pthread_getspecific(pkey_));
+    if (per_thread_val) {
+      MCHECK(pthread_setspecific(pkey_, nullptr));
+      delete per_thread_val;
+    }
+  }
+
  private:
   static void dtor(void* x) {
     T* obj = static_cast<T*>(x);
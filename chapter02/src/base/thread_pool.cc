@@ -0,0 +1,103 @@
+#include "thread_pool.h"
+
+#include "cpu_topology.h"
+#include "stats.h"
+
+namespace mymuduo {
+
+ThreadPool::ThreadPool(const std::string& name)
+    : name_(name),
+      not_empty_(mtx_),
+      started_(0),
+      running_(false),
+      queue_depth_(Stats::GetGauge("thread_pool." + name + ".queue")),
+      tasks_(Stats::GetCounter("thread_pool." + name + ".tasks")),
+      lock_wait_ns_(Stats::GetHistogram("thread_pool." + name + ".lock_wait_ns")) {}
+
+ThreadPool::~ThreadPool() {
+  if (running_) {
+    Stop();
+  }
+}
+
+void ThreadPool::Start(int thread_num) {
+  {
+    MutexLockGuard lock(mtx_);
+    running_ = thread_num > 0;
+    started_ = 0;
+  }
+  threads_.resize(thread_num);
+  for (pthread_t& thread : threads_) {
+    MCHECK(pthread_create(&thread, nullptr, ThreadRoutine, this));
+  }
+}
+
+void ThreadPool::Stop() {
+  {
+    MutexLockGuard lock(mtx_);
+    running_ = false;
+    not_empty_.NotifyAll();
+  }
+  for (pthread_t thread : threads_) {
+    MCHECK(pthread_join(thread, nullptr));
+  }
+  threads_.clear();
+}
+
+void ThreadPool::Run(Task task) {
+  {
+    TimedMutexLockGuard lock(mtx_, lock_wait_ns_);
+    // Queued before Stop() flips running_, a task is still taken: the
+    // threads drain the queue before they exit.
+    if (running_) {
+      queue_.push_back(std::move(task));
+      queue_depth_->Set(static_cast<int64_t>(queue_.size()));
+      not_empty_.Notify();
+      return;
+    }
+  }
+  task();
+}
+
+size_t ThreadPool::QueueSize() const {
+  MutexLockGuard lock(mtx_);
+  return queue_.size();
+}
+
+bool ThreadPool::Take(Task* task) {
+  TimedMutexLockGuard lock(mtx_, lock_wait_ns_);
+  while (queue_.empty() && running_) {
+    not_empty_.Wait();
+  }
+  if (queue_.empty()) {
+    return false;
+  }
+  *task = std::move(queue_.front());
+  queue_.pop_front();
+  queue_depth_->Set(static_cast<int64_t>(queue_.size()));
+  tasks_->Add();
+  return true;
+}
+
+void* ThreadPool::ThreadRoutine(void* arg) {
+  ThreadPool* pool = static_cast<ThreadPool*>(arg);
+  if (!pool->thread_cpus_.empty()) {
+    int index;
+    {
+      MutexLockGuard lock(pool->mtx_);
+      index = pool->started_++;
+    }
+    PinCurrentThread(pool->thread_cpus_[index % pool->thread_cpus_.size()]);
+  }
+  if (pool->thread_init_callback_) {
+    pool->thread_init_callback_();
+  }
+  Task task;
+  while (pool->Take(&task)) {
+    task();
+    task = nullptr;  // drop what it holds before waiting again
+  }
+  return nullptr;
+}
+
+}  // namespace mymuduo
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <pthread.h>
+#include <stddef.h>
+
+#include <deque>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "condition.h"
+#include "mutex.h"
+
+namespace mymuduo {
+
+class Counter;
+class Gauge;
+class LatencyRecorder;
+
+// Fixed number of threads taking tasks from one queue, guarded by a
+// MutexLock and waited on with a Condition.
+// Run() is thread safe. Stop() lets the queued tasks finish, then joins.
+// Without threads running, i.e. before Start(), with 0 threads or once
+// Stop() began, Run() runs the task in the caller.
+// Keeps the Stats thread_pool.<name>.queue (depth), .tasks and
+// .lock_wait_ns, shared by the pools of one name.
+class ThreadPool {
+ public:
+  using Task = std::function<void()>;
+
+  explicit ThreadPool(const std::string& name = "ThreadPool");
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  const std::string& name() const { return name_; }
+  int thread_num() const { return static_cast<int>(threads_.size()); }
+
+  // Runs first in every pool thread, e.g. to set its priority or affinity.
+  // Set before Start.
+  void SetThreadInitCallback(Task cb) { thread_init_callback_ = std::move(cb); }
+  // Pins the i-th thread started to cpus[i % size] before that, e.g. with
+  // CpuTopology::Place(). Set before Start.
+  void SetThreadCpus(std::vector<int> cpus) { thread_cpus_ = std::move(cpus); }
+
+  void Start(int thread_num);
+  void Stop();
+
+  void Run(Task task);
+  size_t QueueSize() const;
+
+ private:
+  static void* ThreadRoutine(void* arg);
+  // False once stopped and drained.
+  bool Take(Task* task);
+
+ private:
+  const std::string name_;
+  mutable MutexLock mtx_;
+  Condition not_empty_;
+  std::deque<Task> queue_;
+  std::vector<pthread_t> threads_;
+  Task thread_init_callback_;
+  std::vector<int> thread_cpus_;
+  int started_;  // guarded by mtx_
+  bool running_;
+  Gauge* const queue_depth_;
+  Counter* const tasks_;
+  LatencyRecorder* const lock_wait_ns_;
+};
+
+}  // namespace mymuduo
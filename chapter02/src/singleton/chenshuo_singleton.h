@@ -8,6 +8,8 @@
 //
 namespace mymuduo {
 
+namespace chenshuo {
+
 class Singleton {
  public:
   static Singleton& GetInstance() {
@@ -33,4 +35,6 @@ class Singleton {
 Singleton* Singleton::value_ = nullptr;
 pthread_once_t Singleton::init_once_ = PTHREAD_ONCE_INIT;
 
+}  // namespace chenshuo
+
 }  // namespace mymuduo
@@ -7,6 +7,8 @@
 
 namespace mymuduo {
 
+namespace eager {
+
 class Singleton {
  public:
   static Singleton& GetInstance() {
@@ -29,4 +31,6 @@ class Singleton {
 
 Singleton* Singleton::value_ = Singleton::Init();
 
+}  // namespace eager
+
 }  // namespace mymuduo
@@ -8,6 +8,8 @@
 //
 namespace mymuduo {
 
+namespace kungli {
+
 class Singleton {
  public:
   static Singleton& GetInstance() {
@@ -44,4 +46,6 @@ Singleton* Singleton::value_ = nullptr;
 pthread_once_t Singleton::init_once_ = PTHREAD_ONCE_INIT;
 pthread_once_t Singleton::destroy_once_ = PTHREAD_ONCE_INIT;
 
+}  // namespace kungli
+
 }  // namespace mymuduo
@@ -1,8 +1,88 @@
-//#include "meyers_singleton.h"
-//#include "chenshuo_singleton.h"
-//#include "kungli_singleton.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "chenshuo_singleton.h"
 #include "eager_singleton.h"
+#include "kungli_singleton.h"
+#include "meyers_singleton.h"
+#include "singleton.h"
+#include "thread_local_singleton.h"
+
+using RoutineType = void*(*)(void *);
+
+constexpr int kMaxThreadNum = 32;
+constexpr int kIterNum = 1 << 24;
+
+struct Foo {
+  int val{0};
+};
+
+long long current_nanoseconds() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+// Keeps GetInstance() inside the loop: the result is used and every
+// iteration must assume memory has changed.
+template<typename T>
+inline void DoNotOptimize(T* ptr) {
+  asm volatile("" : : "r"(ptr) : "memory");
+}
+
+template<typename GetInstance>
+void* GetInstanceRoutine(void* args) {
+  for (int i = 0; i < kIterNum; ++i) {
+    DoNotOptimize(&GetInstance::Get());
+  }
+  (void) args;
+  return nullptr;
+}
+
+struct Eager { static auto& Get() { return mymuduo::eager::Singleton::GetInstance(); } };
+struct Meyers { static auto& Get() { return mymuduo::meyers::Singleton::GetInstance(); } };
+struct Chenshuo { static auto& Get() { return mymuduo::chenshuo::Singleton::GetInstance(); } };
+struct Kungli { static auto& Get() { return mymuduo::kungli::Singleton::GetInstance(); } };
+struct DoubleChecked { static auto& Get() { return mymuduo::Singleton<Foo>::GetInstance(); } };
+struct ThreadLocal { static auto& Get() { return mymuduo::ThreadLocalSingleton<Foo>::GetInstance(); } };
+
+void benchmark(const char* name, RoutineType routine) {
+  pthread_t tids[kMaxThreadNum];
+
+  printf("%-14s", name);
+  for (int thread_num = 1; thread_num <= kMaxThreadNum; thread_num <<= 1) {
+    auto begin = current_nanoseconds();
+    for (int i = 0; i < thread_num; ++i) {
+      if (pthread_create(tids + i, nullptr, routine, nullptr)) {
+        exit(EXIT_FAILURE);
+      }
+    }
+    for (int i = 0; i < thread_num; ++i) {
+      pthread_join(tids[i], nullptr);
+    }
+    auto end = current_nanoseconds();
+
+    double ops = static_cast<double>(thread_num) * kIterNum;
+    printf(" %8.3f", (end - begin) / ops);
+  }
+  printf("\n");
+}
 
 int main(void) {
+  printf("GetInstance() ns/op, wall time over all threads\n");
+  printf("%-14s", "threads");
+  for (int thread_num = 1; thread_num <= kMaxThreadNum; thread_num <<= 1) {
+    printf(" %8d", thread_num);
+  }
+  printf("\n");
+
+  benchmark("eager", GetInstanceRoutine<Eager>);
+  benchmark("meyers", GetInstanceRoutine<Meyers>);
+  benchmark("chenshuo", GetInstanceRoutine<Chenshuo>);
+  benchmark("kungli", GetInstanceRoutine<Kungli>);
+  benchmark("double-checked", GetInstanceRoutine<DoubleChecked>);
+  benchmark("thread-local", GetInstanceRoutine<ThreadLocal>);
   return 0;
 }
@@ -5,6 +5,8 @@
 
 namespace mymuduo {
 
+namespace meyers {
+
 class Singleton {
  public:
   static Singleton& GetInstance() {
@@ -20,4 +22,6 @@ class Singleton {
   ~Singleton() = default;
 };
 
+}  // namespace meyers
+
 }  // namespace mymuduo
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <pthread.h>
+
+#include <atomic>
+
+#include "common.h"
+
+// templated singleton
+// lazy loading
+// double-checked: an acquire load on the hot path,
+// pthread_once only until the instance is published.
+//
+namespace mymuduo {
+
+template<typename T>
+class Singleton {
+ public:
+  static T& GetInstance() {
+    T* value = value_.load(std::memory_order_acquire);
+    if (UNLIKELY(!value)) {
+      pthread_once(&init_once_, &Singleton::Init);
+      value = value_.load(std::memory_order_acquire);
+    }
+    return *value;
+  }
+
+  Singleton() = delete;
+  Singleton(const Singleton&) = delete;
+  Singleton& operator=(const Singleton&) = delete;
+
+ private:
+  static void Init() {
+    value_.store(new T(), std::memory_order_release);
+  }
+
+  static std::atomic<T*> value_;
+  static pthread_once_t init_once_;
+};
+
+template<typename T>
+std::atomic<T*> Singleton<T>::value_{nullptr};
+
+template<typename T>
+pthread_once_t Singleton<T>::init_once_ = PTHREAD_ONCE_INIT;
+
+}  // namespace mymuduo
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <assert.h>
+#include <pthread.h>
+
+#include "common.h"
+
+// per-thread singleton
+// lazy loading, one instance per thread backed by __thread,
+// destroyed at thread exit through a pthread key.
+//
+namespace mymuduo {
+
+template<typename T>
+class ThreadLocalSingleton {
+ public:
+  static T& GetInstance() {
+    if (UNLIKELY(!t_value_)) {
+      t_value_ = new T();
+      deleter_.Set(t_value_);
+    }
+    return *t_value_;
+  }
+
+  ThreadLocalSingleton() = delete;
+  ThreadLocalSingleton(const ThreadLocalSingleton&) = delete;
+  ThreadLocalSingleton& operator=(const ThreadLocalSingleton&) = delete;
+
+ private:
+  static void Destructor(void* obj) {
+    assert(obj == t_value_);
+    typedef char T_must_be_complete_type[sizeof(T) == 0 ? -1 : 0];
+    T_must_be_complete_type dummy; (void) dummy;
+    delete t_value_;
+    t_value_ = nullptr;
+  }
+
+  class Deleter {
+   public:
+    Deleter() { MCHECK(pthread_key_create(&pkey_, &ThreadLocalSingleton::Destructor)); }
+
+    Deleter(const Deleter&) = delete;
+    Deleter& operator=(const Deleter&) = delete;
+
+    ~Deleter() { MCHECK(pthread_key_delete(pkey_)); }
+
+    void Set(T* new_obj) {
+      assert(pthread_getspecific(pkey_) == nullptr);
+      MCHECK(pthread_setspecific(pkey_, new_obj));
+    }
+
+   private:
+    pthread_key_t pkey_;
+  };
+
+  static __thread T* t_value_;
+  static Deleter deleter_;
+};
+
+template<typename T>
+__thread T* ThreadLocalSingleton<T>::t_value_ = nullptr;
+
+template<typename T>
+typename ThreadLocalSingleton<T>::Deleter ThreadLocalSingleton<T>::deleter_;
+
+}  // namespace mymuduo
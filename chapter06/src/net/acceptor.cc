@@ -0,0 +1,113 @@
+#include "acceptor.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "event_loop.h"
+#include "inet_address.h"
+#include "sockets_ops.h"
+
+namespace mymuduo {
+
+namespace net {
+
+Acceptor::Acceptor(EventLoop* loop, const InetAddress& listen_addr, bool reuse_port)
+    : loop_(loop),
+      accept_socket_(sockets::CreateNonblockingOrDie()),
+      accept_channel_(loop, accept_socket_.fd()),
+      listening_(false),
+      idle_fd_(::open("/dev/null", O_RDONLY | O_CLOEXEC)) {
+  accept_socket_.SetReuseAddr(true);
+  accept_socket_.SetReusePort(reuse_port);
+  accept_socket_.BindAddress(listen_addr);
+  SetUpChannel();
+}
+
+Acceptor::Acceptor(EventLoop* loop, int listen_fd)
+    : loop_(loop),
+      accept_socket_(listen_fd),
+      accept_channel_(loop, accept_socket_.fd()),
+      listening_(false),
+      idle_fd_(::open("/dev/null", O_RDONLY | O_CLOEXEC)) {
+  ::fcntl(listen_fd, F_SETFL, ::fcntl(listen_fd, F_GETFL) | O_NONBLOCK);
+  SetUpChannel();
+}
+
+void Acceptor::SetUpChannel() {
+  if (loop_->SupportsCompletionReads()) {
+    accept_channel_.SetAcceptCallback([this](int connfd) { HandleAccept(connfd); });
+  } else {
+    accept_channel_.SetReadCallback([this]() { HandleRead(); });
+  }
+}
+
+Acceptor::~Acceptor() {
+  accept_channel_.DisableAll();
+  accept_channel_.Remove();
+  ::close(idle_fd_);
+}
+
+void Acceptor::Listen() {
+  loop_->AssertInLoopThread();
+  listening_ = true;
+  accept_socket_.Listen();
+  accept_channel_.EnableReading();
+}
+
+void Acceptor::HandleRead() {
+  loop_->AssertInLoopThread();
+  if (!accept_channel_.edge_triggered()) {
+    AcceptOne();
+    return;
+  }
+  for (int i = 0; i < kAcceptBudget; ++i) {
+    if (!AcceptOne()) {
+      return;
+    }
+  }
+  loop_->RequeueReadable(&accept_channel_);
+}
+
+bool Acceptor::AcceptOne() {
+  InetAddress peer_addr;
+  int connfd = accept_socket_.Accept(&peer_addr);
+  if (connfd < 0) {
+    int err = errno;
+    HandleAcceptError(err);
+    // Keep going after EMFILE, the pending connection has been dropped.
+    return err == EMFILE || err == ECONNABORTED || err == EINTR;
+  }
+  if (new_connection_callback_) {
+    new_connection_callback_(connfd, peer_addr);
+  } else {
+    sockets::Close(connfd);
+  }
+  return true;
+}
+
+void Acceptor::HandleAccept(int connfd) {
+  loop_->AssertInLoopThread();
+  if (connfd < 0) {
+    HandleAcceptError(-connfd);
+  } else if (new_connection_callback_) {
+    new_connection_callback_(connfd, InetAddress(sockets::GetPeerAddr(connfd)));
+  } else {
+    sockets::Close(connfd);
+  }
+}
+
+void Acceptor::HandleAcceptError(int err) {
+  if (err == EMFILE) {
+    ::close(idle_fd_);
+    idle_fd_ = ::accept(accept_socket_.fd(), nullptr, nullptr);
+    ::close(idle_fd_);
+    idle_fd_ = ::open("/dev/null", O_RDONLY | O_CLOEXEC);
+  }
+}
+
+}  // namespace net
+
+}  // namespace mymuduo
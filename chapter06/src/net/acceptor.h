@@ -0,0 +1,64 @@
+#pragma once
+
+#include <functional>
+
+#include "channel.h"
+#include "socket.h"
+
+namespace mymuduo {
+
+namespace net {
+
+class EventLoop;
+class InetAddress;
+
+// Accepts connections on a listening socket, in the loop thread.
+class Acceptor {
+ public:
+  using NewConnectionCallback = std::function<void(int sockfd, const InetAddress&)>;
+
+  Acceptor(EventLoop* loop, const InetAddress& listen_addr, bool reuse_port);
+  // Takes over a socket bound elsewhere, e.g. inherited from a prefork
+  // master; it may be listening already. Made non-blocking.
+  Acceptor(EventLoop* loop, int listen_fd);
+  ~Acceptor();
+
+  Acceptor(const Acceptor&) = delete;
+  Acceptor& operator=(const Acceptor&) = delete;
+
+  void SetNewConnectionCallback(NewConnectionCallback cb) { new_connection_callback_ = std::move(cb); }
+
+  // Edge triggered accept, up to kAcceptBudget connections per event.
+  void SetEdgeTriggered(bool on) { accept_channel_.SetEdgeTriggered(on); }
+  // EPOLLEXCLUSIVE, when the listening fd is shared by several loops.
+  void SetExclusive(bool on) { accept_channel_.SetExclusive(on); }
+
+  void Listen();
+  bool listening() const { return listening_; }
+
+  int fd() const { return accept_socket_.fd(); }
+
+ private:
+  static const int kAcceptBudget = 64;
+
+  void HandleRead();
+  // False once the backlog is empty.
+  bool AcceptOne();
+  void HandleAccept(int connfd);
+  void HandleAcceptError(int err);
+  void SetUpChannel();
+
+ private:
+  EventLoop* loop_;
+  Socket accept_socket_;
+  Channel accept_channel_;
+  NewConnectionCallback new_connection_callback_;
+  bool listening_;
+  // Held in reserve, so a pending connection can still be accepted and
+  // closed when the process runs out of fds, instead of spinning on it.
+  int idle_fd_;
+};
+
+}  // namespace net
+
+}  // namespace mymuduo
@@ -0,0 +1,36 @@
+#include "buffer.h"
+
+#include <errno.h>
+#include <sys/uio.h>
+
+namespace mymuduo {
+
+namespace net {
+
+const char Buffer::kCRLF[] = "\r\n";
+
+ssize_t Buffer::ReadFd(int fd, int* saved_errno) {
+  char extra_buf[kReadFdExtraBytes];
+  struct iovec vec[2];
+  const size_t writable = WritableBytes();
+  vec[0].iov_base = BeginWrite();
+  vec[0].iov_len = writable;
+  vec[1].iov_base = extra_buf;
+  vec[1].iov_len = sizeof(extra_buf);
+  // Skip the stack buffer when there is already enough room.
+  const int iovcnt = (writable < sizeof(extra_buf)) ? 2 : 1;
+  const ssize_t n = ::readv(fd, vec, iovcnt);
+  if (n < 0) {
+    *saved_errno = errno;
+  } else if (static_cast<size_t>(n) <= writable) {
+    writer_index_ += n;
+  } else {
+    writer_index_ = buffer_.size();
+    Append(extra_buf, n - writable);
+  }
+  return n;
+}
+
+}  // namespace net
+
+}  // namespace mymuduo
@@ -0,0 +1,203 @@
+#pragma once
+
+#include <assert.h>
+#include <endian.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/types.h>
+
+#include <algorithm>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "casts.h"
+
+namespace mymuduo {
+
+namespace net {
+
+// Byte buffer of a connection, modeled after org.jboss.netty.buffer.ChannelBuffer.
+//
+// +-------------------+------------------+------------------+
+// | prependable bytes |  readable bytes  |  writable bytes  |
+// +-------------------+------------------+------------------+
+// 0        <=    reader_index   <=   writer_index    <=     size
+class Buffer {
+ public:
+  static constexpr size_t kCheapPrepend = 8;
+  static constexpr size_t kInitialSize = 1024;
+
+  explicit Buffer(size_t initial_size = kInitialSize)
+      : buffer_(kCheapPrepend + initial_size),
+        reader_index_(kCheapPrepend),
+        writer_index_(kCheapPrepend) {}
+
+  void Swap(Buffer& rhs) {
+    buffer_.swap(rhs.buffer_);
+    std::swap(reader_index_, rhs.reader_index_);
+    std::swap(writer_index_, rhs.writer_index_);
+  }
+
+  size_t ReadableBytes() const { return writer_index_ - reader_index_; }
+  size_t WritableBytes() const { return buffer_.size() - writer_index_; }
+  size_t PrependableBytes() const { return reader_index_; }
+
+  const char* Peek() const { return Begin() + reader_index_; }
+  std::string_view ToStringView() const { return std::string_view(Peek(), ReadableBytes()); }
+
+  const char* FindCRLF() const {
+    const char* crlf = std::search(Peek(), BeginWrite(), kCRLF, kCRLF + 2);
+    return crlf == BeginWrite() ? nullptr : crlf;
+  }
+
+  void Retrieve(size_t len) {
+    assert(len <= ReadableBytes());
+    if (len < ReadableBytes()) {
+      reader_index_ += len;
+    } else {
+      RetrieveAll();
+    }
+  }
+
+  void RetrieveUntil(const char* end) {
+    assert(Peek() <= end && end <= BeginWrite());
+    Retrieve(end - Peek());
+  }
+
+  void RetrieveAll() {
+    reader_index_ = kCheapPrepend;
+    writer_index_ = kCheapPrepend;
+  }
+
+  std::string RetrieveAsString(size_t len) {
+    assert(len <= ReadableBytes());
+    std::string result(Peek(), len);
+    Retrieve(len);
+    return result;
+  }
+
+  std::string RetrieveAllAsString() { return RetrieveAsString(ReadableBytes()); }
+
+  // Integers are read and written in network byte order.
+  int16_t PeekInt16() const { return static_cast<int16_t>(be16toh(PeekRaw<uint16_t>())); }
+  int32_t PeekInt32() const { return static_cast<int32_t>(be32toh(PeekRaw<uint32_t>())); }
+  int64_t PeekInt64() const { return static_cast<int64_t>(be64toh(PeekRaw<uint64_t>())); }
+
+  int16_t ReadInt16() {
+    int16_t x = PeekInt16();
+    Retrieve(sizeof(x));
+    return x;
+  }
+
+  int32_t ReadInt32() {
+    int32_t x = PeekInt32();
+    Retrieve(sizeof(x));
+    return x;
+  }
+
+  int64_t ReadInt64() {
+    int64_t x = PeekInt64();
+    Retrieve(sizeof(x));
+    return x;
+  }
+
+  void AppendInt16(int16_t x) { AppendRaw(htobe16(static_cast<uint16_t>(x))); }
+  void AppendInt32(int32_t x) { AppendRaw(htobe32(static_cast<uint32_t>(x))); }
+  void AppendInt64(int64_t x) { AppendRaw(htobe64(static_cast<uint64_t>(x))); }
+
+  // kCheapPrepend leaves room for a header without moving the payload.
+  void PrependInt16(int16_t x) { PrependRaw(htobe16(static_cast<uint16_t>(x))); }
+  void PrependInt32(int32_t x) { PrependRaw(htobe32(static_cast<uint32_t>(x))); }
+  void PrependInt64(int64_t x) { PrependRaw(htobe64(static_cast<uint64_t>(x))); }
+
+  void Append(std::string_view data) { Append(data.data(), data.size()); }
+
+  void Append(const void* data, size_t len) {
+    if (len == 0) {
+      return;  // data may be null, e.g. an empty string_view
+    }
+    EnsureWritableBytes(len);
+    memcpy(BeginWrite(), data, len);
+    HasWritten(len);
+  }
+
+  void EnsureWritableBytes(size_t len) {
+    if (WritableBytes() < len) {
+      MakeSpace(len);
+    }
+    assert(WritableBytes() >= len);
+  }
+
+  char* BeginWrite() { return Begin() + writer_index_; }
+  const char* BeginWrite() const { return Begin() + writer_index_; }
+
+  void HasWritten(size_t len) {
+    assert(len <= WritableBytes());
+    writer_index_ += len;
+  }
+
+  void Prepend(const void* data, size_t len) {
+    if (len == 0) {
+      return;
+    }
+    assert(len <= PrependableBytes());
+    reader_index_ -= len;
+    memcpy(Begin() + reader_index_, data, len);
+  }
+
+  size_t InternalCapacity() const { return buffer_.capacity(); }
+
+  // Reads as much as the socket has in one readv, spilling into a stack
+  // buffer so an idle connection does not need a large buffer of its own.
+  // Returns what read(2) returns, errno is saved in *saved_errno.
+  ssize_t ReadFd(int fd, int* saved_errno);
+
+  // Bytes the next ReadFd asks for; reading fewer means the fd is drained.
+  size_t ReadFdCapacity() const {
+    return WritableBytes() < kReadFdExtraBytes ? WritableBytes() + kReadFdExtraBytes
+                                               : WritableBytes();
+  }
+
+ private:
+  char* Begin() { return buffer_.data(); }
+  const char* Begin() const { return buffer_.data(); }
+
+  // The leading bytes as they are, Peek() need not be aligned for T.
+  template<typename T>
+  T PeekRaw() const {
+    using Bytes = char[sizeof(T)];
+    assert(ReadableBytes() >= sizeof(T));
+    return bit_cast<T>(*reinterpret_cast<const Bytes*>(Peek()));
+  }
+
+  template<typename T>
+  void AppendRaw(T x) { Append(&x, sizeof(x)); }
+
+  template<typename T>
+  void PrependRaw(T x) { Prepend(&x, sizeof(x)); }
+
+  void MakeSpace(size_t len) {
+    if (WritableBytes() + PrependableBytes() < len + kCheapPrepend) {
+      buffer_.resize(writer_index_ + len);
+    } else {
+      // Move readable data to the front instead of growing.
+      size_t readable = ReadableBytes();
+      std::copy(Begin() + reader_index_, Begin() + writer_index_, Begin() + kCheapPrepend);
+      reader_index_ = kCheapPrepend;
+      writer_index_ = reader_index_ + readable;
+    }
+  }
+
+ private:
+  static const char kCRLF[];
+  static constexpr size_t kReadFdExtraBytes = 65536;
+
+  std::vector<char> buffer_;
+  size_t reader_index_;
+  size_t writer_index_;
+};
+
+}  // namespace net
+
+}  // namespace mymuduo
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <stddef.h>
+
+#include <functional>
+#include <memory>
+
+namespace mymuduo {
+
+namespace net {
+
+class Buffer;
+class TcpConnection;
+
+using TcpConnectionPtr = std::shared_ptr<TcpConnection>;
+
+using ConnectionCallback = std::function<void(const TcpConnectionPtr&)>;
+using CloseCallback = std::function<void(const TcpConnectionPtr&)>;
+using WriteCompleteCallback = std::function<void(const TcpConnectionPtr&)>;
+using HighWaterMarkCallback = std::function<void(const TcpConnectionPtr&, size_t)>;
+using LowWaterMarkCallback = std::function<void(const TcpConnectionPtr&, size_t)>;
+using MessageCallback = std::function<void(const TcpConnectionPtr&, Buffer*)>;
+
+void DefaultConnectionCallback(const TcpConnectionPtr& conn);
+void DefaultMessageCallback(const TcpConnectionPtr& conn, Buffer* buffer);
+
+}  // namespace net
+
+}  // namespace mymuduo
@@ -0,0 +1,99 @@
+#include "channel.h"
+
+#include <assert.h>
+#include <sys/epoll.h>
+
+#include "event_loop.h"
+
+namespace mymuduo {
+
+namespace net {
+
+const int Channel::kNoneEvent = 0;
+const int Channel::kReadEvent = EPOLLIN | EPOLLPRI;
+const int Channel::kWriteEvent = EPOLLOUT;
+
+Channel::Channel(EventLoop* loop, int fd)
+    : loop_(loop),
+      fd_(fd),
+      events_(0),
+      revents_(0),
+      index_(-1),
+      tied_(false),
+      event_handling_(false),
+      added_to_loop_(false),
+      read_mode_(kReadReadiness),
+      edge_triggered_(false),
+      exclusive_(false) {}
+
+Channel::~Channel() {
+  assert(!event_handling_);
+  assert(!added_to_loop_);
+}
+
+void Channel::Tie(const std::shared_ptr<void>& owner) {
+  tie_ = owner;
+  tied_ = true;
+}
+
+void Channel::Update() {
+  added_to_loop_ = true;
+  loop_->UpdateChannel(this);
+}
+
+void Channel::Remove() {
+  assert(IsNoneEvent());
+  added_to_loop_ = false;
+  loop_->RemoveChannel(this);
+}
+
+void Channel::HandleEvent() {
+  if (tied_) {
+    std::shared_ptr<void> guard = tie_.lock();
+    if (guard) {
+      HandleEventWithGuard();
+    }
+  } else {
+    HandleEventWithGuard();
+  }
+}
+
+void Channel::HandleAccept(int connfd) {
+  event_handling_ = true;
+  accept_callback_(connfd);
+  event_handling_ = false;
+}
+
+void Channel::HandleData(const char* data, ssize_t n) {
+  std::shared_ptr<void> guard;
+  if (tied_) {
+    guard = tie_.lock();
+    if (!guard) {
+      return;
+    }
+  }
+  event_handling_ = true;
+  data_callback_(data, n);
+  event_handling_ = false;
+}
+
+void Channel::HandleEventWithGuard() {
+  event_handling_ = true;
+  if ((revents_ & EPOLLHUP) && !(revents_ & EPOLLIN)) {
+    if (close_callback_) close_callback_();
+  }
+  if (revents_ & EPOLLERR) {
+    if (error_callback_) error_callback_();
+  }
+  if (revents_ & (EPOLLIN | EPOLLPRI | EPOLLRDHUP)) {
+    if (read_callback_) read_callback_();
+  }
+  if (revents_ & EPOLLOUT) {
+    if (write_callback_) write_callback_();
+  }
+  event_handling_ = false;
+}
+
+}  // namespace net
+
+}  // namespace mymuduo
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <sys/types.h>
+
+#include <functional>
+#include <memory>
+
+namespace mymuduo {
+
+namespace net {
+
+class EventLoop;
+
+// Dispatches the events of one fd to callbacks.
+// A Channel never owns its fd, and always belongs to a single EventLoop;
+// all of its member functions are called in that loop's thread.
+class Channel {
+ public:
+  using EventCallback = std::function<void()>;
+  // connfd, or -errno.
+  using AcceptCallback = std::function<void(int connfd)>;
+  // n bytes at data, 0 at EOF, or -errno.
+  using DataCallback = std::function<void(const char* data, ssize_t n)>;
+
+  // How reading is reported. By default the poller reports readability and
+  // the owner reads; in the completion modes a poller that supports them
+  // (Poller::SupportsCompletionReads) accepts or receives by itself while
+  // IsReading(), and hands over the results.
+  enum ReadMode { kReadReadiness, kReadAccept, kReadRecv };
+
+  Channel(EventLoop* loop, int fd);
+  ~Channel();
+
+  Channel(const Channel&) = delete;
+  Channel& operator=(const Channel&) = delete;
+
+  void HandleEvent();
+
+  void SetReadCallback(EventCallback cb) { read_callback_ = std::move(cb); }
+  void SetWriteCallback(EventCallback cb) { write_callback_ = std::move(cb); }
+  void SetCloseCallback(EventCallback cb) { close_callback_ = std::move(cb); }
+  void SetErrorCallback(EventCallback cb) { error_callback_ = std::move(cb); }
+  // Set before the channel is first enabled.
+  void SetAcceptCallback(AcceptCallback cb) {
+    accept_callback_ = std::move(cb);
+    read_mode_ = kReadAccept;
+  }
+  void SetDataCallback(DataCallback cb) {
+    data_callback_ = std::move(cb);
+    read_mode_ = kReadRecv;
+  }
+
+  ReadMode read_mode() const { return read_mode_; }
+
+  // Edge triggered registration (EPOLLET), set before the channel is first
+  // enabled. The owner must then read until EAGAIN, or stop early and call
+  // EventLoop::RequeueReadable to get another turn in the next iteration.
+  void SetEdgeTriggered(bool on) { edge_triggered_ = on; }
+  bool edge_triggered() const { return edge_triggered_; }
+  // EPOLLEXCLUSIVE, for a listening fd shared by several loops or
+  // processes: one of them is woken per connection, not all.
+  void SetExclusive(bool on) { exclusive_ = on; }
+  bool exclusive() const { return exclusive_; }
+  int revents() const { return revents_; }
+  // For completion reads, called by the poller. The data callback only
+  // stashes what arrived, the read callback runs later from HandleEvent.
+  void HandleAccept(int connfd);
+  void HandleData(const char* data, ssize_t n);
+
+  // Ties the channel to its owner, so the owner is kept alive while
+  // HandleEvent runs even if a callback drops the last outside reference.
+  void Tie(const std::shared_ptr<void>& owner);
+
+  int fd() const { return fd_; }
+  int events() const { return events_; }
+  void set_revents(int revents) { revents_ = revents; }
+  bool IsNoneEvent() const { return events_ == kNoneEvent; }
+
+  void EnableReading() { events_ |= kReadEvent; Update(); }
+  void DisableReading() { events_ &= ~kReadEvent; Update(); }
+  void EnableWriting() { events_ |= kWriteEvent; Update(); }
+  void DisableWriting() { events_ &= ~kWriteEvent; Update(); }
+  void DisableAll() { events_ = kNoneEvent; Update(); }
+  bool IsWriting() const { return events_ & kWriteEvent; }
+  bool IsReading() const { return events_ & kReadEvent; }
+
+  // For Poller.
+  int index() const { return index_; }
+  void set_index(int index) { index_ = index; }
+
+  EventLoop* OwnerLoop() const { return loop_; }
+  void Remove();
+
+ private:
+  void Update();
+  void HandleEventWithGuard();
+
+ private:
+  static const int kNoneEvent;
+  static const int kReadEvent;
+  static const int kWriteEvent;
+
+  EventLoop* loop_;
+  const int fd_;
+  int events_;
+  int revents_;
+  int index_;
+
+  std::weak_ptr<void> tie_;
+  bool tied_;
+  bool event_handling_;
+  bool added_to_loop_;
+  ReadMode read_mode_;
+  bool edge_triggered_;
+  bool exclusive_;
+
+  EventCallback read_callback_;
+  EventCallback write_callback_;
+  EventCallback close_callback_;
+  EventCallback error_callback_;
+  AcceptCallback accept_callback_;
+  DataCallback data_callback_;
+};
+
+}  // namespace net
+
+}  // namespace mymuduo
@@ -0,0 +1,267 @@
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "cpu_topology.h"
+#include "event_loop.h"
+#include "histogram.h"
+#include "inet_address.h"
+#include "rpc.h"
+#include "rpc_channel.h"
+#include "rpc_server.h"
+#include "tcp_client.h"
+#include "tcp_connection.h"
+#include "timer_queue.h"
+
+// A CPU-bound service next to a cheap one: "solve" counts the n-queens
+// solutions of the board size it gets (n=12 is ~7ms of CPU), "echo"
+// answers at once. The server runs once with the methods on its I/O loop
+// and once with a compute pool; the client sends open loop at a fixed rate,
+// one call in solve_every a solve, and reports latencies from the intended
+// send time per method. Inline, an echo queued behind a solve waits for
+// it; with the pool the loop keeps answering echoes while solvers run.
+// The pinned run puts the loop on a physical core of its own and the
+// solvers one per remaining core (CpuTopology::kPhysicalCore), so no
+// solver shares a hyperthread with the loop.
+// usage: compute_benchmark [rate] [connections] [seconds] [solve_every] [compute_threads]
+
+using mymuduo::CpuTopology;
+using mymuduo::Histogram;
+using mymuduo::net::EventLoop;
+using mymuduo::net::InetAddress;
+using mymuduo::net::RpcChannel;
+using mymuduo::net::RpcServer;
+using mymuduo::net::RpcStatus;
+using mymuduo::net::TcpClient;
+using mymuduo::net::TcpConnectionPtr;
+using mymuduo::net::TimerQueue;
+
+namespace {
+
+double g_rate = 1000;
+int g_connections = 20;
+double g_seconds = 5;
+int g_solve_every = 50;
+int g_compute_threads = 4;
+const char* kBoardSize = "12";
+const int64_t kHighestTrackableUs = 3600LL * 1000 * 1000;
+
+int Queens(int n, int row, unsigned cols, unsigned diag1, unsigned diag2) {
+  if (row == n) {
+    return 1;
+  }
+  int count = 0;
+  unsigned avail = ~(cols | diag1 | diag2) & ((1u << n) - 1);
+  while (avail) {
+    const unsigned bit = avail & -avail;
+    avail ^= bit;
+    count += Queens(n, row + 1, cols | bit, (diag1 | bit) << 1, (diag2 | bit) >> 1);
+  }
+  return count;
+}
+
+// Runs in the forked child, never returns.
+void RunServer(int compute_threads, bool pinned, int port_fd) {
+  EventLoop loop;
+  RpcServer server(&loop, InetAddress(0, true), "compute_benchmark");
+  server.RegisterMethod("echo", [](std::string_view request, const RpcServer::Done& done) {
+    done(request);
+  });
+  server.RegisterMethod("solve", [](std::string_view request, const RpcServer::Done& done) {
+    const int n = atoi(std::string(request).c_str());
+    done(std::to_string(Queens(n, 0, 0, 0, 0)));
+  });
+  server.SetComputeThreadNum(compute_threads);
+  if (pinned) {
+    const CpuTopology& topology = CpuTopology::Get();
+    const int io_cpu = topology.Place(CpuTopology::kPhysicalCore, 1).front();
+    mymuduo::PinCurrentThread(io_cpu);
+    server.SetComputeThreadCpus(
+        topology.Place(CpuTopology::kPhysicalCore, compute_threads, {io_cpu}));
+  }
+  server.Start();
+  const uint16_t port = server.listen_address().Port();
+  ::write(port_fd, &port, sizeof(port));
+  ::close(port_fd);
+  loop.Loop();
+  _exit(0);
+}
+
+pid_t StartServer(int compute_threads, bool pinned, uint16_t* port) {
+  int port_fds[2];
+  if (::pipe(port_fds) < 0) {
+    perror("pipe");
+    exit(1);
+  }
+  pid_t pid = ::fork();
+  if (pid == 0) {
+    ::close(port_fds[0]);
+    RunServer(compute_threads, pinned, port_fds[1]);
+  }
+  ::close(port_fds[1]);
+  if (::read(port_fds[0], port, sizeof(*port)) != sizeof(*port)) {
+    fprintf(stderr, "server did not start\n");
+    exit(1);
+  }
+  ::close(port_fds[0]);
+  return pid;
+}
+
+// Open loop: call i is due at start + i / rate on connection
+// i % connections, whatever the server does.
+class Driver {
+ public:
+  Driver(EventLoop* loop, const InetAddress& server_addr)
+      : loop_(loop),
+        echo_us_(kHighestTrackableUs),
+        solve_us_(kHighestTrackableUs),
+        total_calls_(static_cast<int64_t>(g_rate * g_seconds)) {
+    for (int i = 0; i < g_connections; ++i) {
+      clients_.emplace_back(new TcpClient(loop, server_addr, "compute#" + std::to_string(i)));
+    }
+    channels_.resize(g_connections);
+  }
+
+  // The clients report their disconnect while they go.
+  ~Driver() {
+    stopping_ = true;
+    clients_.clear();
+  }
+
+  void Start() {
+    for (int i = 0; i < g_connections; ++i) {
+      clients_[i]->SetConnectionCallback([this, i](const TcpConnectionPtr& conn) {
+        if (stopping_) {
+          return;
+        }
+        if (conn->Connected()) {
+          channels_[i].reset(new RpcChannel(conn));
+          if (++connected_ == g_connections) {
+            start_ = TimerQueue::Now();
+            SendDue();
+          }
+        } else {
+          channels_[i]->HandleDisconnected();
+        }
+      });
+      clients_[i]->SetConnectFailedCallback([this](int) { loop_->Quit(); });
+      clients_[i]->Connect();
+    }
+  }
+
+  void Report(const char* mode) const {
+    printf("%-10s %8lld %8lld %8lld %8lld %8lld   %8lld %8lld %8lld\n", mode,
+           static_cast<long long>(echo_us_.ValueAtPercentile(50)),
+           static_cast<long long>(echo_us_.ValueAtPercentile(90)),
+           static_cast<long long>(echo_us_.ValueAtPercentile(99)),
+           static_cast<long long>(echo_us_.ValueAtPercentile(99.9)),
+           static_cast<long long>(echo_us_.Max()),
+           static_cast<long long>(solve_us_.ValueAtPercentile(50)),
+           static_cast<long long>(solve_us_.ValueAtPercentile(99)),
+           static_cast<long long>(solve_us_.Max()));
+    if (errors_ > 0) {
+      printf("  %lld calls failed\n", static_cast<long long>(errors_));
+    }
+  }
+
+ private:
+  int64_t IntendedTime(int64_t i) const {
+    return start_ + static_cast<int64_t>(static_cast<double>(i) * 1e6 / g_rate);
+  }
+
+  void SendDue() {
+    const int64_t now = TimerQueue::Now();
+    while (next_call_ < total_calls_ && IntendedTime(next_call_) <= now) {
+      const int64_t intended = IntendedTime(next_call_);
+      const bool solve = next_call_ % g_solve_every == 0;
+      RpcChannel* channel = channels_[next_call_ % g_connections].get();
+      ++next_call_;
+      Histogram* histogram = solve ? &solve_us_ : &echo_us_;
+      channel->Call(solve ? "solve" : "echo", solve ? kBoardSize : "ping",
+                    [this, intended, histogram](RpcStatus status, std::string_view) {
+                      if (status == mymuduo::net::kRpcOk) {
+                        histogram->Record(TimerQueue::Now() - intended);
+                      } else {
+                        ++errors_;
+                      }
+                      if (++completed_ == total_calls_) {
+                        loop_->QueueInLoop([this]() { loop_->Quit(); });
+                      }
+                    });
+    }
+    if (next_call_ < total_calls_) {
+      loop_->RunAt(IntendedTime(next_call_), [this]() { SendDue(); });
+    }
+  }
+
+ private:
+  EventLoop* loop_;
+  Histogram echo_us_;
+  Histogram solve_us_;
+  const int64_t total_calls_;
+  int64_t next_call_{0};
+  int64_t completed_{0};
+  int64_t errors_{0};
+  int connected_{0};
+  int64_t start_{0};
+  bool stopping_{false};
+  // Declared before the clients: a disconnect still reaches its channel.
+  std::vector<std::unique_ptr<RpcChannel>> channels_;
+  std::vector<std::unique_ptr<TcpClient>> clients_;
+};
+
+void RunMode(const char* mode, int compute_threads, bool pinned) {
+  uint16_t port = 0;
+  pid_t pid = StartServer(compute_threads, pinned, &port);
+  {
+    EventLoop loop;
+    Driver driver(&loop, InetAddress("127.0.0.1", port));
+    driver.Start();
+    loop.Loop();
+    driver.Report(mode);
+  }
+  ::kill(pid, SIGTERM);
+  ::waitpid(pid, nullptr, 0);
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  if (argc > 1) {
+    g_rate = atof(argv[1]);
+  }
+  if (argc > 2) {
+    g_connections = atoi(argv[2]);
+  }
+  if (argc > 3) {
+    g_seconds = atof(argv[3]);
+  }
+  if (argc > 4) {
+    g_solve_every = atoi(argv[4]);
+  }
+  if (argc > 5) {
+    g_compute_threads = atoi(argv[5]);
+  }
+  if (g_rate <= 0 || g_connections <= 0 || g_solve_every <= 0) {
+    fprintf(stderr, "usage: %s [rate] [connections] [seconds] [solve_every] [compute_threads]\n",
+            argv[0]);
+    return 1;
+  }
+
+  printf("compute_benchmark: %.0f calls/s, %d connections, %.1f s, 1 in %d a solve(%s), "
+         "%d compute threads\n",
+         g_rate, g_connections, g_seconds, g_solve_every, kBoardSize, g_compute_threads);
+  printf("%-10s %8s %8s %8s %8s %8s   %8s %8s %8s\n", "latency us", "echo p50", "p90", "p99",
+         "p99.9", "max", "solve p50", "p99", "max");
+  RunMode("inline", 0, false);
+  RunMode("pool", g_compute_threads, false);
+  RunMode("pinned", g_compute_threads, true);
+  return 0;
+}
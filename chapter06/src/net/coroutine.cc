@@ -0,0 +1,218 @@
+#include "coroutine.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <unistd.h>
+
+#include "channel.h"
+#include "event_loop.h"
+#include "sockets_ops.h"
+
+namespace mymuduo {
+
+namespace net {
+
+namespace {
+
+const size_t kSizeClass = 64;
+const size_t kClassNum = FramePool::kMaxPooledFrame / kSizeClass;
+
+struct FreeFrame {
+  FreeFrame* next;
+};
+
+struct ThreadFrames {
+  ~ThreadFrames() {
+    for (FreeFrame*& head : heads) {
+      while (head) {
+        FreeFrame* frame = head;
+        head = head->next;
+        ::operator delete(frame);
+      }
+    }
+  }
+
+  FreeFrame* heads[kClassNum] = {};
+};
+
+thread_local ThreadFrames t_frames;
+
+}  // namespace
+
+void* FramePool::Allocate(size_t size) {
+  if (size > kMaxPooledFrame) {
+    return ::operator new(size);
+  }
+  const size_t size_class = (size - 1) / kSizeClass;
+  FreeFrame*& head = t_frames.heads[size_class];
+  if (head) {
+    FreeFrame* frame = head;
+    head = frame->next;
+    return frame;
+  }
+  return ::operator new((size_class + 1) * kSizeClass);
+}
+
+void FramePool::Deallocate(void* frame, size_t size) {
+  if (size > kMaxPooledFrame) {
+    ::operator delete(frame);
+    return;
+  }
+  FreeFrame*& head = t_frames.heads[(size - 1) / kSizeClass];
+  FreeFrame* free_frame = static_cast<FreeFrame*>(frame);
+  free_frame->next = head;
+  head = free_frame;
+}
+
+void Spawn(Task<void> task) {
+  std::coroutine_handle<Task<void>::promise_type> handle = std::exchange(task.handle_, nullptr);
+  handle.promise().detached = true;
+  handle.resume();
+}
+
+bool AsyncSocket::IoAwaiter::TryIo() {
+  const int fd = socket_->fd_;
+  ssize_t n = 0;
+  switch (op_) {
+    case kRead:
+      do {
+        n = ::read(fd, data_, len_);
+      } while (n < 0 && errno == EINTR);
+      break;
+    case kAccept: {
+      struct sockaddr_in addr;
+      n = sockets::Accept(fd, &addr);
+      if (n < 0 && errno == EINTR) {
+        return false;  // the listener stays readable
+      }
+      break;
+    }
+    case kWrite:
+      while (done_ < len_) {
+        n = ::write(fd, data_ + done_, len_ - done_);
+        if (n < 0) {
+          if (errno == EINTR) {
+            continue;
+          }
+          break;
+        }
+        done_ += n;
+        n = static_cast<ssize_t>(done_);
+      }
+      break;
+  }
+  if (n < 0) {
+    if (errno == EAGAIN) {
+      return false;
+    }
+    n = -errno;
+  }
+  result_ = n;
+  return true;
+}
+
+bool AsyncSocket::IoAwaiter::await_ready() {
+  return TryIo();
+}
+
+void AsyncSocket::IoAwaiter::await_suspend(std::coroutine_handle<> handle) {
+  handle_ = handle;
+  Channel* channel = socket_->channel_.get();
+  if (op_ == kWrite) {
+    assert(!socket_->writer_);
+    socket_->writer_ = this;
+    if (!channel->IsWriting()) {
+      channel->EnableWriting();
+    }
+  } else {
+    assert(!socket_->reader_);
+    socket_->reader_ = this;
+    if (!channel->IsReading()) {
+      channel->EnableReading();
+    }
+  }
+  socket_->registered_ = true;
+}
+
+AsyncSocket::AsyncSocket(EventLoop* loop, int fd)
+    : loop_(loop),
+      fd_(fd),
+      channel_(new Channel(loop, fd)) {
+  ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL) | O_NONBLOCK);
+  channel_->SetReadCallback([this]() { HandleRead(); });
+  channel_->SetWriteCallback([this]() { HandleWrite(); });
+  channel_->SetCloseCallback([this]() { HandleClose(); });
+  channel_->SetErrorCallback([this]() { HandleClose(); });
+}
+
+AsyncSocket::~AsyncSocket() {
+  assert(!reader_ && !writer_);
+  loop_->AssertInLoopThread();
+  if (registered_) {
+    if (!channel_->IsNoneEvent()) {
+      channel_->DisableAll();
+    }
+    channel_->Remove();
+  }
+  sockets::Close(fd_);
+  if (loop_->event_handling()) {
+    // Inside this channel's HandleEvent, resumed from one of its callbacks,
+    // or another's with this one still due in the same poll: nothing more
+    // is dispatched to us, and the channel goes after the events.
+    channel_->set_revents(0);
+    Channel* channel = channel_.release();
+    loop_->QueueInLoop([channel]() { delete channel; });
+  }
+}
+
+void AsyncSocket::HandleRead() {
+  if (!reader_) {
+    channel_->DisableReading();
+    return;
+  }
+  if (!reader_->TryIo()) {
+    return;
+  }
+  IoAwaiter* reader = std::exchange(reader_, nullptr);
+  reader->handle_.resume();
+}
+
+void AsyncSocket::HandleWrite() {
+  if (!writer_) {
+    channel_->DisableWriting();
+    return;
+  }
+  if (!writer_->TryIo()) {
+    return;
+  }
+  IoAwaiter* writer = std::exchange(writer_, nullptr);
+  writer->handle_.resume();
+}
+
+void AsyncSocket::HandleClose() {
+  if (!reader_ && !writer_) {
+    channel_->DisableAll();
+    return;
+  }
+  // Both tried before either resumes: the first may destroy the socket.
+  IoAwaiter* reader = reader_ && reader_->TryIo() ? std::exchange(reader_, nullptr) : nullptr;
+  IoAwaiter* writer = writer_ && writer_->TryIo() ? std::exchange(writer_, nullptr) : nullptr;
+  if (reader) {
+    reader->handle_.resume();
+  }
+  if (writer) {
+    writer->handle_.resume();
+  }
+}
+
+void SleepAwaiter::await_suspend(std::coroutine_handle<> handle) {
+  EventLoop* loop = EventLoop::GetEventLoopOfCurrentThread();
+  assert(loop);
+  loop->RunAfter(seconds_, [handle]() { handle.resume(); });
+}
+
+}  // namespace net
+
+}  // namespace mymuduo
@@ -0,0 +1,210 @@
+#pragma once
+
+#include <stddef.h>
+#include <sys/types.h>
+
+#include <coroutine>
+#include <exception>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+namespace mymuduo {
+
+namespace net {
+
+class Channel;
+class EventLoop;
+
+// Coroutine frames come from a free list per thread and size class, a
+// frame freed in another thread goes to that thread's list. Frames
+// larger than kMaxPooledFrame go to operator new.
+class FramePool {
+ public:
+  static const size_t kMaxPooledFrame = 1024;
+
+  static void* Allocate(size_t size);
+  static void Deallocate(void* frame, size_t size);
+};
+
+namespace internal {
+
+struct PromiseBase {
+  // Resumes the awaiting coroutine, or frees a detached one.
+  struct FinalAwaiter {
+    bool await_ready() noexcept { return false; }
+    template <typename Promise>
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept {
+      PromiseBase& promise = handle.promise();
+      if (promise.detached) {
+        handle.destroy();
+        return std::noop_coroutine();
+      }
+      return promise.continuation ? promise.continuation : std::noop_coroutine();
+    }
+    void await_resume() noexcept {}
+  };
+
+  static void* operator new(size_t size) { return FramePool::Allocate(size); }
+  static void operator delete(void* frame, size_t size) { FramePool::Deallocate(frame, size); }
+
+  std::suspend_always initial_suspend() noexcept { return {}; }
+  FinalAwaiter final_suspend() noexcept { return {}; }
+  void unhandled_exception() { std::terminate(); }
+
+  std::coroutine_handle<> continuation;
+  bool detached{false};
+};
+
+template <typename T>
+struct Promise : PromiseBase {
+  void return_value(T v) { value = std::move(v); }
+  T value{};
+};
+
+template <>
+struct Promise<void> : PromiseBase {
+  void return_void() {}
+};
+
+}  // namespace internal
+
+// A lazy coroutine: it starts when awaited, and the awaiting coroutine
+// resumes straight from its end (symmetric transfer, no queue between
+// them). Spawn() starts one with nobody awaiting it.
+template <typename T = void>
+class Task {
+ public:
+  struct promise_type : internal::Promise<T> {
+    Task get_return_object() {
+      return Task(std::coroutine_handle<promise_type>::from_promise(*this));
+    }
+  };
+
+  Task(Task&& other) noexcept : handle_(std::exchange(other.handle_, nullptr)) {}
+  Task& operator=(Task&& other) noexcept {
+    std::swap(handle_, other.handle_);
+    return *this;
+  }
+  ~Task() {
+    if (handle_) {
+      handle_.destroy();
+    }
+  }
+
+  bool await_ready() const noexcept { return false; }
+  std::coroutine_handle<> await_suspend(std::coroutine_handle<> caller) noexcept {
+    handle_.promise().continuation = caller;
+    return handle_;
+  }
+  T await_resume() {
+    if constexpr (!std::is_void_v<T>) {
+      return std::move(handle_.promise().value);
+    }
+  }
+
+ private:
+  explicit Task(std::coroutine_handle<promise_type> handle) : handle_(handle) {}
+  friend void Spawn(Task<void> task);
+
+  std::coroutine_handle<promise_type> handle_;
+};
+
+// Runs task in the caller until its first suspension; its frame is freed
+// when it returns.
+void Spawn(Task<void> task);
+
+// A non-blocking socket for coroutines, owning its fd. The awaitables try
+// the syscall first and suspend only on EAGAIN; the Channel callback then
+// does the I/O and resumes the waiter inline, in the loop thread. At most
+// one reader and one writer wait at a time.
+//
+// Interest is armed when a waiter first suspends and left armed while
+// waiters keep coming, so a read/write loop costs no epoll_ctl; an event
+// finding nobody waiting disarms it. Level triggered, the same under
+// epoll and io_uring.
+//
+// Results are like the syscalls': bytes, 0 at EOF, or -errno.
+class AsyncSocket {
+ public:
+  // Sets fd non-blocking. Use in the loop thread only.
+  AsyncSocket(EventLoop* loop, int fd);
+  // With nobody waiting. May be destroyed by a coroutine it resumed.
+  ~AsyncSocket();
+
+  AsyncSocket(const AsyncSocket&) = delete;
+  AsyncSocket& operator=(const AsyncSocket&) = delete;
+
+  int fd() const { return fd_; }
+  EventLoop* loop() const { return loop_; }
+
+  class IoAwaiter {
+   public:
+    bool await_ready();
+    void await_suspend(std::coroutine_handle<> handle);
+    ssize_t await_resume() const { return result_; }
+
+   private:
+    friend class AsyncSocket;
+    enum Op { kRead, kWrite, kAccept };
+
+    IoAwaiter(AsyncSocket* socket, Op op, char* data, size_t len)
+        : socket_(socket), op_(op), data_(data), len_(len) {}
+    // False on EAGAIN.
+    bool TryIo();
+
+    AsyncSocket* socket_;
+    Op op_;
+    char* data_;
+    size_t len_;
+    size_t done_{0};
+    ssize_t result_{0};
+    std::coroutine_handle<> handle_;
+  };
+
+  // Up to len bytes, whatever is there first.
+  IoAwaiter AsyncRead(void* buf, size_t len) {
+    return IoAwaiter(this, IoAwaiter::kRead, static_cast<char*>(buf), len);
+  }
+  // All len bytes, or -errno; buf must stay valid until it resumes.
+  IoAwaiter AsyncWrite(const void* buf, size_t len) {
+    return IoAwaiter(this, IoAwaiter::kWrite, static_cast<char*>(const_cast<void*>(buf)), len);
+  }
+  // A listening socket: the connection's fd, non-blocking, or -errno.
+  IoAwaiter AsyncAccept() { return IoAwaiter(this, IoAwaiter::kAccept, nullptr, 0); }
+
+ private:
+  void HandleRead();
+  void HandleWrite();
+  // Hangup or error: the waiters retry and see it.
+  void HandleClose();
+
+ private:
+  EventLoop* loop_;
+  const int fd_;
+  std::unique_ptr<Channel> channel_;
+  IoAwaiter* reader_{nullptr};  // read or accept
+  IoAwaiter* writer_{nullptr};
+  bool registered_{false};  // the channel has been enabled once
+};
+
+// Resumes the coroutine from a timer of the loop of this thread.
+class SleepAwaiter {
+ public:
+  explicit SleepAwaiter(double seconds) : seconds_(seconds) {}
+
+  bool await_ready() const { return seconds_ <= 0; }
+  void await_suspend(std::coroutine_handle<> handle);
+  void await_resume() const {}
+
+ private:
+  double seconds_;
+};
+
+inline SleepAwaiter Sleep(double seconds) {
+  return SleepAwaiter(seconds);
+}
+
+}  // namespace net
+
+}  // namespace mymuduo
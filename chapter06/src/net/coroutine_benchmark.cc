@@ -0,0 +1,233 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <new>
+#include <string>
+#include <vector>
+
+#include "buffer.h"
+#include "coroutine.h"
+#include "event_loop.h"
+#include "inet_address.h"
+#include "sockets_ops.h"
+#include "tcp_connection.h"
+#include "tcp_server.h"
+
+// Loopback echo served twice on the same poller: by TcpServer and its
+// callbacks, and by coroutines on AsyncSocket, one per connection, each
+// request a nested Task that reads and writes back. A forked client keeps
+// every connection busy with one message in flight. The server reports
+// requests/sec, its CPU time and its heap allocations per request.
+// MYMUDUO_USE_IO_URING=1 picks the io_uring poller for both.
+// usage: coroutine_benchmark [connections] [seconds] [message_bytes]
+
+using mymuduo::net::AsyncSocket;
+using mymuduo::net::Buffer;
+using mymuduo::net::EventLoop;
+using mymuduo::net::InetAddress;
+using mymuduo::net::Task;
+using mymuduo::net::TcpConnectionPtr;
+using mymuduo::net::TcpServer;
+namespace sockets = mymuduo::net::sockets;
+
+namespace {
+
+int g_connections = 200;
+int g_seconds = 3;
+size_t g_message_bytes = 64;
+int64_t g_allocations = 0;
+
+double NowSeconds() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<double>(ts.tv_sec) + static_cast<double>(ts.tv_nsec) / 1e9;
+}
+
+double CpuSeconds() {
+  struct rusage usage;
+  ::getrusage(RUSAGE_SELF, &usage);
+  return static_cast<double>(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) +
+         static_cast<double>(usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+}
+
+// Runs in the forked child, never returns.
+void RunClient(const InetAddress& server_addr) {
+  std::vector<int> sockfds;
+  for (int i = 0; i < g_connections; ++i) {
+    int sockfd = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (::connect(sockfd, server_addr.GetSockAddr(), sizeof(struct sockaddr_in)) < 0) {
+      perror("connect");
+      _exit(1);
+    }
+    sockfds.push_back(sockfd);
+  }
+  std::string message(g_message_bytes, 'm');
+  std::vector<char> buf(g_message_bytes);
+  double deadline = NowSeconds() + g_seconds;
+  while (NowSeconds() < deadline) {
+    for (int sockfd : sockfds) {
+      ::write(sockfd, message.data(), message.size());
+    }
+    for (int sockfd : sockfds) {
+      size_t received = 0;
+      while (received < g_message_bytes) {
+        ssize_t n = ::read(sockfd, buf.data() + received, g_message_bytes - received);
+        if (n <= 0) {
+          _exit(1);
+        }
+        received += n;
+      }
+    }
+  }
+  for (int sockfd : sockfds) {
+    ::close(sockfd);
+  }
+  _exit(0);
+}
+
+// What the server did between the last connect and the last close.
+struct Stats {
+  void Connected() {
+    if (++connected == g_connections) {
+      start = NowSeconds();
+      start_cpu = CpuSeconds();
+      start_allocations = g_allocations;
+    }
+  }
+  // True for the last one.
+  bool Disconnected() {
+    if (--connected > 0) {
+      return false;
+    }
+    seconds = NowSeconds() - start;
+    cpu = CpuSeconds() - start_cpu;
+    allocations = g_allocations - start_allocations;
+    return true;
+  }
+
+  int connected{0};
+  int64_t bytes{0};
+  double start{0};
+  double start_cpu{0};
+  int64_t start_allocations{0};
+  double seconds{0};
+  double cpu{0};
+  int64_t allocations{0};
+};
+
+void ServeCallbacks(EventLoop* loop, int listen_fd, Stats* stats) {
+  TcpServer server(loop, listen_fd, "echo");
+  server.SetConnectionCallback([loop, stats](const TcpConnectionPtr& conn) {
+    if (conn->Connected()) {
+      stats->Connected();
+    } else if (stats->Disconnected()) {
+      loop->Quit();
+    }
+  });
+  server.SetMessageCallback([stats](const TcpConnectionPtr& conn, Buffer* buffer) {
+    stats->bytes += buffer->ReadableBytes();
+    conn->Send(buffer);
+  });
+  server.Start();
+  loop->Loop();
+}
+
+// One request: whatever arrived, written back. 0 at EOF.
+Task<ssize_t> EchoOnce(AsyncSocket* socket, char* buf, size_t len) {
+  ssize_t n = co_await socket->AsyncRead(buf, len);
+  if (n > 0) {
+    ssize_t written = co_await socket->AsyncWrite(buf, n);
+    if (written < 0) {
+      co_return written;
+    }
+  }
+  co_return n;
+}
+
+Task<> EchoSession(EventLoop* loop, int connfd, Stats* stats) {
+  AsyncSocket socket(loop, connfd);
+  std::vector<char> buf(64 * 1024);
+  stats->Connected();
+  for (;;) {
+    ssize_t n = co_await EchoOnce(&socket, buf.data(), buf.size());
+    if (n <= 0) {
+      break;
+    }
+    stats->bytes += n;
+  }
+  if (stats->Disconnected()) {
+    loop->Quit();
+  }
+}
+
+Task<> AcceptConnections(AsyncSocket* listener, Stats* stats) {
+  for (int accepted = 0; accepted < g_connections;) {
+    int connfd = static_cast<int>(co_await listener->AsyncAccept());
+    if (connfd < 0) {
+      continue;
+    }
+    ++accepted;
+    mymuduo::net::Spawn(EchoSession(listener->loop(), connfd, stats));
+  }
+}
+
+void ServeCoroutines(EventLoop* loop, int listen_fd, Stats* stats) {
+  AsyncSocket listener(loop, listen_fd);
+  mymuduo::net::Spawn(AcceptConnections(&listener, stats));
+  loop->Loop();
+}
+
+void Run(const char* name, void (*serve)(EventLoop*, int, Stats*)) {
+  EventLoop loop;
+  int listen_fd = sockets::CreateNonblockingOrDie();
+  sockets::BindOrDie(listen_fd, InetAddress(0, true).GetSockAddr());
+  sockets::ListenOrDie(listen_fd);
+  pid_t pid = ::fork();
+  if (pid == 0) {
+    RunClient(InetAddress(sockets::GetLocalAddr(listen_fd)));
+  }
+  Stats stats;
+  serve(&loop, listen_fd, &stats);  // both close listen_fd
+  ::waitpid(pid, nullptr, 0);
+
+  double requests = static_cast<double>(stats.bytes) / static_cast<double>(g_message_bytes);
+  printf("%-26s %-10s %6d %12.0f %10.2f %10.2f\n", loop.PollerName(), name, g_connections,
+         requests / stats.seconds, stats.cpu * 1e6 / requests,
+         static_cast<double>(stats.allocations) / requests);
+}
+
+}  // namespace
+
+void* operator new(size_t size) {
+  ++g_allocations;
+  void* p = malloc(size);
+  if (!p) {
+    throw std::bad_alloc();
+  }
+  return p;
+}
+
+void operator delete(void* p) noexcept {
+  free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+  free(p);
+}
+
+int main(int argc, char* argv[]) {
+  if (argc > 1) g_connections = atoi(argv[1]);
+  if (argc > 2) g_seconds = atoi(argv[2]);
+  if (argc > 3) g_message_bytes = atoi(argv[3]);
+
+  printf("%-26s %-10s %6s %12s %10s %10s\n", "poller", "server", "conns", "requests/s",
+         "cpu us/req", "allocs/req");
+  Run("callback", ServeCallbacks);
+  Run("coroutine", ServeCoroutines);
+  return 0;
+}
@@ -0,0 +1,168 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+#include "buffer.h"
+#include "event_loop.h"
+#include "inet_address.h"
+#include "tcp_connection.h"
+#include "tcp_server.h"
+
+// Loopback echo with many connections, once over epoll and once over
+// io_uring. A forked client keeps every connection busy with one message
+// in flight; the server reports requests/sec and its own syscalls per
+// request: read/write calls from /proc/self/io plus the poller's.
+// usage: echo_benchmark [connections] [seconds] [message_bytes]
+
+using mymuduo::net::Buffer;
+using mymuduo::net::EventLoop;
+using mymuduo::net::InetAddress;
+using mymuduo::net::TcpConnectionPtr;
+using mymuduo::net::TcpServer;
+
+namespace {
+
+int g_connections = 200;
+int g_seconds = 3;
+size_t g_message_bytes = 64;
+
+double NowSeconds() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<double>(ts.tv_sec) + static_cast<double>(ts.tv_nsec) / 1e9;
+}
+
+// syscr + syscw of this process.
+int64_t ReadWriteSyscalls() {
+  FILE* fp = fopen("/proc/self/io", "r");
+  if (!fp) {
+    return 0;
+  }
+  char name[64];
+  long long value = 0;
+  int64_t total = 0;
+  while (fscanf(fp, "%63[^:]: %lld\n", name, &value) == 2) {
+    if (strcmp(name, "syscr") == 0 || strcmp(name, "syscw") == 0) {
+      total += value;
+    }
+  }
+  fclose(fp);
+  return total;
+}
+
+// Runs in the forked child, never returns.
+void RunClient(const InetAddress& server_addr) {
+  std::vector<int> sockfds;
+  for (int i = 0; i < g_connections; ++i) {
+    int sockfd = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (::connect(sockfd, server_addr.GetSockAddr(), sizeof(struct sockaddr_in)) < 0) {
+      perror("connect");
+      _exit(1);
+    }
+    sockfds.push_back(sockfd);
+  }
+  std::string message(g_message_bytes, 'm');
+  std::vector<char> buf(g_message_bytes);
+  double deadline = NowSeconds() + g_seconds;
+  while (NowSeconds() < deadline) {
+    for (int sockfd : sockfds) {
+      ::write(sockfd, message.data(), message.size());
+    }
+    for (int sockfd : sockfds) {
+      size_t received = 0;
+      while (received < g_message_bytes) {
+        ssize_t n = ::read(sockfd, buf.data() + received, g_message_bytes - received);
+        if (n <= 0) {
+          _exit(1);
+        }
+        received += n;
+      }
+    }
+  }
+  for (int sockfd : sockfds) {
+    ::close(sockfd);
+  }
+  _exit(0);
+}
+
+enum Mode { kLevelTriggered, kEdgeTriggered, kIoUring };
+
+void RunServer(Mode mode) {
+  if (mode == kIoUring) {
+    ::setenv("MYMUDUO_USE_IO_URING", "1", 1);
+  } else {
+    ::unsetenv("MYMUDUO_USE_IO_URING");
+  }
+
+  EventLoop loop;
+  TcpServer server(&loop, InetAddress(0, true), "echo");
+  if (mode == kEdgeTriggered) {
+    server.SetEdgeTriggered();
+  }
+  int connected = 0;
+  int64_t bytes = 0;
+  double start = 0;
+  int64_t start_syscalls = 0;
+  int64_t start_poller_syscalls = 0;
+  int64_t start_iterations = 0;
+  server.SetConnectionCallback([&](const TcpConnectionPtr& conn) {
+    if (conn->Connected()) {
+      if (++connected == g_connections) {
+        start = NowSeconds();
+        start_syscalls = ReadWriteSyscalls();
+        start_poller_syscalls = loop.PollerSyscalls();
+        start_iterations = loop.iteration();
+      }
+    } else if (--connected == 0) {
+      loop.Quit();
+    }
+  });
+  server.SetMessageCallback([&bytes](const TcpConnectionPtr& conn, Buffer* buffer) {
+    bytes += buffer->ReadableBytes();
+    conn->Send(buffer);
+  });
+  server.Start();
+
+  pid_t pid = ::fork();
+  if (pid == 0) {
+    RunClient(server.listen_address());
+  }
+  loop.Loop();
+  double seconds = NowSeconds() - start;
+  int64_t syscalls = ReadWriteSyscalls() - start_syscalls;
+  int64_t poller_syscalls = loop.PollerSyscalls() - start_poller_syscalls;
+  int64_t iterations = loop.iteration() - start_iterations;
+  int status = 0;
+  ::waitpid(pid, &status, 0);
+
+  double requests = static_cast<double>(bytes) / static_cast<double>(g_message_bytes);
+  std::string name = loop.PollerName();
+  if (mode == kEdgeTriggered) {
+    name += "/et";
+  }
+  printf("%-26s %6d %12.0f %10.3f %10.3f %10.3f %12.1f\n", name.c_str(), g_connections,
+         requests / seconds, (syscalls + poller_syscalls) / requests, syscalls / requests,
+         poller_syscalls / requests, requests / static_cast<double>(iterations));
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  if (argc > 1) g_connections = atoi(argv[1]);
+  if (argc > 2) g_seconds = atoi(argv[2]);
+  if (argc > 3) g_message_bytes = atoi(argv[3]);
+
+  printf("%-26s %6s %12s %10s %10s %10s %12s\n", "poller", "conns", "requests/s",
+         "sys/req", "rw/req", "poll/req", "req/iter");
+  RunServer(kLevelTriggered);
+  RunServer(kEdgeTriggered);
+  RunServer(kIoUring);
+  return 0;
+}
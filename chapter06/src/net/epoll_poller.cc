@@ -0,0 +1,130 @@
+#include "epoll_poller.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <unistd.h>
+
+#include "channel.h"
+
+namespace mymuduo {
+
+namespace net {
+
+namespace {
+
+// Channel::index() of a channel, as seen by EPollPoller.
+const int kNew = -1;
+const int kAdded = 1;
+const int kDeleted = 2;
+
+}  // namespace
+
+EPollPoller::EPollPoller(EventLoop* loop)
+    : Poller(loop),
+      epollfd_(::epoll_create1(EPOLL_CLOEXEC)),
+      events_(kInitEventListSize) {
+  if (epollfd_ < 0) {
+    fprintf(stderr, "EPollPoller: epoll_create1: %s\n", strerror(errno));
+    abort();
+  }
+}
+
+EPollPoller::~EPollPoller() {
+  ::close(epollfd_);
+}
+
+void EPollPoller::Poll(int timeout_ms, ChannelList* active_channels) {
+  ++num_syscalls_;
+  int num_events = ::epoll_wait(epollfd_, events_.data(), static_cast<int>(events_.size()),
+                                timeout_ms);
+  if (num_events > 0) {
+    FillActiveChannels(num_events, active_channels);
+    if (static_cast<size_t>(num_events) == events_.size()) {
+      events_.resize(events_.size() * 2);
+    }
+  } else if (num_events < 0 && errno != EINTR) {
+    fprintf(stderr, "EPollPoller::Poll: %s\n", strerror(errno));
+  }
+}
+
+void EPollPoller::FillActiveChannels(int num_events, ChannelList* active_channels) const {
+  for (int i = 0; i < num_events; ++i) {
+    Channel* channel = static_cast<Channel*>(events_[i].data.ptr);
+    channel->set_revents(events_[i].events);
+    active_channels->push_back(channel);
+  }
+}
+
+void EPollPoller::UpdateChannel(Channel* channel) {
+  const int index = channel->index();
+  const int fd = channel->fd();
+  if (index == kNew || index == kDeleted) {
+    if (index == kNew) {
+      assert(channels_.find(fd) == channels_.end());
+      channels_[fd] = channel;
+    } else {
+      assert(channels_.find(fd) != channels_.end());
+    }
+    channel->set_index(kAdded);
+    Update(EPOLL_CTL_ADD, channel);
+  } else {
+    assert(HasChannel(channel));
+    if (channel->IsNoneEvent()) {
+      Update(EPOLL_CTL_DEL, channel);
+      channel->set_index(kDeleted);
+    } else if (channel->exclusive()) {
+      // EPOLLEXCLUSIVE is only allowed with EPOLL_CTL_ADD.
+      Update(EPOLL_CTL_DEL, channel);
+      Update(EPOLL_CTL_ADD, channel);
+    } else {
+      Update(EPOLL_CTL_MOD, channel);
+    }
+  }
+}
+
+void EPollPoller::RemoveChannel(Channel* channel) {
+  assert(HasChannel(channel));
+  assert(channel->IsNoneEvent());
+  const int index = channel->index();
+  channels_.erase(channel->fd());
+  if (index == kAdded) {
+    Update(EPOLL_CTL_DEL, channel);
+  }
+  channel->set_index(kNew);
+}
+
+void EPollPoller::Update(int operation, Channel* channel) {
+  struct epoll_event event;
+  memset(&event, 0, sizeof(event));
+  event.events = channel->events();
+  if (channel->edge_triggered()) {
+    event.events |= EPOLLET;
+    // Lets a reader stop at a short read without missing a FIN that
+    // came in with the last data.
+    if (event.events & EPOLLIN) {
+      event.events |= EPOLLRDHUP;
+    }
+  }
+  if (channel->exclusive()) {
+    // Anything else, EPOLLPRI of the read mask included, is EINVAL.
+    event.events &= EPOLLIN | EPOLLOUT | EPOLLWAKEUP | EPOLLET;
+    event.events |= EPOLLEXCLUSIVE;
+  }
+  event.data.ptr = channel;
+  ++num_syscalls_;
+  if (::epoll_ctl(epollfd_, operation, channel->fd(), &event) < 0) {
+    fprintf(stderr, "EPollPoller::Update: epoll_ctl op=%d fd=%d: %s\n",
+            operation, channel->fd(), strerror(errno));
+    if (operation != EPOLL_CTL_DEL) {
+      abort();
+    }
+  }
+}
+
+}  // namespace net
+
+}  // namespace mymuduo
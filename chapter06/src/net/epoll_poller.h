@@ -0,0 +1,38 @@
+#pragma once
+
+#include <vector>
+
+#include "poller.h"
+
+struct epoll_event;
+
+namespace mymuduo {
+
+namespace net {
+
+// epoll(7), level triggered unless a channel asks for EPOLLET or
+// EPOLLEXCLUSIVE.
+class EPollPoller : public Poller {
+ public:
+  explicit EPollPoller(EventLoop* loop);
+  ~EPollPoller() override;
+
+  void Poll(int timeout_ms, ChannelList* active_channels) override;
+  void UpdateChannel(Channel* channel) override;
+  void RemoveChannel(Channel* channel) override;
+  const char* name() const override { return "epoll"; }
+
+ private:
+  static const int kInitEventListSize = 16;
+
+  void FillActiveChannels(int num_events, ChannelList* active_channels) const;
+  void Update(int operation, Channel* channel);
+
+ private:
+  int epollfd_;
+  std::vector<struct epoll_event> events_;
+};
+
+}  // namespace net
+
+}  // namespace mymuduo
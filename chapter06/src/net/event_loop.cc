@@ -0,0 +1,257 @@
+#include "event_loop.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+#include "channel.h"
+#include "poller.h"
+#include "stats.h"
+
+namespace mymuduo {
+
+namespace net {
+
+namespace {
+
+__thread EventLoop* t_loop_in_this_thread = nullptr;
+
+const int kPollTimeMs = 10000;
+
+int CreateEventFd() {
+  int evtfd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (evtfd < 0) {
+    fprintf(stderr, "EventLoop: eventfd: %s\n", strerror(errno));
+    abort();
+  }
+  return evtfd;
+}
+
+// A peer closing its end must not kill the process on the next write.
+class IgnoreSigPipe {
+ public:
+  IgnoreSigPipe() { ::signal(SIGPIPE, SIG_IGN); }
+};
+
+IgnoreSigPipe ignore_sig_pipe;
+
+}  // namespace
+
+EventLoop* EventLoop::GetEventLoopOfCurrentThread() {
+  return t_loop_in_this_thread;
+}
+
+EventLoop::EventLoop()
+    : looping_(false),
+      quit_(false),
+      event_handling_(false),
+      calling_pending_functors_(false),
+      iteration_(0),
+      thread_id_(CurrentThread::Tid()),
+      poller_(Poller::NewDefaultPoller(this)),
+      wakeup_fd_(CreateEventFd()),
+      wakeup_channel_(new Channel(this, wakeup_fd_)),
+      timer_queue_(new TimerQueue(this)),
+      busy_ns_(Stats::GetHistogram("event_loop.busy_ns", thread_id_)),
+      pending_functors_gauge_(Stats::GetGauge("event_loop.pending_functors", thread_id_)),
+      queue_lock_wait_ns_(Stats::GetHistogram("event_loop.queue_lock_wait_ns", thread_id_)) {
+  if (t_loop_in_this_thread) {
+    fprintf(stderr, "EventLoop: another loop %p exists in thread %d\n",
+            t_loop_in_this_thread, thread_id_);
+    abort();
+  }
+  t_loop_in_this_thread = this;
+  wakeup_channel_->SetReadCallback([this]() { HandleWakeup(); });
+  wakeup_channel_->EnableReading();
+}
+
+EventLoop::~EventLoop() {
+  wakeup_channel_->DisableAll();
+  wakeup_channel_->Remove();
+  ::close(wakeup_fd_);
+  t_loop_in_this_thread = nullptr;
+}
+
+void EventLoop::Loop() {
+  assert(!looping_);
+  AssertInLoopThread();
+  looping_ = true;
+  quit_ = false;
+
+  while (!quit_) {
+    active_channels_.clear();
+    // Requeued channels have work already, do not block.
+    poller_->Poll(requeued_channels_.empty() ? kPollTimeMs : 0, &active_channels_);
+    LatencyRecorder::Timer busy(busy_ns_);
+    ++iteration_;
+    AddRequeuedChannels();
+    event_handling_ = true;
+    for (Channel* channel : active_channels_) {
+      channel->HandleEvent();
+    }
+    event_handling_ = false;
+    DoPendingFunctors();
+  }
+
+  looping_ = false;
+}
+
+void EventLoop::Quit() {
+  quit_ = true;
+  // The loop may be blocked in Poll, when called from another thread.
+  if (!IsInLoopThread()) {
+    Wakeup();
+  }
+}
+
+void EventLoop::RunInLoop(Functor cb) {
+  if (IsInLoopThread()) {
+    cb();
+  } else {
+    QueueInLoop(std::move(cb));
+  }
+}
+
+void EventLoop::QueueInLoop(Functor cb) {
+  {
+    TimedMutexLockGuard mtx_guard(mtx_, queue_lock_wait_ns_);
+    pending_functors_.push_back(std::move(cb));
+  }
+  // A functor queued by a pending functor must not wait for the next event.
+  if (!IsInLoopThread() || calling_pending_functors_) {
+    Wakeup();
+  }
+}
+
+size_t EventLoop::QueueSize() const {
+  MutexLockGuard mtx_guard(mtx_);
+  return pending_functors_.size();
+}
+
+TimerId EventLoop::RunAt(int64_t when, Functor cb) {
+  return timer_queue_->AddTimer(std::move(cb), when, 0);
+}
+
+TimerId EventLoop::RunAfter(double delay_seconds, Functor cb) {
+  const int64_t delay_us = static_cast<int64_t>(delay_seconds * 1000000);
+  return timer_queue_->AddTimer(std::move(cb), TimerQueue::Now() + delay_us, 0);
+}
+
+TimerId EventLoop::RunEvery(double interval_seconds, Functor cb) {
+  const int64_t interval_us = static_cast<int64_t>(interval_seconds * 1000000);
+  return timer_queue_->AddTimer(std::move(cb), TimerQueue::Now() + interval_us, interval_us);
+}
+
+void EventLoop::Cancel(TimerId timer_id) {
+  timer_queue_->Cancel(timer_id);
+}
+
+void EventLoop::UpdateChannel(Channel* channel) {
+  assert(channel->OwnerLoop() == this);
+  AssertInLoopThread();
+  poller_->UpdateChannel(channel);
+}
+
+void EventLoop::RemoveChannel(Channel* channel) {
+  assert(channel->OwnerLoop() == this);
+  AssertInLoopThread();
+  auto it = std::find(requeued_channels_.begin(), requeued_channels_.end(), channel);
+  if (it != requeued_channels_.end()) {
+    requeued_channels_.erase(it);
+  }
+  poller_->RemoveChannel(channel);
+}
+
+void EventLoop::RequeueReadable(Channel* channel) {
+  assert(channel->OwnerLoop() == this);
+  AssertInLoopThread();
+  if (std::find(requeued_channels_.begin(), requeued_channels_.end(), channel) ==
+      requeued_channels_.end()) {
+    requeued_channels_.push_back(channel);
+  }
+}
+
+void EventLoop::AddRequeuedChannels() {
+  ChannelList requeued;
+  requeued.swap(requeued_channels_);
+  for (Channel* channel : requeued) {
+    if (!channel->IsReading()) {
+      continue;
+    }
+    // A new edge may have reported it already.
+    auto it = std::find(active_channels_.begin(), active_channels_.end(), channel);
+    if (it == active_channels_.end()) {
+      channel->set_revents(EPOLLIN);
+      active_channels_.push_back(channel);
+    } else {
+      channel->set_revents(channel->revents() | EPOLLIN);
+    }
+  }
+}
+
+bool EventLoop::HasChannel(Channel* channel) {
+  assert(channel->OwnerLoop() == this);
+  AssertInLoopThread();
+  return poller_->HasChannel(channel);
+}
+
+bool EventLoop::SupportsCompletionReads() const {
+  return poller_->SupportsCompletionReads();
+}
+
+const char* EventLoop::PollerName() const {
+  return poller_->name();
+}
+
+int64_t EventLoop::PollerSyscalls() const {
+  return poller_->num_syscalls();
+}
+
+void EventLoop::AbortNotInLoopThread() {
+  fprintf(stderr, "EventLoop %p was created in thread %d, current thread is %d\n",
+          this, thread_id_, CurrentThread::Tid());
+  abort();
+}
+
+void EventLoop::Wakeup() {
+  uint64_t one = 1;
+  ssize_t n = ::write(wakeup_fd_, &one, sizeof(one));
+  if (n != sizeof(one)) {
+    fprintf(stderr, "EventLoop::Wakeup writes %zd bytes instead of 8\n", n);
+  }
+}
+
+void EventLoop::HandleWakeup() {
+  uint64_t one = 1;
+  ssize_t n = ::read(wakeup_fd_, &one, sizeof(one));
+  if (n != sizeof(one)) {
+    fprintf(stderr, "EventLoop::HandleWakeup reads %zd bytes instead of 8\n", n);
+  }
+}
+
+void EventLoop::DoPendingFunctors() {
+  std::vector<Functor> functors;
+  calling_pending_functors_ = true;
+  {
+    // Swap out, so a functor can queue more without deadlock.
+    MutexLockGuard mtx_guard(mtx_);
+    functors.swap(pending_functors_);
+  }
+  pending_functors_gauge_->Set(static_cast<int64_t>(functors.size()));
+  for (const Functor& functor : functors) {
+    functor();
+  }
+  calling_pending_functors_ = false;
+}
+
+}  // namespace net
+
+}  // namespace mymuduo
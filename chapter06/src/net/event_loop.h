@@ -0,0 +1,117 @@
+#pragma once
+
+#include <stdint.h>
+#include <sys/types.h>
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "current_thread.h"
+#include "mutex.h"
+#include "timer_queue.h"
+
+namespace mymuduo {
+
+class Gauge;
+class LatencyRecorder;
+
+namespace net {
+
+class Channel;
+class Poller;
+
+// Reactor, at most one per thread.
+// Everything but Quit, RunInLoop, QueueInLoop and Wakeup must be called in
+// the thread that created the loop.
+// Keeps the Stats event_loop.busy_ns (an iteration from the poll returning
+// to the pending functors done), .pending_functors (run per iteration)
+// and .queue_lock_wait_ns, labelled with the loop thread.
+class EventLoop {
+ public:
+  using Functor = std::function<void()>;
+
+  EventLoop();
+  ~EventLoop();
+
+  EventLoop(const EventLoop&) = delete;
+  EventLoop& operator=(const EventLoop&) = delete;
+
+  // Loops until Quit.
+  void Loop();
+  void Quit();
+
+  int64_t iteration() const { return iteration_; }
+  // While the channels of one poll are being handled.
+  bool event_handling() const { return event_handling_; }
+
+  // Runs cb right away in the loop thread, otherwise queues it.
+  void RunInLoop(Functor cb);
+  // Queues cb and runs it after the current round of events.
+  void QueueInLoop(Functor cb);
+  size_t QueueSize() const;
+
+  // Timers, when is in TimerQueue::Now() microseconds.
+  TimerId RunAt(int64_t when, Functor cb);
+  TimerId RunAfter(double delay_seconds, Functor cb);
+  TimerId RunEvery(double interval_seconds, Functor cb);
+  void Cancel(TimerId timer_id);
+
+  void Wakeup();
+  void UpdateChannel(Channel* channel);
+  void RemoveChannel(Channel* channel);
+  bool HasChannel(Channel* channel);
+  // Reports channel readable again in the next iteration, without waiting
+  // for the poller. For edge triggered channels that stop reading before
+  // EAGAIN so one busy fd cannot starve the others.
+  void RequeueReadable(Channel* channel);
+  // Whether channels of this loop can use completion reads.
+  bool SupportsCompletionReads() const;
+  const char* PollerName() const;
+  int64_t PollerSyscalls() const;
+
+  void AssertInLoopThread() {
+    if (!IsInLoopThread()) {
+      AbortNotInLoopThread();
+    }
+  }
+  bool IsInLoopThread() const { return thread_id_ == CurrentThread::Tid(); }
+
+  static EventLoop* GetEventLoopOfCurrentThread();
+
+ private:
+  void AbortNotInLoopThread();
+  void HandleWakeup();
+  void AddRequeuedChannels();
+  void DoPendingFunctors();
+
+ private:
+  using ChannelList = std::vector<Channel*>;
+
+  std::atomic<bool> looping_;
+  std::atomic<bool> quit_;
+  bool event_handling_;
+  bool calling_pending_functors_;
+  int64_t iteration_;
+  const pid_t thread_id_;
+  std::unique_ptr<Poller> poller_;
+
+  int wakeup_fd_;
+  std::unique_ptr<Channel> wakeup_channel_;
+  std::unique_ptr<TimerQueue> timer_queue_;
+
+  ChannelList active_channels_;
+  ChannelList requeued_channels_;
+
+  mutable MutexLock mtx_;
+  std::vector<Functor> pending_functors_;  // guarded by mtx_
+
+  LatencyRecorder* const busy_ns_;
+  Gauge* const pending_functors_gauge_;
+  LatencyRecorder* const queue_lock_wait_ns_;
+};
+
+}  // namespace net
+
+}  // namespace mymuduo
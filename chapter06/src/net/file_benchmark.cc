@@ -0,0 +1,144 @@
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "buffer.h"
+#include "event_loop.h"
+#include "inet_address.h"
+#include "tcp_connection.h"
+#include "tcp_server.h"
+
+// Serves one file per connection over loopback, with SendFile or with
+// pread+Send, and reports the throughput the client sees.
+// usage: file_benchmark [file_mib] [repeats]
+
+using mymuduo::net::EventLoop;
+using mymuduo::net::InetAddress;
+using mymuduo::net::TcpConnectionPtr;
+using mymuduo::net::TcpServer;
+
+namespace {
+
+constexpr size_t kChunkBytes = 64 * 1024;
+constexpr size_t kHighWaterMark = 1024 * 1024;
+constexpr size_t kLowWaterMark = 256 * 1024;
+
+int g_file_fd = -1;
+size_t g_file_bytes = 0;
+InetAddress g_server_addr;
+
+double NowSeconds() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<double>(ts.tv_sec) + static_cast<double>(ts.tv_nsec) / 1e9;
+}
+
+// State of a read+write transfer.
+struct Reader {
+  size_t offset{0};
+  bool paused{false};
+};
+
+void ReadAndSend(const TcpConnectionPtr& conn) {
+  auto* reader = std::any_cast<Reader>(conn->GetMutableContext());
+  char buf[kChunkBytes];
+  while (!reader->paused && reader->offset < g_file_bytes) {
+    ssize_t n = ::pread(g_file_fd, buf, sizeof(buf), reader->offset);
+    if (n <= 0) {
+      break;
+    }
+    reader->offset += n;
+    conn->Send(std::string_view(buf, n));
+  }
+  if (reader->offset >= g_file_bytes) {
+    conn->Shutdown();
+  }
+}
+
+void* ClientRoutine(void* arg) {
+  int sockfd = ::socket(AF_INET, SOCK_STREAM, 0);
+  ::connect(sockfd, g_server_addr.GetSockAddr(), sizeof(struct sockaddr_in));
+  std::vector<char> buf(256 * 1024);
+  size_t received = 0;
+  ssize_t n = 0;
+  while ((n = ::read(sockfd, buf.data(), buf.size())) > 0) {
+    received += n;
+  }
+  ::close(sockfd);
+  *static_cast<size_t*>(arg) = received;
+  return nullptr;
+}
+
+double RunOnce(bool use_sendfile) {
+  EventLoop loop;
+  TcpServer server(&loop, InetAddress(0, true), "file");
+  server.SetConnectionCallback([&loop, use_sendfile](const TcpConnectionPtr& conn) {
+    if (!conn->Connected()) {
+      loop.Quit();
+    } else if (use_sendfile) {
+      conn->SendFile(g_file_fd, 0, g_file_bytes);
+      conn->Shutdown();
+    } else {
+      conn->SetContext(Reader());
+      conn->SetHighWaterMarkCallback([](const TcpConnectionPtr& conn, size_t) {
+        std::any_cast<Reader>(conn->GetMutableContext())->paused = true;
+      }, kHighWaterMark);
+      conn->SetLowWaterMarkCallback([](const TcpConnectionPtr& conn, size_t) {
+        std::any_cast<Reader>(conn->GetMutableContext())->paused = false;
+        ReadAndSend(conn);
+      }, kLowWaterMark);
+      ReadAndSend(conn);
+    }
+  });
+  server.Start();
+  g_server_addr = server.listen_address();
+
+  size_t received = 0;
+  double start = NowSeconds();
+  pthread_t client;
+  MCHECK(pthread_create(&client, nullptr, ClientRoutine, &received));
+  loop.Loop();
+  MCHECK(pthread_join(client, nullptr));
+  double seconds = NowSeconds() - start;
+  if (received != g_file_bytes) {
+    fprintf(stderr, "received %zu bytes instead of %zu\n", received, g_file_bytes);
+  }
+  return static_cast<double>(received) / (1024 * 1024) / seconds;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  size_t file_mib = argc > 1 ? atoi(argv[1]) : 256;
+  int repeats = argc > 2 ? atoi(argv[2]) : 5;
+
+  char path[] = "/tmp/mymuduo_file_benchmark_XXXXXX";
+  g_file_fd = ::mkstemp(path);
+  ::unlink(path);
+  g_file_bytes = file_mib * 1024 * 1024;
+  std::string chunk(kChunkBytes, 'x');
+  for (size_t written = 0; written < g_file_bytes; written += chunk.size()) {
+    ::write(g_file_fd, chunk.data(), chunk.size());
+  }
+
+  printf("%-12s %8s %12s\n", "mode", "file_mib", "median_mib/s");
+  for (bool use_sendfile : {false, true}) {
+    std::vector<double> rates;
+    RunOnce(use_sendfile);  // warm up
+    for (int i = 0; i < repeats; ++i) {
+      rates.push_back(RunOnce(use_sendfile));
+    }
+    std::sort(rates.begin(), rates.end());
+    printf("%-12s %8zu %12.1f\n", use_sendfile ? "sendfile" : "read+write", file_mib,
+           rates[rates.size() / 2]);
+  }
+  ::close(g_file_fd);
+  return 0;
+}
@@ -0,0 +1,43 @@
+#include "inet_address.h"
+
+#include <arpa/inet.h>
+#include <stdio.h>
+#include <string.h>
+
+namespace mymuduo {
+
+namespace net {
+
+InetAddress::InetAddress(uint16_t port, bool loopback_only) {
+  memset(&addr_, 0, sizeof(addr_));
+  addr_.sin_family = AF_INET;
+  addr_.sin_addr.s_addr = htonl(loopback_only ? INADDR_LOOPBACK : INADDR_ANY);
+  addr_.sin_port = htons(port);
+}
+
+InetAddress::InetAddress(const std::string& ip, uint16_t port) {
+  memset(&addr_, 0, sizeof(addr_));
+  addr_.sin_family = AF_INET;
+  addr_.sin_port = htons(port);
+  if (::inet_pton(AF_INET, ip.c_str(), &addr_.sin_addr) <= 0) {
+    fprintf(stderr, "InetAddress: bad ip %s\n", ip.c_str());
+  }
+}
+
+std::string InetAddress::ToIp() const {
+  char buf[INET_ADDRSTRLEN] = "";
+  ::inet_ntop(AF_INET, &addr_.sin_addr, buf, sizeof(buf));
+  return buf;
+}
+
+std::string InetAddress::ToIpPort() const {
+  return ToIp() + ":" + std::to_string(Port());
+}
+
+uint16_t InetAddress::Port() const {
+  return ntohs(addr_.sin_port);
+}
+
+}  // namespace net
+
+}  // namespace mymuduo
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <netinet/in.h>
+#include <stdint.h>
+
+#include <string>
+
+namespace mymuduo {
+
+namespace net {
+
+// IPv4 socket address, a thin wrapper of sockaddr_in.
+class InetAddress {
+ public:
+  // For listening, binds INADDR_ANY or the loopback address.
+  explicit InetAddress(uint16_t port = 0, bool loopback_only = false);
+
+  // ip is "1.2.3.4"
+  InetAddress(const std::string& ip, uint16_t port);
+
+  explicit InetAddress(const struct sockaddr_in& addr) : addr_(addr) {}
+
+  std::string ToIp() const;
+  std::string ToIpPort() const;
+  uint16_t Port() const;
+
+  const struct sockaddr* GetSockAddr() const {
+    return reinterpret_cast<const struct sockaddr*>(&addr_);
+  }
+  void SetSockAddr(const struct sockaddr_in& addr) { addr_ = addr; }
+
+ private:
+  struct sockaddr_in addr_;
+};
+
+}  // namespace net
+
+}  // namespace mymuduo
@@ -0,0 +1,225 @@
+#include "io_uring.h"
+
+#include <errno.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace mymuduo {
+
+namespace net {
+
+namespace {
+
+int SysSetup(unsigned entries, struct io_uring_params* params) {
+  return static_cast<int>(::syscall(__NR_io_uring_setup, entries, params));
+}
+
+int SysRegister(int fd, unsigned opcode, void* arg, unsigned nr_args) {
+  return static_cast<int>(::syscall(__NR_io_uring_register, fd, opcode, arg, nr_args));
+}
+
+}  // namespace
+
+IoUring::~IoUring() {
+  if (sqes_) {
+    ::munmap(sqes_, sqes_size_);
+  }
+  if (ring_) {
+    ::munmap(ring_, ring_size_);
+  }
+  if (ring_fd_ >= 0) {
+    ::close(ring_fd_);
+  }
+}
+
+bool IoUring::Init(unsigned entries) {
+  struct io_uring_params params;
+  memset(&params, 0, sizeof(params));
+  // Multishot recv completes far more often than we submit.
+  params.flags = IORING_SETUP_CQSIZE | IORING_SETUP_COOP_TASKRUN | IORING_SETUP_SINGLE_ISSUER;
+  params.cq_entries = entries * 8;
+  ring_fd_ = SysSetup(entries, &params);
+  if (ring_fd_ < 0 && errno == EINVAL) {
+    params.flags = IORING_SETUP_CQSIZE;
+    ring_fd_ = SysSetup(entries, &params);
+  }
+  if (ring_fd_ < 0) {
+    return false;
+  }
+  const unsigned kNeeded = IORING_FEAT_SINGLE_MMAP | IORING_FEAT_NODROP | IORING_FEAT_EXT_ARG;
+  if ((params.features & kNeeded) != kNeeded) {
+    errno = ENOSYS;
+    return false;
+  }
+
+  size_t sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  size_t cq_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+  ring_size_ = sq_size > cq_size ? sq_size : cq_size;
+  void* ring = ::mmap(nullptr, ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                      ring_fd_, IORING_OFF_SQ_RING);
+  if (ring == MAP_FAILED) {
+    return false;
+  }
+  ring_ = ring;
+  sqes_size_ = params.sq_entries * sizeof(struct io_uring_sqe);
+  void* sqes = ::mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                      ring_fd_, IORING_OFF_SQES);
+  if (sqes == MAP_FAILED) {
+    return false;
+  }
+  sqes_ = static_cast<struct io_uring_sqe*>(sqes);
+
+  char* base = static_cast<char*>(ring_);
+  sq_khead_ = reinterpret_cast<unsigned*>(base + params.sq_off.head);
+  sq_ktail_ = reinterpret_cast<unsigned*>(base + params.sq_off.tail);
+  sq_mask_ = *reinterpret_cast<unsigned*>(base + params.sq_off.ring_mask);
+  sq_entries_ = params.sq_entries;
+  sq_tail_ = *sq_ktail_;
+  // SQE i always sits in slot i.
+  unsigned* array = reinterpret_cast<unsigned*>(base + params.sq_off.array);
+  for (unsigned i = 0; i < sq_entries_; ++i) {
+    array[i] = i;
+  }
+  cq_khead_ = reinterpret_cast<unsigned*>(base + params.cq_off.head);
+  cq_ktail_ = reinterpret_cast<unsigned*>(base + params.cq_off.tail);
+  cq_mask_ = *reinterpret_cast<unsigned*>(base + params.cq_off.ring_mask);
+  cqes_ = reinterpret_cast<struct io_uring_cqe*>(base + params.cq_off.cqes);
+  return true;
+}
+
+struct io_uring_sqe* IoUring::GetSqe() {
+  if (sq_tail_ - __atomic_load_n(sq_khead_, __ATOMIC_ACQUIRE) >= sq_entries_) {
+    return nullptr;
+  }
+  struct io_uring_sqe* sqe = &sqes_[sq_tail_ & sq_mask_];
+  ++sq_tail_;
+  memset(sqe, 0, sizeof(*sqe));
+  return sqe;
+}
+
+unsigned IoUring::PendingSubmissions() const {
+  return sq_tail_ - __atomic_load_n(sq_khead_, __ATOMIC_ACQUIRE);
+}
+
+bool IoUring::HasCompletions() const {
+  return *cq_khead_ != __atomic_load_n(cq_ktail_, __ATOMIC_ACQUIRE);
+}
+
+int IoUring::Submit() {
+  return Enter(PendingSubmissions(), 0, 0, nullptr, 0);
+}
+
+int IoUring::SubmitAndWait(int timeout_ms) {
+  if (timeout_ms < 0) {
+    return Enter(PendingSubmissions(), 1, IORING_ENTER_GETEVENTS, nullptr, 0);
+  }
+  struct __kernel_timespec ts;
+  ts.tv_sec = timeout_ms / 1000;
+  ts.tv_nsec = (timeout_ms % 1000) * 1000000LL;
+  struct io_uring_getevents_arg arg;
+  memset(&arg, 0, sizeof(arg));
+  arg.ts = reinterpret_cast<uint64_t>(&ts);
+  return Enter(PendingSubmissions(), 1, IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG,
+               &arg, sizeof(arg));
+}
+
+int IoUring::Enter(unsigned to_submit, unsigned min_complete, unsigned flags, void* arg,
+                   size_t arg_size) {
+  __atomic_store_n(sq_ktail_, sq_tail_, __ATOMIC_RELEASE);
+  ++num_enters_;
+  return static_cast<int>(::syscall(__NR_io_uring_enter, ring_fd_, to_submit, min_complete,
+                                    flags, arg, arg_size));
+}
+
+BufferRing::~BufferRing() {
+  if (registered_) {
+    struct io_uring_buf_reg reg;
+    memset(&reg, 0, sizeof(reg));
+    reg.bgid = group_id_;
+    SysRegister(uring_->fd(), IORING_UNREGISTER_PBUF_RING, &reg, 1);
+  }
+  if (buffers_) {
+    ::munmap(buffers_, buffers_size_);
+  }
+  if (ring_) {
+    ::munmap(ring_, ring_size_);
+  }
+}
+
+bool BufferRing::Init(IoUring* ring, Mode mode, uint16_t group_id, unsigned entries,
+                      size_t buffer_size) {
+  uring_ = ring;
+  mode_ = mode;
+  buffers_size_ = entries * buffer_size;
+  void* mem = ::mmap(nullptr, buffers_size_, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (mem == MAP_FAILED) {
+    return false;
+  }
+  buffers_ = static_cast<char*>(mem);
+  buffer_size_ = buffer_size;
+  mask_ = entries - 1;
+  group_id_ = group_id;
+
+  if (mode == kProvide) {
+    Provide(0, entries);
+    return true;
+  }
+
+  ring_size_ = entries * sizeof(struct io_uring_buf);
+  mem = ::mmap(nullptr, ring_size_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (mem == MAP_FAILED) {
+    return false;
+  }
+  // Fault the pages in before the kernel pins them.
+  memset(mem, 0, ring_size_);
+  ring_ = static_cast<struct io_uring_buf_ring*>(mem);
+
+  struct io_uring_buf_reg reg;
+  memset(&reg, 0, sizeof(reg));
+  reg.ring_addr = reinterpret_cast<uint64_t>(ring_);
+  reg.ring_entries = entries;
+  reg.bgid = group_id;
+  if (SysRegister(ring->fd(), IORING_REGISTER_PBUF_RING, &reg, 1) < 0) {
+    return false;
+  }
+  registered_ = true;
+  for (unsigned i = 0; i < entries; ++i) {
+    Recycle(static_cast<uint16_t>(i));
+  }
+  return true;
+}
+
+void BufferRing::Recycle(uint16_t buffer_id) {
+  if (mode_ == kProvide) {
+    Provide(buffer_id, 1);
+    return;
+  }
+  struct io_uring_buf* buf = &ring_->bufs[tail_ & mask_];
+  buf->addr = reinterpret_cast<uint64_t>(Data(buffer_id));
+  buf->len = static_cast<uint32_t>(buffer_size_);
+  buf->bid = buffer_id;
+  ++tail_;
+  __atomic_store_n(&ring_->tail, tail_, __ATOMIC_RELEASE);
+}
+
+void BufferRing::Provide(uint16_t buffer_id, unsigned count) {
+  struct io_uring_sqe* sqe = uring_->GetSqe();
+  while (!sqe) {
+    uring_->Submit();
+    sqe = uring_->GetSqe();
+  }
+  sqe->opcode = IORING_OP_PROVIDE_BUFFERS;
+  sqe->fd = static_cast<int>(count);
+  sqe->addr = reinterpret_cast<uint64_t>(Data(buffer_id));
+  sqe->len = static_cast<uint32_t>(buffer_size_);
+  sqe->off = buffer_id;
+  sqe->buf_group = group_id_;
+  sqe->user_data = 0;
+}
+
+}  // namespace net
+
+}  // namespace mymuduo
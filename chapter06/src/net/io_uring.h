@@ -0,0 +1,122 @@
+#pragma once
+
+#include <linux/io_uring.h>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace mymuduo {
+
+namespace net {
+
+// Minimal io_uring(7) over the raw syscalls, owned by a single thread.
+// SQEs are only queued by GetSqe, nothing reaches the kernel until Submit
+// or SubmitAndWait, so a loop iteration costs one io_uring_enter.
+class IoUring {
+ public:
+  IoUring() = default;
+  ~IoUring();
+
+  IoUring(const IoUring&) = delete;
+  IoUring& operator=(const IoUring&) = delete;
+
+  // False if the kernel lacks io_uring or a feature used here.
+  bool Init(unsigned entries);
+
+  int fd() const { return ring_fd_; }
+
+  // A zeroed SQE, or nullptr when the submission queue is full.
+  struct io_uring_sqe* GetSqe();
+  unsigned PendingSubmissions() const;
+
+  // Returns what io_uring_enter returns.
+  int Submit();
+  // Submits and waits up to timeout_ms (< 0 forever) for one completion.
+  int SubmitAndWait(int timeout_ms);
+
+  bool HasCompletions() const;
+
+  // Calls f(cqe) for every completion, the CQE slot is released first so
+  // f may submit more.
+  template<typename F>
+  unsigned ForEachCompletion(F f) {
+    unsigned head = *cq_khead_;
+    unsigned count = 0;
+    while (head != __atomic_load_n(cq_ktail_, __ATOMIC_ACQUIRE)) {
+      struct io_uring_cqe cqe = cqes_[head & cq_mask_];
+      ++head;
+      __atomic_store_n(cq_khead_, head, __ATOMIC_RELEASE);
+      f(cqe);
+      ++count;
+    }
+    return count;
+  }
+
+  int64_t num_enters() const { return num_enters_; }
+
+ private:
+  int Enter(unsigned to_submit, unsigned min_complete, unsigned flags, void* arg, size_t arg_size);
+
+ private:
+  int ring_fd_{-1};
+  void* ring_{nullptr};
+  size_t ring_size_{0};
+  struct io_uring_sqe* sqes_{nullptr};
+  size_t sqes_size_{0};
+
+  unsigned* sq_khead_{nullptr};
+  unsigned* sq_ktail_{nullptr};
+  unsigned sq_mask_{0};
+  unsigned sq_entries_{0};
+  unsigned sq_tail_{0};  // local, published on submit
+
+  unsigned* cq_khead_{nullptr};
+  unsigned* cq_ktail_{nullptr};
+  unsigned cq_mask_{0};
+  struct io_uring_cqe* cqes_{nullptr};
+
+  int64_t num_enters_{0};
+};
+
+// Provided buffers: the kernel picks one for every recv completion with
+// IOSQE_BUFFER_SELECT, the owner hands it back with Recycle once consumed.
+// kRing registers a buffer ring, recycling is a store to shared memory.
+// kProvide queues IORING_OP_PROVIDE_BUFFERS instead, for kernels where the
+// ring is missing or does not work.
+class BufferRing {
+ public:
+  enum Mode { kRing, kProvide };
+
+  BufferRing() = default;
+  ~BufferRing();
+
+  BufferRing(const BufferRing&) = delete;
+  BufferRing& operator=(const BufferRing&) = delete;
+
+  // entries must be a power of 2.
+  bool Init(IoUring* ring, Mode mode, uint16_t group_id, unsigned entries, size_t buffer_size);
+
+  Mode mode() const { return mode_; }
+  uint16_t group_id() const { return group_id_; }
+  const char* Data(uint16_t buffer_id) const { return buffers_ + buffer_id * buffer_size_; }
+  void Recycle(uint16_t buffer_id);
+
+ private:
+  void Provide(uint16_t buffer_id, unsigned count);
+
+ private:
+  IoUring* uring_{nullptr};
+  Mode mode_{kRing};
+  bool registered_{false};
+  struct io_uring_buf_ring* ring_{nullptr};
+  size_t ring_size_{0};
+  char* buffers_{nullptr};
+  size_t buffers_size_{0};
+  size_t buffer_size_{0};
+  unsigned mask_{0};
+  uint16_t tail_{0};
+  uint16_t group_id_{0};
+};
+
+}  // namespace net
+
+}  // namespace mymuduo
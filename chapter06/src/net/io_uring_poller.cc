@@ -0,0 +1,332 @@
+#include "io_uring_poller.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <atomic>
+
+#include "channel.h"
+
+namespace mymuduo {
+
+namespace net {
+
+namespace {
+
+// Channel::index() of a channel, as seen by IoUringPoller.
+const int kNew = -1;
+const int kAdded = 1;
+
+// user_data of SQEs whose completion is of no interest.
+const uint64_t kIgnoredToken = 0;
+
+// Whether buffer rings work on this kernel: 0 not probed yet, 1 or -1.
+// Probed by the first loop only, registering a ring that the kernel then
+// ignores has been seen to fault later loops.
+std::atomic<int> g_buffer_ring_works(0);
+
+}  // namespace
+
+IoUringPoller::IoUringPoller(EventLoop* loop)
+    : Poller(loop),
+      next_token_(1) {}
+
+bool IoUringPoller::Init() {
+  if (!ring_.Init(kRingEntries)) {
+    return false;
+  }
+  if (g_buffer_ring_works.load(std::memory_order_acquire) >= 0) {
+    buffers_.reset(new BufferRing);
+    const bool works =
+        buffers_->Init(&ring_, BufferRing::kRing, kBufferGroup, kBufferEntries, kBufferSize) &&
+        ProbeBuffers();
+    g_buffer_ring_works.store(works ? 1 : -1, std::memory_order_release);
+    if (works) {
+      return true;
+    }
+  }
+  buffers_.reset(new BufferRing);
+  return buffers_->Init(&ring_, BufferRing::kProvide, kBufferGroup, kBufferEntries, kBufferSize) &&
+         ProbeBuffers();
+}
+
+bool IoUringPoller::ProbeBuffers() {
+  int fds[2];
+  if (::socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds) < 0) {
+    return false;
+  }
+  const uint64_t kProbeToken = UINT64_MAX;
+  ssize_t n = ::write(fds[0], "p", 1);
+  struct io_uring_sqe* sqe = GetSqe();
+  sqe->opcode = IORING_OP_RECV;
+  sqe->fd = fds[1];
+  sqe->flags = IOSQE_BUFFER_SELECT;
+  sqe->buf_group = buffers_->group_id();
+  sqe->user_data = kProbeToken;
+  bool done = false;
+  bool ok = false;
+  while (n == 1 && !done && ring_.SubmitAndWait(1000) >= 0) {
+    ring_.ForEachCompletion([this, &done, &ok](const struct io_uring_cqe& cqe) {
+      if (cqe.user_data != kProbeToken) {
+        return;
+      }
+      done = true;
+      ok = cqe.res == 1 && (cqe.flags & IORING_CQE_F_BUFFER);
+      if (ok) {
+        buffers_->Recycle(static_cast<uint16_t>(cqe.flags >> IORING_CQE_BUFFER_SHIFT));
+      }
+    });
+  }
+  ::close(fds[0]);
+  ::close(fds[1]);
+  return ok;
+}
+
+const char* IoUringPoller::name() const {
+  return buffers_->mode() == BufferRing::kRing ? "io_uring/buf_ring" : "io_uring/provide_buffers";
+}
+
+void IoUringPoller::Poll(int timeout_ms, ChannelList* active_channels) {
+  // Channels handled in the last iteration are armed again only now.
+  std::vector<Channel*> rearm;
+  rearm.swap(rearm_);
+  for (Channel* channel : rearm) {
+    if (entries_.count(channel)) {
+      Sync(channel);
+    }
+  }
+
+  int ret = 0;
+  if (ring_.HasCompletions()) {
+    if (ring_.PendingSubmissions() > 0) {
+      ret = ring_.Submit();
+    }
+  } else {
+    ret = ring_.SubmitAndWait(timeout_ms);
+  }
+  if (ret < 0 && errno != ETIME && errno != EINTR && errno != EBUSY) {
+    fprintf(stderr, "IoUringPoller::Poll: %s\n", strerror(errno));
+  }
+
+  active_index_.clear();
+  ring_.ForEachCompletion([this, active_channels](const struct io_uring_cqe& cqe) {
+    HandleCompletion(cqe, active_channels);
+  });
+  num_syscalls_ = ring_.num_enters();
+}
+
+void IoUringPoller::Activate(Channel* channel, int revents, ChannelList* active_channels) {
+  auto it = active_index_.find(channel);
+  if (it != active_index_.end()) {
+    Channel* active = (*active_channels)[it->second];
+    active->set_revents(active->revents() | revents);
+    return;
+  }
+  active_index_[channel] = active_channels->size();
+  channel->set_revents(revents);
+  active_channels->push_back(channel);
+}
+
+void IoUringPoller::HandleCompletion(const struct io_uring_cqe& cqe,
+                                     ChannelList* active_channels) {
+  const bool has_buffer = cqe.flags & IORING_CQE_F_BUFFER;
+  const uint16_t buffer_id = static_cast<uint16_t>(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+  auto it = ops_.find(cqe.user_data);
+  if (it == ops_.end()) {
+    return;  // a removed poll, or a cancel
+  }
+
+  const Op op = it->second;
+  const bool more = cqe.flags & IORING_CQE_F_MORE;
+  Channel* channel = op.channel;
+  if (!channel) {
+    if (!more) {
+      ops_.erase(it);
+    }
+    if (has_buffer) {
+      buffers_->Recycle(buffer_id);
+    } else if (op.kind == kAcceptOp && cqe.res >= 0) {
+      ::close(cqe.res);
+    }
+    return;
+  }
+  if (!more) {
+    ops_.erase(it);
+    if (!op.cancelled) {
+      Entry& entry = entries_[channel];
+      if (op.kind == kPollOp) {
+        entry.poll_token = 0;
+        entry.poll_mask = 0;
+      } else {
+        entry.read_token = 0;
+      }
+    }
+  }
+
+  // No Entry reference may live across the callbacks below, a new
+  // connection may rehash entries_.
+  switch (op.kind) {
+    case kPollOp:
+      if (cqe.res == -ECANCELED) {
+        return;
+      }
+      Activate(channel, cqe.res < 0 ? static_cast<int>(EPOLLERR) : cqe.res, active_channels);
+      rearm_.push_back(channel);
+      break;
+
+    case kAcceptOp:
+      if (!more && !op.cancelled) {
+        rearm_.push_back(channel);
+      }
+      if (cqe.res != -ECANCELED) {
+        channel->HandleAccept(cqe.res);
+      }
+      break;
+
+    case kRecvOp:
+      if (!more && !op.cancelled && (cqe.res > 0 || cqe.res == -ENOBUFS)) {
+        rearm_.push_back(channel);
+      }
+      if (has_buffer) {
+        channel->HandleData(buffers_->Data(buffer_id), cqe.res);
+        buffers_->Recycle(buffer_id);
+        Activate(channel, EPOLLIN, active_channels);
+      } else if (cqe.res != -ENOBUFS && cqe.res != -ECANCELED) {
+        channel->HandleData(nullptr, cqe.res);
+        Activate(channel, EPOLLIN, active_channels);
+      }
+      break;
+  }
+}
+
+void IoUringPoller::UpdateChannel(Channel* channel) {
+  if (channel->index() == kNew) {
+    assert(channels_.find(channel->fd()) == channels_.end());
+    channels_[channel->fd()] = channel;
+    channel->set_index(kAdded);
+  }
+  assert(HasChannel(channel));
+  Sync(channel);
+}
+
+void IoUringPoller::RemoveChannel(Channel* channel) {
+  assert(HasChannel(channel));
+  assert(channel->IsNoneEvent());
+  channels_.erase(channel->fd());
+  for (auto it = ops_.begin(); it != ops_.end();) {
+    Op& op = it->second;
+    if (op.channel != channel) {
+      ++it;
+      continue;
+    }
+    if (!op.cancelled) {
+      PrepareCancel(it->first, op.kind);
+    }
+    if (op.kind == kPollOp) {
+      it = ops_.erase(it);
+    } else {
+      // Orphaned until its last completion, which may still carry an
+      // accepted fd or a buffer to give back.
+      op.channel = nullptr;
+      op.cancelled = true;
+      ++it;
+    }
+  }
+  entries_.erase(channel);
+  channel->set_index(kNew);
+}
+
+void IoUringPoller::Sync(Channel* channel) {
+  Entry& entry = entries_[channel];
+  const bool completion_read = channel->read_mode() != Channel::kReadReadiness;
+  uint32_t poll_mask = channel->events();
+  if (completion_read) {
+    poll_mask &= ~(EPOLLIN | EPOLLPRI);
+  }
+  if (entry.poll_token && entry.poll_mask != poll_mask) {
+    Cancel(entry.poll_token, kPollOp);
+    entry.poll_token = 0;
+    entry.poll_mask = 0;
+  }
+  if (!entry.poll_token && poll_mask) {
+    entry.poll_token = Arm(channel, kPollOp, poll_mask);
+    entry.poll_mask = poll_mask;
+  }
+
+  const bool want_read = completion_read && channel->IsReading();
+  if (entry.read_token && !want_read) {
+    Cancel(entry.read_token, channel->read_mode() == Channel::kReadAccept ? kAcceptOp : kRecvOp);
+    entry.read_token = 0;
+  }
+  if (!entry.read_token && want_read) {
+    entry.read_token = Arm(channel,
+                           channel->read_mode() == Channel::kReadAccept ? kAcceptOp : kRecvOp, 0);
+  }
+}
+
+struct io_uring_sqe* IoUringPoller::GetSqe() {
+  struct io_uring_sqe* sqe = ring_.GetSqe();
+  while (!sqe) {
+    // The queue is full, flush it early.
+    ring_.Submit();
+    sqe = ring_.GetSqe();
+  }
+  return sqe;
+}
+
+uint64_t IoUringPoller::Arm(Channel* channel, OpKind kind, uint32_t poll_mask) {
+  const uint64_t token = next_token_++;
+  struct io_uring_sqe* sqe = GetSqe();
+  sqe->fd = channel->fd();
+  sqe->user_data = token;
+  switch (kind) {
+    case kPollOp:
+      sqe->opcode = IORING_OP_POLL_ADD;
+      sqe->poll32_events = poll_mask;
+      break;
+    case kAcceptOp:
+      sqe->opcode = IORING_OP_ACCEPT;
+      sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+      sqe->accept_flags = SOCK_NONBLOCK | SOCK_CLOEXEC;
+      break;
+    case kRecvOp:
+      sqe->opcode = IORING_OP_RECV;
+      sqe->ioprio = IORING_RECV_MULTISHOT;
+      sqe->flags = IOSQE_BUFFER_SELECT;
+      sqe->buf_group = buffers_->group_id();
+      break;
+  }
+  ops_[token] = Op{channel, kind, false};
+  return token;
+}
+
+void IoUringPoller::Cancel(uint64_t token, OpKind kind) {
+  PrepareCancel(token, kind);
+  auto it = ops_.find(token);
+  if (it == ops_.end()) {
+    return;
+  }
+  if (kind == kPollOp) {
+    ops_.erase(it);
+  } else {
+    // Accepted fds and received bytes already in flight must not be lost.
+    it->second.cancelled = true;
+  }
+}
+
+void IoUringPoller::PrepareCancel(uint64_t token, OpKind kind) {
+  struct io_uring_sqe* sqe = GetSqe();
+  sqe->opcode = kind == kPollOp ? IORING_OP_POLL_REMOVE : IORING_OP_ASYNC_CANCEL;
+  sqe->fd = -1;
+  sqe->addr = token;
+  sqe->user_data = kIgnoredToken;
+}
+
+}  // namespace net
+
+}  // namespace mymuduo
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "io_uring.h"
+#include "poller.h"
+
+namespace mymuduo {
+
+namespace net {
+
+// io_uring backed Poller.
+//
+// Readiness is watched with one shot IORING_OP_POLL_ADD, re-armed at the
+// start of the next Poll after the channel has been handled, which keeps
+// the level triggered semantics of EPollPoller. Channels in a completion
+// read mode skip readability altogether: listening sockets get a multishot
+// accept and connections a multishot recv into a provided buffer ring.
+// Accepted fds go straight to the channel; received data is handed over
+// as it completes, and the channel then comes back active once per
+// iteration however many recvs completed for it, so a message split across
+// buffers reaches the owner in one piece. Every SQE queued during an
+// iteration goes to the kernel with the wait of the next one, in a single
+// io_uring_enter.
+//
+// Some kernels accept a buffer ring registration yet never pick from it,
+// so the first Init of the process probes the ring, and otherwise every
+// loop provides the same buffers with IORING_OP_PROVIDE_BUFFERS.
+class IoUringPoller : public Poller {
+ public:
+  explicit IoUringPoller(EventLoop* loop);
+  ~IoUringPoller() override = default;
+
+  // False if io_uring is unavailable, the caller falls back to epoll.
+  bool Init();
+
+  void Poll(int timeout_ms, ChannelList* active_channels) override;
+  void UpdateChannel(Channel* channel) override;
+  void RemoveChannel(Channel* channel) override;
+  bool SupportsCompletionReads() const override { return true; }
+  const char* name() const override;
+
+ private:
+  enum OpKind : uint8_t { kPollOp, kAcceptOp, kRecvOp };
+
+  struct Op {
+    Channel* channel;  // nullptr once the channel is removed
+    OpKind kind;
+    bool cancelled;  // still delivers what completed before the cancel
+  };
+
+  // What is armed in the kernel for a channel.
+  struct Entry {
+    uint64_t poll_token{0};
+    uint32_t poll_mask{0};
+    uint64_t read_token{0};
+  };
+
+  static const unsigned kRingEntries = 256;
+  static const unsigned kBufferEntries = 512;
+  static const size_t kBufferSize = 8 * 1024;
+  static const uint16_t kBufferGroup = 0;
+
+  // Whether a recv really gets a buffer from buffers_.
+  bool ProbeBuffers();
+  void Sync(Channel* channel);
+  struct io_uring_sqe* GetSqe();
+  uint64_t Arm(Channel* channel, OpKind kind, uint32_t poll_mask);
+  void Cancel(uint64_t token, OpKind kind);
+  void PrepareCancel(uint64_t token, OpKind kind);
+  void HandleCompletion(const struct io_uring_cqe& cqe, ChannelList* active_channels);
+  // Adds channel to active_channels once per Poll, merging revents.
+  void Activate(Channel* channel, int revents, ChannelList* active_channels);
+
+ private:
+  IoUring ring_;
+  std::unique_ptr<BufferRing> buffers_;
+  uint64_t next_token_;
+  std::unordered_map<Channel*, Entry> entries_;
+  std::unordered_map<uint64_t, Op> ops_;  // by SQE user_data
+  std::vector<Channel*> rearm_;
+  std::unordered_map<Channel*, size_t> active_index_;  // this Poll only
+};
+
+}  // namespace net
+
+}  // namespace mymuduo
@@ -0,0 +1,52 @@
+#include "length_header_codec.h"
+
+#include <assert.h>
+#include <stdio.h>
+
+#include <limits>
+
+#include "buffer.h"
+#include "tcp_connection.h"
+
+namespace mymuduo {
+
+namespace net {
+
+void LengthHeaderCodec::OnMessage(const TcpConnectionPtr& conn, Buffer* buffer) {
+  while (buffer->ReadableBytes() >= kHeaderLen) {
+    const int32_t len = buffer->PeekInt32();
+    if (len < 0 || len > max_message_len_) {
+      fprintf(stderr, "LengthHeaderCodec::OnMessage [%s]: invalid length %d\n",
+              conn->name().c_str(), len);
+      buffer->RetrieveAll();
+      conn->ForceClose();
+      return;
+    }
+    if (buffer->ReadableBytes() < kHeaderLen + static_cast<size_t>(len)) {
+      return;  // wait for the rest of the frame
+    }
+    const std::string_view message(buffer->Peek() + kHeaderLen, len);
+    message_callback_(conn, message);
+    buffer->Retrieve(kHeaderLen + len);
+  }
+}
+
+void LengthHeaderCodec::Send(const TcpConnectionPtr& conn, std::string_view message) {
+  Buffer buffer(message.size());
+  buffer.Append(message);
+  Send(conn, &buffer);
+}
+
+void LengthHeaderCodec::Send(const TcpConnectionPtr& conn, Buffer* buffer) {
+  Encode(buffer);
+  conn->Send(buffer);
+}
+
+void LengthHeaderCodec::Encode(Buffer* buffer) {
+  assert(buffer->ReadableBytes() <= static_cast<size_t>(std::numeric_limits<int32_t>::max()));
+  buffer->PrependInt32(static_cast<int32_t>(buffer->ReadableBytes()));
+}
+
+}  // namespace net
+
+}  // namespace mymuduo
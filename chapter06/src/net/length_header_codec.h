@@ -0,0 +1,57 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <functional>
+#include <string_view>
+#include <utility>
+
+#include "callbacks.h"
+
+namespace mymuduo {
+
+namespace net {
+
+// Frames messages with a 4 byte length header in network byte order.
+//
+// OnMessage goes in as the connection's message callback. It cuts every
+// complete frame out of the input buffer and hands the callback a view of
+// the payload in place, so a message is never copied out of the buffer;
+// the view is only good until the callback returns. An incomplete frame
+// stays in the buffer until the rest arrives.
+//
+// A header out of [0, max_message_len] means the stream is garbage, the
+// connection is closed.
+class LengthHeaderCodec {
+ public:
+  using StringMessageCallback =
+      std::function<void(const TcpConnectionPtr&, std::string_view message)>;
+
+  static constexpr size_t kHeaderLen = sizeof(int32_t);
+  static constexpr int32_t kDefaultMaxMessageLen = 64 * 1024 * 1024;
+
+  explicit LengthHeaderCodec(StringMessageCallback cb,
+                             int32_t max_message_len = kDefaultMaxMessageLen)
+      : message_callback_(std::move(cb)),
+        max_message_len_(max_message_len) {}
+
+  LengthHeaderCodec(const LengthHeaderCodec&) = delete;
+  LengthHeaderCodec& operator=(const LengthHeaderCodec&) = delete;
+
+  void OnMessage(const TcpConnectionPtr& conn, Buffer* buffer);
+
+  void Send(const TcpConnectionPtr& conn, std::string_view message);
+  // Frames the readable bytes of buffer by prepending the header in front
+  // of them, the payload does not move, and sends the frame.
+  static void Send(const TcpConnectionPtr& conn, Buffer* buffer);
+  static void Encode(Buffer* buffer);
+
+ private:
+  StringMessageCallback message_callback_;
+  const int32_t max_message_len_;
+};
+
+}  // namespace net
+
+}  // namespace mymuduo
@@ -0,0 +1,293 @@
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <any>
+#include <deque>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "event_loop.h"
+#include "histogram.h"
+#include "inet_address.h"
+#include "length_header_codec.h"
+#include "tcp_client.h"
+#include "tcp_connection.h"
+#include "tcp_server.h"
+#include "timer_queue.h"
+
+// Open-loop load over length-prefixed frames (LengthHeaderCodec).
+// Requests go out at a fixed rate whatever the server does: request i is
+// due at start + i / rate, on connection i % connections, and its latency
+// is measured from that intended send time, not from when it actually
+// went out. A server that stalls is thus charged for every request that
+// queued up behind the stall, which a closed-loop client would simply not
+// have sent (coordinated omission). The server must answer every frame
+// with exactly one frame, in order; without a target a forked echo server
+// built on the codec is used.
+// usage: load_generator [rate] [connections] [seconds] [message_bytes] [ip port]
+
+using mymuduo::Histogram;
+using mymuduo::net::Buffer;
+using mymuduo::net::EventLoop;
+using mymuduo::net::InetAddress;
+using mymuduo::net::LengthHeaderCodec;
+using mymuduo::net::TcpClient;
+using mymuduo::net::TcpConnectionPtr;
+using mymuduo::net::TcpServer;
+using mymuduo::net::TimerQueue;
+
+namespace {
+
+double g_rate = 50000;
+int g_connections = 50;
+double g_seconds = 5;
+size_t g_message_bytes = 64;
+const double kDrainSeconds = 2;  // wait for late responses after the last request
+const int64_t kHighestTrackableUs = 3600LL * 1000 * 1000;
+
+// Runs in the forked child, never returns.
+void RunEchoServer(int port_fd) {
+  EventLoop loop;
+  TcpServer server(&loop, InetAddress(0, true), "load_generator_echo");
+  LengthHeaderCodec codec([&codec](const TcpConnectionPtr& conn, std::string_view message) {
+    codec.Send(conn, message);
+  });
+  server.SetConnectionCallback([](const TcpConnectionPtr& conn) {
+    if (conn->Connected()) {
+      conn->SetTcpNoDelay(true);
+    }
+  });
+  server.SetMessageCallback([&codec](const TcpConnectionPtr& conn, Buffer* buffer) {
+    codec.OnMessage(conn, buffer);
+  });
+  server.Start();
+  const uint16_t port = server.listen_address().Port();
+  ::write(port_fd, &port, sizeof(port));
+  ::close(port_fd);
+  loop.Loop();
+  _exit(0);
+}
+
+class LoadGenerator {
+ public:
+  LoadGenerator(EventLoop* loop, const InetAddress& server_addr)
+      : loop_(loop),
+        codec_([this](const TcpConnectionPtr& conn, std::string_view) { OnResponse(conn); }),
+        request_(g_message_bytes, 'l'),
+        latency_us_(kHighestTrackableUs),
+        send_lag_us_(kHighestTrackableUs),
+        total_requests_(static_cast<int64_t>(g_rate * g_seconds)),
+        next_request_(0),
+        connected_(0),
+        responses_(0),
+        unexpected_(0),
+        start_(0) {
+    for (int i = 0; i < g_connections; ++i) {
+      sessions_.emplace_back(new Session(loop, server_addr, i));
+    }
+  }
+
+  // The clients close their connections in their destructors, and report it.
+  ~LoadGenerator() { finished_ = true; }
+
+  void Start() {
+    for (auto& session : sessions_) {
+      const int index = session->index;
+      session->client.SetConnectionCallback([this, index](const TcpConnectionPtr& conn) {
+        OnConnection(index, conn);
+      });
+      session->client.SetMessageCallback([this](const TcpConnectionPtr& conn, Buffer* buffer) {
+        codec_.OnMessage(conn, buffer);
+      });
+      session->client.SetConnectFailedCallback([this](int) { loop_->Quit(); });
+      session->client.Connect();
+    }
+  }
+
+ private:
+  struct Session {
+    Session(EventLoop* loop, const InetAddress& server_addr, int i)
+        : client(loop, server_addr, "load_generator#" + std::to_string(i)), index(i) {}
+
+    TcpClient client;
+    const int index;
+    TcpConnectionPtr conn;
+    std::deque<int64_t> intended;  // send times of the requests in flight
+  };
+
+  void OnConnection(int index, const TcpConnectionPtr& conn) {
+    if (finished_) {
+      return;
+    }
+    Session* session = sessions_[index].get();
+    if (!conn->Connected()) {
+      session->conn.reset();
+      return;
+    }
+    conn->SetTcpNoDelay(true);
+    conn->SetContext(index);
+    session->conn = conn;
+    if (++connected_ == g_connections) {
+      start_ = TimerQueue::Now();
+      SendDue();
+    }
+  }
+
+  int64_t IntendedTime(int64_t i) const {
+    return start_ + static_cast<int64_t>(static_cast<double>(i) * 1e6 / g_rate);
+  }
+
+  // Sends every request that is due, then sleeps until the next one.
+  void SendDue() {
+    const int64_t now = TimerQueue::Now();
+    while (next_request_ < total_requests_ && IntendedTime(next_request_) <= now) {
+      const int64_t intended = IntendedTime(next_request_);
+      Session* session = sessions_[next_request_ % g_connections].get();
+      ++next_request_;
+      if (!session->conn) {
+        continue;  // lost with its connection, shows as unanswered
+      }
+      send_lag_us_.Record(now - intended);
+      session->intended.push_back(intended);
+      codec_.Send(session->conn, request_);
+    }
+    if (next_request_ < total_requests_) {
+      loop_->RunAt(IntendedTime(next_request_), [this]() { SendDue(); });
+    } else {
+      loop_->RunAfter(kDrainSeconds, [this]() { Finish(); });
+    }
+  }
+
+  void OnResponse(const TcpConnectionPtr& conn) {
+    const int64_t now = TimerQueue::Now();
+    Session* session = sessions_[std::any_cast<int>(conn->GetContext())].get();
+    if (session->intended.empty()) {
+      ++unexpected_;
+      return;
+    }
+    latency_us_.Record(now - session->intended.front());
+    session->intended.pop_front();
+    if (++responses_ == total_requests_) {
+      Finish();
+    }
+  }
+
+  void Finish() {
+    if (finished_) {
+      return;
+    }
+    finished_ = true;
+    const int64_t now = TimerQueue::Now();
+    const double elapsed = static_cast<double>(now - start_) / 1e6;
+    // A request still in flight has waited at least this long; leaving it
+    // out would make a server that stops answering look fast.
+    int64_t in_flight = 0;
+    for (const auto& session : sessions_) {
+      for (int64_t intended : session->intended) {
+        latency_us_.Record(now - intended);
+        ++in_flight;
+      }
+    }
+    printf("load_generator: %s, %.0f req/s target, %d connections, %zu byte messages, %.1f s\n",
+           loop_->PollerName(), g_rate, g_connections, g_message_bytes, g_seconds);
+    printf("sent %lld, answered %lld (%.0f/s over %.2f s), unanswered %lld (%lld in flight), "
+           "unexpected %lld\n",
+           static_cast<long long>(next_request_), static_cast<long long>(responses_),
+           static_cast<double>(responses_) / elapsed, elapsed,
+           static_cast<long long>(next_request_ - responses_),
+           static_cast<long long>(in_flight), static_cast<long long>(unexpected_));
+    printf("send lag (us): p50 %lld, p99 %lld, max %lld\n",
+           static_cast<long long>(send_lag_us_.ValueAtPercentile(50)),
+           static_cast<long long>(send_lag_us_.ValueAtPercentile(99)),
+           static_cast<long long>(send_lag_us_.Max()));
+    // In-flight requests count with their age so far, a lower bound.
+    printf("latency from intended send time (us): p50 %lld, p90 %lld, p99 %lld, p99.9 %lld, "
+           "p99.99 %lld, max %lld\n",
+           static_cast<long long>(latency_us_.ValueAtPercentile(50)),
+           static_cast<long long>(latency_us_.ValueAtPercentile(90)),
+           static_cast<long long>(latency_us_.ValueAtPercentile(99)),
+           static_cast<long long>(latency_us_.ValueAtPercentile(99.9)),
+           static_cast<long long>(latency_us_.ValueAtPercentile(99.99)),
+           static_cast<long long>(latency_us_.Max()));
+    latency_us_.PrintPercentiles(stdout);
+    loop_->Quit();
+  }
+
+ private:
+  EventLoop* loop_;
+  LengthHeaderCodec codec_;
+  const std::string request_;
+  Histogram latency_us_;
+  Histogram send_lag_us_;  // how late the generator itself sent
+  const int64_t total_requests_;
+  int64_t next_request_;
+  int connected_;
+  int64_t responses_;
+  int64_t unexpected_;
+  int64_t start_;
+  bool finished_{false};
+  std::vector<std::unique_ptr<Session>> sessions_;  // last, goes first
+};
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  if (argc > 1) {
+    g_rate = atof(argv[1]);
+  }
+  if (argc > 2) {
+    g_connections = atoi(argv[2]);
+  }
+  if (argc > 3) {
+    g_seconds = atof(argv[3]);
+  }
+  if (argc > 4) {
+    g_message_bytes = static_cast<size_t>(atol(argv[4]));
+  }
+  if (g_rate <= 0 || g_connections <= 0) {
+    fprintf(stderr, "usage: %s [rate] [connections] [seconds] [message_bytes] [ip port]\n",
+            argv[0]);
+    return 1;
+  }
+
+  pid_t pid = 0;
+  std::unique_ptr<InetAddress> server_addr;
+  if (argc > 6) {
+    server_addr.reset(new InetAddress(argv[5], static_cast<uint16_t>(atoi(argv[6]))));
+  } else {
+    int port_fds[2];
+    if (::pipe(port_fds) < 0) {
+      perror("pipe");
+      return 1;
+    }
+    pid = ::fork();
+    if (pid == 0) {
+      ::close(port_fds[0]);
+      RunEchoServer(port_fds[1]);
+    }
+    ::close(port_fds[1]);
+    uint16_t port = 0;
+    if (::read(port_fds[0], &port, sizeof(port)) != sizeof(port)) {
+      fprintf(stderr, "server did not start\n");
+      return 1;
+    }
+    ::close(port_fds[0]);
+    server_addr.reset(new InetAddress("127.0.0.1", port));
+  }
+
+  EventLoop loop;
+  LoadGenerator generator(&loop, *server_addr);
+  generator.Start();
+  loop.Loop();
+
+  if (pid > 0) {
+    ::kill(pid, SIGTERM);
+    ::waitpid(pid, nullptr, 0);
+  }
+  return 0;
+}
@@ -0,0 +1,843 @@
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "buffer.h"
+#include "coroutine.h"
+#include "event_loop.h"
+#include "inet_address.h"
+#include "length_header_codec.h"
+#include "prefork_server.h"
+#include "rpc_channel.h"
+#include "rpc_server.h"
+#include "sockets_ops.h"
+#include "splicer.h"
+#include "stats_server.h"
+#include "tcp_client.h"
+#include "tcp_connection.h"
+#include "tcp_server.h"
+#include "timer_queue.h"
+
+using mymuduo::net::AsyncSocket;
+using mymuduo::net::Buffer;
+using mymuduo::net::EventLoop;
+using mymuduo::net::InetAddress;
+using mymuduo::net::LengthHeaderCodec;
+using mymuduo::net::PreforkServer;
+using mymuduo::net::RpcChannel;
+using mymuduo::net::RpcServer;
+using mymuduo::net::RpcStatus;
+using mymuduo::net::StatsServer;
+using mymuduo::net::Task;
+using mymuduo::net::TcpClient;
+using mymuduo::net::TcpConnectionPtr;
+using mymuduo::net::TcpServer;
+using mymuduo::net::TimerQueue;
+
+namespace {
+
+// Blocking client socket, for the tests only.
+int ConnectTo(const InetAddress& server_addr) {
+  int sockfd = ::socket(AF_INET, SOCK_STREAM, 0);
+  if (::connect(sockfd, server_addr.GetSockAddr(), sizeof(struct sockaddr_in)) < 0) {
+    perror("connect");
+    ::close(sockfd);
+    return -1;
+  }
+  return sockfd;
+}
+
+std::string ReadAll(int sockfd) {
+  std::string received;
+  char buf[65536];
+  ssize_t n = 0;
+  while ((n = ::read(sockfd, buf, sizeof(buf))) > 0) {
+    received.append(buf, n);
+  }
+  return received;
+}
+
+}  // namespace
+
+namespace test_echo {
+
+InetAddress g_server_addr;
+
+void* ClientRoutine(void* arg) {
+  int sockfd = ConnectTo(g_server_addr);
+  const char* messages[] = {"hello", "mymuduo", "bye"};
+  for (const char* message : messages) {
+    char buf[64] = "";
+    ::write(sockfd, message, strlen(message));
+    ssize_t n = ::read(sockfd, buf, sizeof(buf) - 1);
+    printf("client sent %s, got %.*s\n", message, static_cast<int>(n), buf);
+  }
+  ::close(sockfd);
+  (void) arg;
+  return nullptr;
+}
+
+}  // namespace test_echo
+
+void TEST_echo() {
+  EventLoop loop;
+  TcpServer server(&loop, InetAddress(0, true), "echo");
+  server.SetConnectionCallback([&loop](const TcpConnectionPtr& conn) {
+    mymuduo::net::DefaultConnectionCallback(conn);
+    if (conn->Disconnected()) {
+      loop.Quit();
+    }
+  });
+  server.SetMessageCallback([](const TcpConnectionPtr& conn, Buffer* buffer) {
+    conn->Send(buffer);
+  });
+  server.Start();
+  test_echo::g_server_addr = server.listen_address();
+
+  pthread_t client;
+  MCHECK(pthread_create(&client, nullptr, test_echo::ClientRoutine, nullptr));
+  loop.Loop();
+  MCHECK(pthread_join(client, nullptr));
+}
+
+namespace test_exclusive_accept {
+
+InetAddress g_server_addr;
+
+void* ClientRoutine(void* arg) {
+  int sockfd = ConnectTo(g_server_addr);
+  ReadAll(sockfd);
+  ::close(sockfd);
+  (void) arg;
+  return nullptr;
+}
+
+}  // namespace test_exclusive_accept
+
+// The listening channel is added with EPOLLEXCLUSIVE, which only takes
+// EPOLLIN, EPOLLOUT, EPOLLWAKEUP and EPOLLET.
+void TEST_exclusive_accept() {
+  EventLoop loop;
+  TcpServer server(&loop, InetAddress(0, true), "exclusive");
+  server.SetExclusiveAccept(true);
+  int accepted = 0;
+  server.SetConnectionCallback([&loop, &accepted](const TcpConnectionPtr& conn) {
+    if (conn->Connected()) {
+      ++accepted;
+      conn->Shutdown();
+    } else {
+      loop.Quit();
+    }
+  });
+  server.Start();
+  test_exclusive_accept::g_server_addr = server.listen_address();
+
+  pthread_t client;
+  MCHECK(pthread_create(&client, nullptr, test_exclusive_accept::ClientRoutine, nullptr));
+  loop.Loop();
+  MCHECK(pthread_join(client, nullptr));
+  printf("exclusive accept: accepted %d\n", accepted);
+}
+
+// The server goes away with a connection it has shut down but the peer
+// has not closed yet.
+void TEST_destroy_disconnecting() {
+  EventLoop loop;
+  int sockfd = -1;
+  bool disconnected = false;
+  {
+    TcpServer server(&loop, InetAddress(0, true), "disconnecting");
+    server.SetConnectionCallback([&loop, &disconnected](const TcpConnectionPtr& conn) {
+      if (conn->Connected()) {
+        conn->Shutdown();
+        loop.Quit();
+      } else {
+        disconnected = true;
+      }
+    });
+    server.Start();
+    sockfd = ConnectTo(server.listen_address());
+    loop.Loop();
+  }
+  ReadAll(sockfd);
+  ::close(sockfd);
+  printf("destroy disconnecting: disconnected %s\n", disconnected ? "yes" : "no");
+}
+
+namespace test_backpressure {
+
+constexpr size_t kTotalBytes = 32 * 1024 * 1024;
+constexpr size_t kChunkBytes = 64 * 1024;
+constexpr size_t kHighWaterMark = 1024 * 1024;
+constexpr size_t kLowWaterMark = 256 * 1024;
+
+InetAddress g_server_addr;
+size_t g_sent = 0;
+size_t g_peak_buffered = 0;
+int g_high_hits = 0;
+bool g_paused = false;
+
+// Produces until the connection pushes back.
+void Produce(const TcpConnectionPtr& conn) {
+  static const std::string chunk(kChunkBytes, 'x');
+  while (!g_paused && g_sent < kTotalBytes) {
+    conn->Send(chunk);
+    g_sent += chunk.size();
+    g_peak_buffered = std::max(g_peak_buffered, conn->output_buffer()->ReadableBytes());
+  }
+  if (g_sent >= kTotalBytes) {
+    conn->Shutdown();
+  }
+}
+
+// A slow consumer.
+void* ClientRoutine(void* arg) {
+  int sockfd = ConnectTo(g_server_addr);
+  char buf[kChunkBytes];
+  size_t received = 0;
+  ssize_t n = 0;
+  while ((n = ::read(sockfd, buf, sizeof(buf))) > 0) {
+    received += n;
+    ::usleep(100);
+  }
+  printf("client received %zu bytes\n", received);
+  ::close(sockfd);
+  (void) arg;
+  return nullptr;
+}
+
+}  // namespace test_backpressure
+
+void TEST_backpressure() {
+  using namespace test_backpressure;
+
+  EventLoop loop;
+  TcpServer server(&loop, InetAddress(0, true), "producer");
+  server.SetConnectionCallback([&loop](const TcpConnectionPtr& conn) {
+    if (conn->Connected()) {
+      conn->SetHighWaterMarkCallback([](const TcpConnectionPtr&, size_t buffered) {
+        ++g_high_hits;
+        g_paused = true;
+        g_peak_buffered = std::max(g_peak_buffered, buffered);
+      }, kHighWaterMark);
+      conn->SetLowWaterMarkCallback([](const TcpConnectionPtr& conn, size_t) {
+        g_paused = false;
+        Produce(conn);
+      }, kLowWaterMark);
+      Produce(conn);
+    } else {
+      loop.Quit();
+    }
+  });
+  server.Start();
+  g_server_addr = server.listen_address();
+
+  pthread_t client;
+  MCHECK(pthread_create(&client, nullptr, ClientRoutine, nullptr));
+  loop.Loop();
+  MCHECK(pthread_join(client, nullptr));
+  printf("server sent %zu bytes, high water hits %d, peak output buffer %zu KiB "
+         "(high water mark %zu KiB)\n",
+         g_sent, g_high_hits, g_peak_buffered / 1024, kHighWaterMark / 1024);
+}
+
+namespace test_sendfile {
+
+InetAddress g_server_addr;
+std::string g_received;
+
+void* ClientRoutine(void* arg) {
+  int sockfd = ConnectTo(g_server_addr);
+  g_received = ReadAll(sockfd);
+  ::close(sockfd);
+  (void) arg;
+  return nullptr;
+}
+
+}  // namespace test_sendfile
+
+void TEST_sendfile() {
+  using namespace test_sendfile;
+
+  std::string content;
+  for (int i = 0; i < 200000; ++i) {
+    content += static_cast<char>('a' + i % 26);
+  }
+  char path[] = "/tmp/mymuduo_sendfile_XXXXXX";
+  int file_fd = ::mkstemp(path);
+  ::unlink(path);
+  ::write(file_fd, content.data(), content.size());
+  // A pipe does not support sendfile, it goes through the buffered fallback.
+  int pipe_fds[2];
+  MCHECK(::pipe(pipe_fds));
+  ::write(pipe_fds[1], "piped", 5);
+  ::close(pipe_fds[1]);
+
+  EventLoop loop;
+  TcpServer server(&loop, InetAddress(0, true), "sendfile");
+  server.SetConnectionCallback([&](const TcpConnectionPtr& conn) {
+    if (conn->Connected()) {
+      conn->Send("header;");
+      conn->SendFile(file_fd, 100, content.size() - 100);
+      conn->Send(";middle;");
+      conn->SendFile(pipe_fds[0], 0, 5);
+      conn->Send(";trailer");
+      conn->Shutdown();
+      ::close(pipe_fds[0]);  // SendFile keeps a dup when it has to
+    } else {
+      loop.Quit();
+    }
+  });
+  server.Start();
+  g_server_addr = server.listen_address();
+
+  pthread_t client;
+  MCHECK(pthread_create(&client, nullptr, ClientRoutine, nullptr));
+  loop.Loop();
+  MCHECK(pthread_join(client, nullptr));
+  ::close(file_fd);
+
+  std::string expected = "header;" + content.substr(100) + ";middle;piped;trailer";
+  printf("sendfile received %zu bytes, %s\n", g_received.size(),
+         g_received == expected ? "in order" : "MISMATCH");
+}
+
+void TEST_splice() {
+  int from_fds[2];
+  int to_fds[2];
+  MCHECK(::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, from_fds));
+  MCHECK(::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, to_fds));
+
+  mymuduo::net::Splicer splicer;
+  const std::string message = "spliced from one socket into another";
+  ::write(from_fds[0], message.data(), message.size());
+  ::close(from_fds[0]);
+
+  ssize_t pulled = 0;
+  size_t total = 0;
+  while ((pulled = splicer.Pull(from_fds[1])) > 0) {
+    total += pulled;
+    splicer.Push(to_fds[0]);
+  }
+  ::close(to_fds[0]);
+  std::string received = ReadAll(to_fds[1]);
+  printf("splice moved %zu bytes, pending %zu, got \"%s\"\n",
+         total, splicer.pending(), received.c_str());
+  ::close(from_fds[1]);
+  ::close(to_fds[1]);
+}
+
+namespace test_edge_triggered {
+
+constexpr size_t kStreamBytes = 8 * 1024 * 1024;
+constexpr int kPingNum = 200;
+
+InetAddress g_server_addr;
+double g_max_ping_us = 0;
+
+double NowMicroseconds() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<double>(ts.tv_sec) * 1e6 + static_cast<double>(ts.tv_nsec) / 1e3;
+}
+
+void* StreamRoutine(void* arg) {
+  int sockfd = ConnectTo(g_server_addr);
+  std::string chunk(64 * 1024, 's');
+  for (size_t sent = 0; sent < kStreamBytes; sent += chunk.size()) {
+    ::write(sockfd, chunk.data(), chunk.size());
+  }
+  ::close(sockfd);
+  (void) arg;
+  return nullptr;
+}
+
+void* PingRoutine(void* arg) {
+  int sockfd = ConnectTo(g_server_addr);
+  for (int i = 0; i < kPingNum; ++i) {
+    char buf[8];
+    double start = NowMicroseconds();
+    ::write(sockfd, "ping", 4);
+    ::read(sockfd, buf, sizeof(buf));
+    g_max_ping_us = std::max(g_max_ping_us, NowMicroseconds() - start);
+  }
+  ::close(sockfd);
+  (void) arg;
+  return nullptr;
+}
+
+}  // namespace test_edge_triggered
+
+void TEST_edge_triggered() {
+  using namespace test_edge_triggered;
+
+  EventLoop loop;
+  TcpServer server(&loop, InetAddress(0, true), "edge");
+  server.SetEdgeTriggered(16 * 1024);
+  size_t streamed = 0;
+  int pings = 0;
+  int connections = 0;
+  server.SetConnectionCallback([&](const TcpConnectionPtr& conn) {
+    if (conn->Connected()) {
+      ++connections;
+    } else if (--connections == 0) {
+      loop.Quit();
+    }
+  });
+  server.SetMessageCallback([&](const TcpConnectionPtr& conn, Buffer* buffer) {
+    if (buffer->ToStringView().substr(0, 4) == "ping") {
+      pings += static_cast<int>(buffer->ReadableBytes() / 4);
+      conn->Send(buffer);
+    } else {
+      streamed += buffer->ReadableBytes();
+      buffer->RetrieveAll();
+    }
+  });
+  server.Start();
+  g_server_addr = server.listen_address();
+
+  pthread_t streamer;
+  pthread_t pinger;
+  MCHECK(pthread_create(&streamer, nullptr, StreamRoutine, nullptr));
+  MCHECK(pthread_create(&pinger, nullptr, PingRoutine, nullptr));
+  loop.Loop();
+  MCHECK(pthread_join(streamer, nullptr));
+  MCHECK(pthread_join(pinger, nullptr));
+  printf("edge triggered: streamed %zu bytes, %d pings, max ping %.0f us, %lld iterations\n",
+         streamed, pings, g_max_ping_us, static_cast<long long>(loop.iteration()));
+}
+
+namespace test_codec {
+
+InetAddress g_server_addr;
+
+void WriteFrame(int sockfd, const std::string& message) {
+  Buffer frame;
+  frame.Append(message);
+  LengthHeaderCodec::Encode(&frame);
+  ::write(sockfd, frame.Peek(), frame.ReadableBytes());
+}
+
+std::string ReadFrame(int sockfd) {
+  char header[LengthHeaderCodec::kHeaderLen];
+  if (::recv(sockfd, header, sizeof(header), MSG_WAITALL) != sizeof(header)) {
+    return "<closed>";
+  }
+  Buffer buffer;
+  buffer.Append(header, sizeof(header));
+  std::string message(buffer.ReadInt32(), '\0');
+  if (!message.empty()) {
+    ::recv(sockfd, &message[0], message.size(), MSG_WAITALL);
+  }
+  return message;
+}
+
+void* ClientRoutine(void* arg) {
+  int sockfd = ConnectTo(g_server_addr);
+  // A frame trickling in a byte at a time.
+  Buffer frame;
+  frame.Append("trickled");
+  LengthHeaderCodec::Encode(&frame);
+  for (size_t i = 0; i < frame.ReadableBytes(); ++i) {
+    ::write(sockfd, frame.Peek() + i, 1);
+    ::usleep(1000);
+  }
+  printf("codec got \"%s\"\n", ReadFrame(sockfd).c_str());
+  // Several frames in one write, an empty one among them.
+  Buffer frames;
+  for (const char* message : {"one", "", "three"}) {
+    Buffer buffer;
+    buffer.Append(message, strlen(message));
+    LengthHeaderCodec::Encode(&buffer);
+    frames.Append(buffer.Peek(), buffer.ReadableBytes());
+  }
+  ::write(sockfd, frames.Peek(), frames.ReadableBytes());
+  for (int i = 0; i < 3; ++i) {
+    printf("codec got \"%s\"\n", ReadFrame(sockfd).c_str());
+  }
+  // A large frame, and then garbage the server must hang up on.
+  const std::string large(1024 * 1024, 'L');
+  WriteFrame(sockfd, large);
+  printf("codec echoed %s\n", ReadFrame(sockfd) == large ? "1MiB frame" : "MISMATCH");
+  Buffer garbage;
+  garbage.AppendInt32(-1);
+  ::write(sockfd, garbage.Peek(), garbage.ReadableBytes());
+  printf("codec after invalid header: %s\n", ReadFrame(sockfd).c_str());
+  ::close(sockfd);
+  (void) arg;
+  return nullptr;
+}
+
+}  // namespace test_codec
+
+void TEST_codec() {
+  using namespace test_codec;
+
+  EventLoop loop;
+  TcpServer server(&loop, InetAddress(0, true), "codec");
+  LengthHeaderCodec codec([&codec](const TcpConnectionPtr& conn, std::string_view message) {
+    codec.Send(conn, message);
+  });
+  server.SetConnectionCallback([&loop](const TcpConnectionPtr& conn) {
+    if (conn->Disconnected()) {
+      // After the queued ConnectDestroyed, which closes the socket the
+      // client is blocked on.
+      loop.QueueInLoop([&loop]() { loop.Quit(); });
+    }
+  });
+  server.SetMessageCallback([&codec](const TcpConnectionPtr& conn, Buffer* buffer) {
+    codec.OnMessage(conn, buffer);
+  });
+  server.Start();
+  g_server_addr = server.listen_address();
+
+  pthread_t client;
+  MCHECK(pthread_create(&client, nullptr, ClientRoutine, nullptr));
+  loop.Loop();
+  MCHECK(pthread_join(client, nullptr));
+
+  Buffer buffer;
+  buffer.AppendInt64(-2);
+  buffer.AppendInt16(0x1234);
+  buffer.PrependInt32(7);
+  const int32_t a = buffer.ReadInt32();
+  const int64_t b = buffer.ReadInt64();
+  const int16_t c = buffer.ReadInt16();
+  printf("buffer ints %d %lld %#x\n", a, static_cast<long long>(b), c);
+}
+
+void TEST_rpc() {
+  EventLoop loop;
+  RpcServer server(&loop, InetAddress(0, true), "rpc");
+  server.RegisterMethod("echo", [](std::string_view request, const RpcServer::Done& done) {
+    done(request);
+  });
+  // Answers after the given milliseconds, so later calls overtake it.
+  server.RegisterMethod("delay", [&loop](std::string_view request, const RpcServer::Done& done) {
+    const std::string ms(request);
+    loop.RunAfter(atoi(ms.c_str()) / 1000.0, [done, ms]() { done(ms); });
+  });
+  server.Start();
+
+  TcpClient client(&loop, server.listen_address(), "rpc-client");
+  std::unique_ptr<RpcChannel> channel;
+  std::vector<std::string> completions;
+  auto record = [&](const std::string& call) {
+    return [&, call](RpcStatus status, std::string_view response) {
+      completions.push_back(call + " -> " + mymuduo::net::RpcStatusName(status) +
+                            (response.empty() ? "" : " " + std::string(response)));
+      if (completions.size() == 5) {
+        client.Disconnect();
+      }
+    };
+  };
+  client.SetConnectionCallback([&](const TcpConnectionPtr& conn) {
+    if (conn->Connected()) {
+      channel.reset(new RpcChannel(conn));
+      channel->Call("delay", "30", record("delay 30"));
+      channel->Call("echo", "first", record("echo first"));
+      channel->Call("delay", "500", record("delay 500, 50ms timeout"), 0.05);
+      channel->Call("nope", "", record("nope"));
+      channel->Call("echo", "second", record("echo second"));
+    } else {
+      channel->HandleDisconnected();
+      channel.reset();
+      loop.Quit();
+    }
+  });
+  client.Connect();
+  loop.Loop();
+
+  for (const std::string& completion : completions) {
+    printf("rpc %s\n", completion.c_str());
+  }
+}
+
+void TEST_rpc_compute() {
+  EventLoop loop;
+  RpcServer server(&loop, InetAddress(0, true), "rpc-compute");
+  // Answers from a compute thread; the responses come back in batches.
+  server.RegisterMethod("where", [&loop](std::string_view, const RpcServer::Done& done) {
+    done(loop.IsInLoopThread() ? "loop" : "pool");
+  });
+  server.SetComputeThreadNum(2);
+  server.Start();
+
+  TcpClient client(&loop, server.listen_address(), "rpc-compute-client");
+  std::unique_ptr<RpcChannel> channel;
+  int on_pool = 0;
+  int done = 0;
+  client.SetConnectionCallback([&](const TcpConnectionPtr& conn) {
+    if (conn->Connected()) {
+      channel.reset(new RpcChannel(conn));
+      for (int i = 0; i < 20; ++i) {
+        channel->Call("where", "", [&](RpcStatus status, std::string_view response) {
+          on_pool += status == mymuduo::net::kRpcOk && response == "pool";
+          if (++done == 20) {
+            client.Disconnect();
+          }
+        });
+      }
+    } else {
+      channel->HandleDisconnected();
+      channel.reset();
+      loop.Quit();
+    }
+  });
+  client.Connect();
+  loop.Loop();
+  printf("rpc compute pool: %d of %d calls ran on the pool\n", on_pool, done);
+}
+
+namespace test_prefork {
+
+// Asks whoever accepted the connection for its pid.
+pid_t WorkerPid(const InetAddress& server_addr) {
+  int sockfd = ConnectTo(server_addr);
+  char buf[32] = {0};
+  ::write(sockfd, "?", 1);
+  ssize_t n = ::read(sockfd, buf, sizeof(buf) - 1);
+  ::close(sockfd);
+  return n > 0 ? atoi(buf) : -1;
+}
+
+}  // namespace test_prefork
+
+void TEST_prefork() {
+  using namespace test_prefork;
+
+  const PreforkServer::Mode modes[] = {PreforkServer::kSharedListener, PreforkServer::kReusePort};
+  for (PreforkServer::Mode mode : modes) {
+    const char* mode_name =
+        mode == PreforkServer::kSharedListener ? "shared listener" : "reuseport";
+    int port_fds[2];
+    MCHECK(::pipe(port_fds));
+    pid_t master = ::fork();
+    if (master == 0) {
+      ::close(port_fds[0]);
+      PreforkServer server(InetAddress(0, true), "prefork", mode, 2);
+      server.SetWorkerInitCallback([](EventLoop*, TcpServer* worker, int) {
+        worker->SetMessageCallback([](const TcpConnectionPtr& conn, Buffer* buffer) {
+          buffer->RetrieveAll();
+          conn->Send(std::to_string(::getpid()));
+        });
+      });
+      const uint16_t port = server.listen_address().Port();
+      ::write(port_fds[1], &port, sizeof(port));
+      ::close(port_fds[1]);
+      server.Run();
+      _exit(0);
+    }
+    ::close(port_fds[1]);
+    uint16_t port = 0;
+    ::read(port_fds[0], &port, sizeof(port));
+    ::close(port_fds[0]);
+    ::usleep(100 * 1000);  // the workers are listening
+    const InetAddress server_addr("127.0.0.1", port);
+
+    const pid_t first = WorkerPid(server_addr);
+    printf("prefork %s: served by a worker: %s\n", mode_name, first > 0 ? "yes" : "no");
+    ::kill(first, SIGKILL);
+    ::usleep(100 * 1000);
+    bool served = true;
+    for (int i = 0; i < 4; ++i) {
+      const pid_t pid = WorkerPid(server_addr);
+      served = served && pid > 0 && pid != first;
+    }
+    printf("prefork %s: served after a worker died: %s\n", mode_name, served ? "yes" : "no");
+
+    // Most likely while the master pauses before restarting the dead worker.
+    const int64_t stop_begin = TimerQueue::Now();
+    ::kill(master, SIGTERM);
+    int status = 0;
+    ::waitpid(master, &status, 0);
+    printf("prefork %s: master exited: %d, within 0.5s: %s\n", mode_name,
+           WIFEXITED(status) ? WEXITSTATUS(status) : -1,
+           TimerQueue::Now() - stop_begin < 500 * 1000 ? "yes" : "no");
+  }
+}
+
+namespace test_coroutine {
+
+Task<ssize_t> EchoOnce(AsyncSocket* socket, char* buf, size_t len) {
+  ssize_t n = co_await socket->AsyncRead(buf, len);
+  if (n > 0) {
+    ssize_t written = co_await socket->AsyncWrite(buf, n);
+    if (written < 0) {
+      co_return written;
+    }
+  }
+  co_return n;
+}
+
+Task<> Server(AsyncSocket* listener, int* requests) {
+  AsyncSocket socket(listener->loop(), static_cast<int>(co_await listener->AsyncAccept()));
+  std::vector<char> buf(4096);
+  while (co_await EchoOnce(&socket, buf.data(), buf.size()) > 0) {
+    ++*requests;
+  }
+}
+
+Task<> Send(AsyncSocket* socket, const std::string* message) {
+  co_await socket->AsyncWrite(message->data(), message->size());
+  ::shutdown(socket->fd(), SHUT_WR);
+}
+
+Task<std::string> ReceiveAll(AsyncSocket* socket) {
+  std::string received;
+  char buf[65536];
+  ssize_t n = 0;
+  while ((n = co_await socket->AsyncRead(buf, sizeof(buf))) > 0) {
+    received.append(buf, n);
+  }
+  co_return received;
+}
+
+// More than the socket buffers hold: the writer suspends while the
+// reader, waiting on the same socket, drains the echo.
+Task<> Client(EventLoop* loop, InetAddress server_addr, std::string* received) {
+  co_await mymuduo::net::Sleep(0.01);
+  AsyncSocket socket(loop, ConnectTo(server_addr));
+  std::string message(4 * 1024 * 1024, 'c');
+  mymuduo::net::Spawn(Send(&socket, &message));
+  *received = co_await ReceiveAll(&socket);
+  loop->Quit();
+}
+
+}  // namespace test_coroutine
+
+void TEST_coroutine() {
+  using namespace test_coroutine;
+  namespace sockets = mymuduo::net::sockets;
+
+  void* frame = mymuduo::net::FramePool::Allocate(200);
+  mymuduo::net::FramePool::Deallocate(frame, 200);
+  printf("coroutine frame reused: %s\n",
+         mymuduo::net::FramePool::Allocate(256) == frame ? "yes" : "no");
+  mymuduo::net::FramePool::Deallocate(frame, 256);
+
+  EventLoop loop;
+  const int listen_fd = sockets::CreateNonblockingOrDie();
+  sockets::BindOrDie(listen_fd, InetAddress(0, true).GetSockAddr());
+  sockets::ListenOrDie(listen_fd);
+  const InetAddress server_addr("127.0.0.1", InetAddress(sockets::GetLocalAddr(listen_fd)).Port());
+  int requests = 0;
+  std::string received;
+  {
+    AsyncSocket listener(&loop, listen_fd);
+    mymuduo::net::Spawn(Server(&listener, &requests));
+    mymuduo::net::Spawn(Client(&loop, server_addr, &received));
+    loop.Loop();
+  }
+  const bool intact = received.size() == 4u * 1024 * 1024 &&
+                      std::count(received.begin(), received.end(), 'c') == 4 * 1024 * 1024;
+  printf("coroutine echo over %s: %zu bytes back intact: %s, in %s requests\n", loop.PollerName(),
+         received.size(), intact ? "yes" : "no", requests > 1 ? "several" : "one");
+}
+
+namespace test_stats_server {
+
+struct Request {
+  EventLoop* loop;
+  InetAddress server_addr;
+  std::vector<std::string> responses;
+};
+
+void* ClientRoutine(void* arg) {
+  Request* request = static_cast<Request*>(arg);
+  const char* paths[] = {"/stats", "/stats.json", "/nope"};
+  for (const char* path : paths) {
+    int sockfd = ConnectTo(request->server_addr);
+    std::string get = std::string("GET ") + path + " HTTP/1.1\r\nHost: localhost\r\n\r\n";
+    ::write(sockfd, get.data(), get.size());
+    request->responses.push_back(ReadAll(sockfd));
+    ::close(sockfd);
+  }
+  request->loop->Quit();
+  return nullptr;
+}
+
+std::vector<int> g_loop_tids;
+
+void* LoopRoutine(void*) {
+  g_loop_tids.push_back(mymuduo::CurrentThread::Tid());
+  EventLoop loop;
+  loop.QueueInLoop([&loop]() { loop.Quit(); });
+  loop.Wakeup();
+  loop.Loop();
+  return nullptr;
+}
+
+}  // namespace test_stats_server
+
+void TEST_stats_server() {
+  using namespace test_stats_server;
+
+  // A loop per thread, with two histograms each: more histograms than
+  // there are pthread keys.
+  for (int i = 0; i < 600; ++i) {
+    pthread_t thread;
+    pthread_create(&thread, nullptr, LoopRoutine, nullptr);
+    pthread_join(thread, nullptr);
+  }
+
+  EventLoop loop;
+  StatsServer server(&loop, 0);
+  server.Start();
+  Request request{&loop, server.listen_address(), {}};
+  pthread_t client;
+  pthread_create(&client, nullptr, ClientRoutine, &request);
+  loop.Loop();
+  pthread_join(client, nullptr);
+
+  for (const std::string& response : request.responses) {
+    printf("stats server: %s", response.substr(0, response.find('\n') + 1).c_str());
+  }
+  const std::string& text = request.responses.at(0);
+  const auto has_series = [&text](const char* name, int tid) {
+    return text.find(std::string(name) + "{tid=" + std::to_string(tid) + "}") != std::string::npos;
+  };
+  bool one_per_loop = true;
+  for (int tid : g_loop_tids) {
+    one_per_loop = one_per_loop && has_series("event_loop.busy_ns", tid) &&
+                   has_series("event_loop.queue_lock_wait_ns", tid);
+  }
+  const int tid = mymuduo::CurrentThread::Tid();
+  printf("stats server: has event_loop.busy_ns: %s, one per loop: %s, pending functors: %s, "
+         "has the rpc compute pool: %s, json: %s\n",
+         has_series("event_loop.busy_ns", tid) ? "yes" : "no", one_per_loop ? "yes" : "no",
+         has_series("event_loop.pending_functors", tid) ? "yes" : "no",
+         text.find("thread_pool.rpc-compute-compute.tasks") != std::string::npos ? "yes" : "no",
+         request.responses.at(1).find("{\"counters\": {") != std::string::npos ? "yes" : "no");
+}
+
+int main(void) {
+  TEST_echo();
+  TEST_exclusive_accept();
+  TEST_destroy_disconnecting();
+  TEST_backpressure();
+  TEST_sendfile();
+  TEST_splice();
+  TEST_edge_triggered();
+  TEST_codec();
+  TEST_rpc();
+  TEST_rpc_compute();
+  TEST_prefork();
+  TEST_coroutine();
+  TEST_stats_server();
+
+  return 0;
+}
@@ -0,0 +1,401 @@
+#include <arpa/inet.h>
+#include <dirent.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include "buffer.h"
+#include "event_loop.h"
+#include "inet_address.h"
+#include "prefork_server.h"
+#include "tcp_connection.h"
+#include "tcp_server.h"
+
+// Ping-pong over loopback against one echo server per model of README 6.6.2:
+// iterative, thread per connection, prethreaded accept, the reactor of this
+// library and a prefork of reactors. The server of each model runs in a
+// forked child; a client with several threads, each driving its share of the
+// connections with epoll, keeps one message in flight per connection and
+// reports how many connections got served at all, messages/s, MiB/s, and the
+// CPU seconds the server and the client spent per second.
+// usage: pingpong_benchmark [connections] [client_threads] [message_bytes] [seconds]
+
+using mymuduo::net::Buffer;
+using mymuduo::net::EventLoop;
+using mymuduo::net::InetAddress;
+using mymuduo::net::PreforkServer;
+using mymuduo::net::TcpConnectionPtr;
+using mymuduo::net::TcpServer;
+
+namespace {
+
+int g_connections = 16;
+int g_client_threads = 4;
+size_t g_message_bytes = 4096;
+double g_seconds = 2;
+const int kPrethreadNum = 8;
+
+double NowSeconds() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<double>(ts.tv_sec) + static_cast<double>(ts.tv_nsec) / 1e9;
+}
+
+// utime + stime of a process, every thread included; sets *ppid.
+double ProcessCpuSeconds(pid_t pid, pid_t* ppid) {
+  char path[64];
+  snprintf(path, sizeof(path), "/proc/%d/stat", static_cast<int>(pid));
+  FILE* fp = fopen(path, "r");
+  if (!fp) {
+    return 0;
+  }
+  int parent = 0;
+  unsigned long utime = 0;
+  unsigned long stime = 0;
+  int n = fscanf(fp, "%*d %*s %*c %d %*d %*d %*d %*d %*u %*u %*u %*u %*u %lu %lu", &parent,
+                 &utime, &stime);
+  fclose(fp);
+  *ppid = parent;
+  return n == 3 ? static_cast<double>(utime + stime) / sysconf(_SC_CLK_TCK) : 0;
+}
+
+// CPU seconds of a process and of its children, the prefork workers.
+double CpuSeconds(pid_t pid) {
+  pid_t ppid = 0;
+  double total = ProcessCpuSeconds(pid, &ppid);
+  DIR* dir = ::opendir("/proc");
+  while (struct dirent* entry = ::readdir(dir)) {
+    const pid_t child = atoi(entry->d_name);
+    if (child <= 0 || child == pid) {
+      continue;
+    }
+    const double seconds = ProcessCpuSeconds(child, &ppid);
+    if (ppid == pid) {
+      total += seconds;
+    }
+  }
+  ::closedir(dir);
+  return total;
+}
+
+// Blocking listener on an ephemeral loopback port, reported on port_fd.
+int Listen(int port_fd) {
+  int listenfd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  InetAddress addr(0, true);
+  if (::bind(listenfd, addr.GetSockAddr(), sizeof(struct sockaddr_in)) < 0 ||
+      ::listen(listenfd, SOMAXCONN) < 0) {
+    perror("Listen");
+    exit(1);
+  }
+  struct sockaddr_in local;
+  socklen_t len = sizeof(local);
+  ::getsockname(listenfd, reinterpret_cast<struct sockaddr*>(&local), &len);
+  const uint16_t port = ntohs(local.sin_port);
+  ::write(port_fd, &port, sizeof(port));
+  ::close(port_fd);
+  return listenfd;
+}
+
+// Echoes until the peer closes.
+void ServeBlocking(int connfd) {
+  int one = 1;
+  ::setsockopt(connfd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+  char buf[65536];
+  ssize_t n = 0;
+  while ((n = ::read(connfd, buf, sizeof(buf))) > 0) {
+    for (ssize_t written = 0; written < n;) {
+      ssize_t m = ::write(connfd, buf + written, n - written);
+      if (m <= 0) {
+        ::close(connfd);
+        return;
+      }
+      written += m;
+    }
+  }
+  ::close(connfd);
+}
+
+void AcceptLoop(int listenfd) {
+  for (;;) {
+    int connfd = ::accept(listenfd, nullptr, nullptr);
+    if (connfd >= 0) {
+      ServeBlocking(connfd);
+    }
+  }
+}
+
+// One connection after another, no concurrency at all.
+void RunIterative(int port_fd) { AcceptLoop(Listen(port_fd)); }
+
+void* ConnectionRoutine(void* arg) {
+  ServeBlocking(static_cast<int>(reinterpret_cast<intptr_t>(arg)));
+  return nullptr;
+}
+
+// A new thread per accepted connection.
+void RunThreadPerConnection(int port_fd) {
+  const int listenfd = Listen(port_fd);
+  for (;;) {
+    int connfd = ::accept(listenfd, nullptr, nullptr);
+    if (connfd < 0) {
+      continue;
+    }
+    pthread_t thread;
+    if (pthread_create(&thread, nullptr, ConnectionRoutine,
+                       reinterpret_cast<void*>(static_cast<intptr_t>(connfd))) != 0) {
+      ::close(connfd);
+      continue;
+    }
+    pthread_detach(thread);
+  }
+}
+
+void* AcceptRoutine(void* arg) {
+  AcceptLoop(static_cast<int>(reinterpret_cast<intptr_t>(arg)));
+  return nullptr;
+}
+
+// kPrethreadNum threads started up front, each blocked in accept on the
+// shared listener and serving what it gets. More connections than threads
+// wait for a thread to free up.
+void RunPrethread(int port_fd) {
+  const int listenfd = Listen(port_fd);
+  for (int i = 1; i < kPrethreadNum; ++i) {
+    pthread_t thread;
+    pthread_create(&thread, nullptr, AcceptRoutine,
+                   reinterpret_cast<void*>(static_cast<intptr_t>(listenfd)));
+  }
+  AcceptLoop(listenfd);
+}
+
+// Non-blocking IO and IO multiplexing in a single loop.
+void RunReactor(int port_fd) {
+  EventLoop loop;
+  TcpServer server(&loop, InetAddress(0, true), "pingpong");
+  server.SetConnectionCallback([](const TcpConnectionPtr& conn) {
+    if (conn->Connected()) {
+      conn->SetTcpNoDelay(true);
+    }
+  });
+  server.SetMessageCallback([](const TcpConnectionPtr& conn, Buffer* buffer) {
+    conn->Send(buffer);
+  });
+  server.Start();
+  const uint16_t port = server.listen_address().Port();
+  ::write(port_fd, &port, sizeof(port));
+  ::close(port_fd);
+  loop.Loop();
+}
+
+// 方案4: a worker process per CPU, each a reactor, see PreforkServer.
+void RunPrefork(int port_fd, PreforkServer::Mode mode) {
+  PreforkServer server(InetAddress(0, true), "pingpong", mode);
+  server.SetWorkerInitCallback([](EventLoop*, TcpServer* worker, int) {
+    worker->SetConnectionCallback([](const TcpConnectionPtr& conn) {
+      if (conn->Connected()) {
+        conn->SetTcpNoDelay(true);
+      }
+    });
+    worker->SetMessageCallback([](const TcpConnectionPtr& conn, Buffer* buffer) {
+      conn->Send(buffer);
+    });
+  });
+  const uint16_t port = server.listen_address().Port();
+  ::write(port_fd, &port, sizeof(port));
+  ::close(port_fd);
+  server.Run();
+}
+
+void RunPreforkShared(int port_fd) { RunPrefork(port_fd, PreforkServer::kSharedListener); }
+
+void RunPreforkReusePort(int port_fd) { RunPrefork(port_fd, PreforkServer::kReusePort); }
+
+struct Model {
+  const char* name;
+  void (*run)(int port_fd);  // listens, reports the port, serves forever
+};
+
+const Model kModels[] = {
+  {"iterative", RunIterative},
+  {"thread-per-conn", RunThreadPerConnection},
+  {"prethread", RunPrethread},
+  {"reactor", RunReactor},
+  {"prefork/shared", RunPreforkShared},
+  {"prefork/reuseport", RunPreforkReusePort},
+};
+
+// Forks the server of model, returns its pid and port.
+pid_t StartServer(const Model& model, uint16_t* port) {
+  int port_fds[2];
+  if (::pipe(port_fds) < 0) {
+    perror("pipe");
+    exit(1);
+  }
+  pid_t pid = ::fork();
+  if (pid == 0) {
+    ::close(port_fds[0]);
+    model.run(port_fds[1]);
+    _exit(0);
+  }
+  ::close(port_fds[1]);
+  if (::read(port_fds[0], port, sizeof(*port)) != sizeof(*port)) {
+    fprintf(stderr, "server %s did not start\n", model.name);
+    exit(1);
+  }
+  ::close(port_fds[0]);
+  return pid;
+}
+
+struct ClientThread {
+  std::vector<int> fds;
+  std::atomic<bool>* stop;
+  int64_t messages{0};
+  int served{0};  // connections with at least one reply
+};
+
+// Keeps one message in flight on each of its connections until stopped.
+// Writes block, a message always fits in the socket buffers; reads are
+// driven by epoll so a connection the server does not serve yet holds up
+// nobody but itself.
+void* ClientRoutine(void* arg) {
+  ClientThread* thread = static_cast<ClientThread*>(arg);
+  const std::string message(g_message_bytes, 'p');
+  std::vector<char> buf(g_message_bytes);
+  int epollfd = ::epoll_create1(EPOLL_CLOEXEC);
+  std::vector<size_t> received(thread->fds.size(), 0);
+  std::vector<bool> replied(thread->fds.size(), false);
+  for (size_t i = 0; i < thread->fds.size(); ++i) {
+    struct epoll_event event;
+    event.events = EPOLLIN;
+    event.data.u64 = i;
+    ::epoll_ctl(epollfd, EPOLL_CTL_ADD, thread->fds[i], &event);
+    ::write(thread->fds[i], message.data(), message.size());
+  }
+  struct epoll_event events[64];
+  while (!thread->stop->load(std::memory_order_relaxed)) {
+    int n = ::epoll_wait(epollfd, events, 64, 100);
+    for (int i = 0; i < n; ++i) {
+      const size_t index = events[i].data.u64;
+      const int fd = thread->fds[index];
+      ssize_t m = ::read(fd, buf.data(), g_message_bytes - received[index]);
+      if (m <= 0) {
+        ::epoll_ctl(epollfd, EPOLL_CTL_DEL, fd, nullptr);
+        continue;
+      }
+      received[index] += m;
+      if (received[index] == g_message_bytes) {
+        received[index] = 0;
+        ++thread->messages;
+        if (!replied[index]) {
+          replied[index] = true;
+          ++thread->served;
+        }
+        ::write(fd, message.data(), message.size());
+      }
+    }
+  }
+  ::close(epollfd);
+  return nullptr;
+}
+
+void RunModel(const Model& model) {
+  uint16_t port = 0;
+  pid_t pid = StartServer(model, &port);
+  InetAddress server_addr("127.0.0.1", port);
+
+  std::atomic<bool> stop(false);
+  std::vector<ClientThread> threads(g_client_threads);
+  for (int i = 0; i < g_connections; ++i) {
+    int sockfd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    // SO_REUSEPORT workers may not all be listening yet.
+    int retries = 0;
+    while (::connect(sockfd, server_addr.GetSockAddr(), sizeof(struct sockaddr_in)) < 0) {
+      if (errno != ECONNREFUSED || ++retries == 100) {
+        perror("connect");
+        exit(1);
+      }
+      ::usleep(10 * 1000);
+    }
+    int one = 1;
+    ::setsockopt(sockfd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    threads[i % g_client_threads].fds.push_back(sockfd);
+  }
+
+  const double server_cpu_start = CpuSeconds(pid);
+  pid_t ppid = 0;
+  const double client_cpu_start = ProcessCpuSeconds(::getpid(), &ppid);
+  const double start = NowSeconds();
+  std::vector<pthread_t> tids(g_client_threads);
+  for (int i = 0; i < g_client_threads; ++i) {
+    threads[i].stop = &stop;
+    pthread_create(&tids[i], nullptr, ClientRoutine, &threads[i]);
+  }
+  ::usleep(static_cast<useconds_t>(g_seconds * 1e6));
+  stop = true;
+  for (pthread_t tid : tids) {
+    pthread_join(tid, nullptr);
+  }
+  const double elapsed = NowSeconds() - start;
+  const double server_cpu = CpuSeconds(pid) - server_cpu_start;
+  const double client_cpu = ProcessCpuSeconds(::getpid(), &ppid) - client_cpu_start;
+
+  ::kill(pid, SIGTERM);  // the prefork master takes its workers down
+  ::waitpid(pid, nullptr, 0);
+
+  int64_t messages = 0;
+  int served = 0;
+  for (ClientThread& thread : threads) {
+    messages += thread.messages;
+    served += thread.served;
+    for (int fd : thread.fds) {
+      ::close(fd);
+    }
+  }
+  const double mib = static_cast<double>(messages * g_message_bytes) / (1024 * 1024);
+  printf("%-18s %8d %12.0f %10.1f %12.2f %12.2f\n", model.name, served, messages / elapsed,
+         mib / elapsed, server_cpu / elapsed, client_cpu / elapsed);
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  if (argc > 1) {
+    g_connections = atoi(argv[1]);
+  }
+  if (argc > 2) {
+    g_client_threads = atoi(argv[2]);
+  }
+  if (argc > 3) {
+    g_message_bytes = static_cast<size_t>(atol(argv[3]));
+  }
+  if (argc > 4) {
+    g_seconds = atof(argv[4]);
+  }
+  if (g_client_threads > g_connections) {
+    g_client_threads = g_connections;
+  }
+
+  printf("pingpong_benchmark: %d connections, %d client threads, %zu byte messages, %.1f s\n",
+         g_connections, g_client_threads, g_message_bytes, g_seconds);
+  printf("%-18s %8s %12s %10s %12s %12s\n", "model", "served", "messages/s", "MiB/s",
+         "server cpu", "client cpu");
+  for (const Model& model : kModels) {
+    RunModel(model);
+  }
+  return 0;
+}
@@ -0,0 +1,34 @@
+#include "poller.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <memory>
+
+#include "channel.h"
+#include "epoll_poller.h"
+#include "io_uring_poller.h"
+
+namespace mymuduo {
+
+namespace net {
+
+bool Poller::HasChannel(Channel* channel) const {
+  auto it = channels_.find(channel->fd());
+  return it != channels_.end() && it->second == channel;
+}
+
+Poller* Poller::NewDefaultPoller(EventLoop* loop) {
+  if (::getenv("MYMUDUO_USE_IO_URING")) {
+    std::unique_ptr<IoUringPoller> poller(new IoUringPoller(loop));
+    if (poller->Init()) {
+      return poller.release();
+    }
+    fprintf(stderr, "Poller: io_uring is unavailable, falling back to epoll\n");
+  }
+  return new EPollPoller(loop);
+}
+
+}  // namespace net
+
+}  // namespace mymuduo
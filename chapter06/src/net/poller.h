@@ -0,0 +1,61 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <unordered_map>
+#include <vector>
+
+namespace mymuduo {
+
+namespace net {
+
+class Channel;
+class EventLoop;
+
+// IO multiplexing interface, owned by an EventLoop and only used in its thread.
+class Poller {
+ public:
+  using ChannelList = std::vector<Channel*>;
+
+  explicit Poller(EventLoop* loop) : owner_loop_(loop) {}
+  virtual ~Poller() = default;
+
+  Poller(const Poller&) = delete;
+  Poller& operator=(const Poller&) = delete;
+
+  // Waits up to timeout_ms and fills the channels that have events.
+  virtual void Poll(int timeout_ms, ChannelList* active_channels) = 0;
+
+  // Changes the interested events of a channel.
+  virtual void UpdateChannel(Channel* channel) = 0;
+
+  // Removes the channel, when it destructs.
+  virtual void RemoveChannel(Channel* channel) = 0;
+
+  bool HasChannel(Channel* channel) const;
+
+  // Whether channels may ask for completion reads (Channel::read_mode()),
+  // otherwise they are only told about readability.
+  virtual bool SupportsCompletionReads() const { return false; }
+
+  virtual const char* name() const = 0;
+
+  // Syscalls made by the poller itself, waits and registrations.
+  int64_t num_syscalls() const { return num_syscalls_; }
+
+  // epoll, or io_uring when MYMUDUO_USE_IO_URING is set and the kernel
+  // supports it.
+  static Poller* NewDefaultPoller(EventLoop* loop);
+
+ protected:
+  using ChannelMap = std::unordered_map<int, Channel*>;
+  ChannelMap channels_;
+  int64_t num_syscalls_{0};
+
+ private:
+  EventLoop* owner_loop_;
+};
+
+}  // namespace net
+
+}  // namespace mymuduo
@@ -0,0 +1,218 @@
+#include "prefork_server.h"
+
+#include <errno.h>
+#include <sched.h>
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <memory>
+
+#include "cpu_topology.h"
+#include "event_loop.h"
+#include "sockets_ops.h"
+#include "tcp_server.h"
+
+namespace mymuduo {
+
+namespace net {
+
+namespace {
+
+volatile sig_atomic_t g_stop = 0;
+
+void HandleStopSignal(int) {
+  g_stop = 1;
+}
+
+// Only there to end sigsuspend: SIGCHLD is ignored by default.
+void HandleChildSignal(int) {}
+
+void MasterSignals(sigset_t* signals) {
+  sigemptyset(signals);
+  sigaddset(signals, SIGTERM);
+  sigaddset(signals, SIGINT);
+  sigaddset(signals, SIGCHLD);
+}
+
+// Sleeps up to seconds, cut short by SIGTERM or SIGINT, blocked by then.
+void PauseUnlessStopped(int seconds) {
+  sigset_t stop_signals;
+  sigemptyset(&stop_signals);
+  sigaddset(&stop_signals, SIGTERM);
+  sigaddset(&stop_signals, SIGINT);
+  struct timespec timeout = {seconds, 0};
+  if (::sigtimedwait(&stop_signals, nullptr, &timeout) > 0) {
+    g_stop = 1;
+  }
+}
+
+double NowSeconds() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<double>(ts.tv_sec) + static_cast<double>(ts.tv_nsec) / 1e9;
+}
+
+void SetOption(int sockfd, int name) {
+  int on = 1;
+  ::setsockopt(sockfd, SOL_SOCKET, name, &on, sizeof(on));
+}
+
+// A worker dying sooner than this after its start is restarted after a
+// pause, so a crash at startup does not turn into a fork loop.
+const double kMinWorkerLifetime = 1.0;
+
+}  // namespace
+
+PreforkServer::PreforkServer(const InetAddress& listen_addr, const std::string& name, Mode mode,
+                             int worker_num)
+    : name_(name),
+      mode_(mode),
+      listen_fd_(sockets::CreateNonblockingOrDie()),
+      cpus_(CpuTopology::Get().Order(CpuTopology::kScatter)) {
+  workers_.resize(worker_num > 0 ? worker_num : cpus_.size());
+
+  SetOption(listen_fd_, SO_REUSEADDR);
+  if (mode_ == kReusePort) {
+    SetOption(listen_fd_, SO_REUSEPORT);  // the workers bind the port next to it
+  }
+  sockets::BindOrDie(listen_fd_, listen_addr.GetSockAddr());
+  if (mode_ == kSharedListener) {
+    sockets::ListenOrDie(listen_fd_);
+  }
+}
+
+PreforkServer::~PreforkServer() {
+  sockets::Close(listen_fd_);
+}
+
+InetAddress PreforkServer::listen_address() const {
+  return InetAddress(sockets::GetLocalAddr(listen_fd_));
+}
+
+void PreforkServer::Run() {
+  // The signals stay blocked but inside sigsuspend, so one arriving between
+  // the check of g_stop and the wait is not missed: it ends the wait.
+  sigset_t signals, old_mask;
+  MasterSignals(&signals);
+  ::sigprocmask(SIG_BLOCK, &signals, &old_mask);
+  struct sigaction action;
+  memset(&action, 0, sizeof(action));
+  action.sa_handler = HandleStopSignal;
+  struct sigaction old_term, old_int, old_chld;
+  ::sigaction(SIGTERM, &action, &old_term);
+  ::sigaction(SIGINT, &action, &old_int);
+  action.sa_handler = HandleChildSignal;
+  ::sigaction(SIGCHLD, &action, &old_chld);
+  g_stop = 0;
+
+  sigset_t wait_mask = old_mask;
+  sigdelset(&wait_mask, SIGTERM);
+  sigdelset(&wait_mask, SIGINT);
+  sigdelset(&wait_mask, SIGCHLD);
+  for (int i = 0; i < worker_num(); ++i) {
+    StartWorker(i);
+  }
+  while (!g_stop) {
+    int status = 0;
+    pid_t pid = ::waitpid(-1, &status, WNOHANG);
+    if (pid < 0) {
+      break;  // no children left, should not happen
+    }
+    if (pid == 0) {
+      ::sigsuspend(&wait_mask);  // returns once a handler ran
+      continue;
+    }
+    for (int i = 0; i < worker_num(); ++i) {
+      if (workers_[i].pid != pid) {
+        continue;
+      }
+      workers_[i].pid = 0;
+      fprintf(stderr, "PreforkServer [%s]: worker %d (pid %d) %s %d, restarting\n",
+              name_.c_str(), i, static_cast<int>(pid),
+              WIFSIGNALED(status) ? "killed by signal" : "exited with",
+              WIFSIGNALED(status) ? WTERMSIG(status) : WEXITSTATUS(status));
+      if (NowSeconds() - workers_[i].started < kMinWorkerLifetime) {
+        PauseUnlessStopped(1);
+      }
+      if (!g_stop) {
+        StartWorker(i);
+      }
+    }
+  }
+  StopWorkers();
+
+  // Unblocked first: a late SIGTERM still only sets g_stop.
+  ::sigprocmask(SIG_SETMASK, &old_mask, nullptr);
+  ::sigaction(SIGTERM, &old_term, nullptr);
+  ::sigaction(SIGINT, &old_int, nullptr);
+  ::sigaction(SIGCHLD, &old_chld, nullptr);
+}
+
+void PreforkServer::StartWorker(int index) {
+  pid_t pid = ::fork();
+  if (pid < 0) {
+    fprintf(stderr, "PreforkServer [%s]: fork: %s\n", name_.c_str(), strerror(errno));
+    return;
+  }
+  if (pid == 0) {
+    RunWorker(index);
+  }
+  workers_[index].pid = pid;
+  workers_[index].started = NowSeconds();
+}
+
+void PreforkServer::RunWorker(int index) {
+  ::signal(SIGTERM, SIG_DFL);
+  ::signal(SIGINT, SIG_DFL);
+  ::signal(SIGCHLD, SIG_DFL);
+  sigset_t signals;
+  MasterSignals(&signals);
+  ::sigprocmask(SIG_UNBLOCK, &signals, nullptr);
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(cpus_[index % cpus_.size()], &set);
+  if (::sched_setaffinity(0, sizeof(set), &set) < 0) {
+    fprintf(stderr, "PreforkServer [%s]: worker %d sched_setaffinity: %s\n", name_.c_str(), index,
+            strerror(errno));
+  }
+
+  const std::string name = name_ + "#" + std::to_string(index);
+  EventLoop loop;
+  std::unique_ptr<TcpServer> server;
+  if (mode_ == kSharedListener) {
+    server.reset(new TcpServer(&loop, listen_fd_, name));
+    server->SetExclusiveAccept(true);
+  } else {
+    server.reset(new TcpServer(&loop, listen_address(), name, TcpServer::kReusePort));
+    sockets::Close(listen_fd_);
+  }
+  if (worker_init_callback_) {
+    worker_init_callback_(&loop, server.get(), index);
+  }
+  server->Start();
+  loop.Loop();
+  _exit(0);
+}
+
+void PreforkServer::StopWorkers() {
+  for (Worker& worker : workers_) {
+    if (worker.pid > 0) {
+      ::kill(worker.pid, SIGTERM);
+    }
+  }
+  for (Worker& worker : workers_) {
+    if (worker.pid > 0) {
+      ::waitpid(worker.pid, nullptr, 0);
+      worker.pid = 0;
+    }
+  }
+}
+
+}  // namespace net
+
+}  // namespace mymuduo
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <sys/types.h>
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "inet_address.h"
+
+namespace mymuduo {
+
+namespace net {
+
+class EventLoop;
+class TcpServer;
+
+// Prefork server (方案4): a master process binds the address and forks one
+// worker per CPU, each pinned to its CPU with sched_setaffinity and running
+// its own EventLoop and TcpServer. Workers share nothing, there is no lock
+// across processes; a worker that dies is forked again. CPUs go out in
+// CpuTopology::kScatter order: fewer workers than CPUs spread over the
+// packages and cores before any two share a core.
+//
+// kSharedListener: the master listens and every worker accepts on the
+// inherited fd, registered with EPOLLEXCLUSIVE so a connection wakes one
+// worker. Connections queue in the backlog while a worker restarts.
+// kReusePort: every worker binds a SO_REUSEPORT socket of its own and the
+// kernel spreads connections over them by hash; the master only holds the
+// port. Connections hashed to a dead worker's socket are reset.
+//
+// One PreforkServer per process: Run() owns SIGTERM/SIGINT/SIGCHLD while it
+// runs.
+class PreforkServer {
+ public:
+  enum Mode { kSharedListener, kReusePort };
+  // Runs in each worker before its server starts: set the callbacks there.
+  using WorkerInitCallback = std::function<void(EventLoop*, TcpServer*, int worker_index)>;
+
+  // worker_num 0: one per CPU the process may run on.
+  PreforkServer(const InetAddress& listen_addr, const std::string& name, Mode mode,
+                int worker_num = 0);
+  ~PreforkServer();
+
+  PreforkServer(const PreforkServer&) = delete;
+  PreforkServer& operator=(const PreforkServer&) = delete;
+
+  // Bound in the constructor, tells the port picked for port 0.
+  InetAddress listen_address() const;
+  int worker_num() const { return static_cast<int>(workers_.size()); }
+
+  void SetWorkerInitCallback(WorkerInitCallback cb) { worker_init_callback_ = std::move(cb); }
+
+  // Forks the workers and restarts the ones that exit, until SIGTERM or
+  // SIGINT; then terminates them and returns. Master only.
+  void Run();
+
+ private:
+  struct Worker {
+    pid_t pid{0};
+    double started{0};  // CLOCK_MONOTONIC seconds
+  };
+
+  void StartWorker(int index);
+  // In the forked child, never returns.
+  void RunWorker(int index);
+  void StopWorkers();
+
+ private:
+  const std::string name_;
+  const Mode mode_;
+  int listen_fd_;  // listening in kSharedListener, only bound in kReusePort
+  std::vector<int> cpus_;
+  std::vector<Worker> workers_;
+  WorkerInitCallback worker_init_callback_;
+};
+
+}  // namespace net
+
+}  // namespace mymuduo
@@ -0,0 +1,69 @@
+#include "rpc.h"
+
+#include "event_loop.h"
+#include "tcp_connection.h"
+
+namespace mymuduo {
+
+namespace net {
+
+const char* RpcStatusName(RpcStatus status) {
+  switch (status) {
+    case kRpcOk:
+      return "ok";
+    case kRpcNoSuchMethod:
+      return "no such method";
+    case kRpcTimeout:
+      return "timeout";
+    case kRpcDisconnected:
+      return "disconnected";
+  }
+  return "unknown";
+}
+
+void FrameBatch::AddRequest(uint64_t call_id, std::string_view method,
+                            std::string_view request) {
+  const size_t len = sizeof(int64_t) + sizeof(int16_t) + method.size() + request.size();
+  buffer_.AppendInt32(static_cast<int32_t>(len));
+  buffer_.AppendInt64(static_cast<int64_t>(call_id));
+  buffer_.AppendInt16(static_cast<int16_t>(method.size()));
+  buffer_.Append(method);
+  buffer_.Append(request);
+  ScheduleFlush();
+}
+
+void FrameBatch::AddResponse(uint64_t call_id, RpcStatus status, std::string_view response) {
+  const size_t len = sizeof(int64_t) + sizeof(int16_t) + response.size();
+  buffer_.AppendInt32(static_cast<int32_t>(len));
+  buffer_.AppendInt64(static_cast<int64_t>(call_id));
+  buffer_.AppendInt16(status);
+  buffer_.Append(response);
+  ScheduleFlush();
+}
+
+void FrameBatch::ScheduleFlush() {
+  if (flush_queued_) {
+    return;
+  }
+  TcpConnectionPtr conn(conn_.lock());
+  if (!conn) {
+    buffer_.RetrieveAll();
+    return;
+  }
+  flush_queued_ = true;
+  // Runs after the current round of events, every frame they add goes too.
+  conn->GetLoop()->QueueInLoop([self = shared_from_this()]() { self->Flush(); });
+}
+
+void FrameBatch::Flush() {
+  flush_queued_ = false;
+  TcpConnectionPtr conn(conn_.lock());
+  if (conn) {
+    conn->Send(&buffer_);
+  }
+  buffer_.RetrieveAll();
+}
+
+}  // namespace net
+
+}  // namespace mymuduo
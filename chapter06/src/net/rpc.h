@@ -0,0 +1,58 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <memory>
+#include <string_view>
+
+#include "buffer.h"
+#include "callbacks.h"
+
+namespace mymuduo {
+
+namespace net {
+
+// Pipelined RPC over one TCP connection: the client may have any number of
+// calls outstanding, each tagged with a 64 bit call id, and the server
+// answers them in whatever order they complete.
+//
+// Every message is one LengthHeaderCodec frame, integers in network byte
+// order:
+//   request   int64 call id | int16 method length | method | request body
+//   response  int64 call id | int16 status | response body
+enum RpcStatus : int16_t {
+  kRpcOk = 0,
+  kRpcNoSuchMethod = 1,
+  kRpcTimeout = 2,         // set by the client, never sent
+  kRpcDisconnected = 3,    // set by the client, never sent
+};
+
+const char* RpcStatusName(RpcStatus status);
+
+// Frames queued on a connection during one loop iteration, sent with one
+// Send, and so usually one write, after the events of the iteration.
+// Small responses that complete together share a packet instead of paying
+// a syscall each. Loop thread only.
+class FrameBatch : public std::enable_shared_from_this<FrameBatch> {
+ public:
+  explicit FrameBatch(const TcpConnectionPtr& conn) : conn_(conn), flush_queued_(false) {}
+
+  FrameBatch(const FrameBatch&) = delete;
+  FrameBatch& operator=(const FrameBatch&) = delete;
+
+  void AddRequest(uint64_t call_id, std::string_view method, std::string_view request);
+  void AddResponse(uint64_t call_id, RpcStatus status, std::string_view response);
+
+ private:
+  void ScheduleFlush();
+  void Flush();
+
+ private:
+  std::weak_ptr<TcpConnection> conn_;
+  Buffer buffer_;
+  bool flush_queued_;
+};
+
+}  // namespace net
+
+}  // namespace mymuduo
@@ -0,0 +1,211 @@
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "event_loop.h"
+#include "inet_address.h"
+#include "rpc.h"
+#include "rpc_channel.h"
+#include "rpc_server.h"
+#include "tcp_client.h"
+#include "tcp_connection.h"
+
+// Pipelined RPC over one loopback connection. A forked server echoes the
+// request; the client keeps `depth` calls in flight for each depth of the
+// sweep and reports calls/sec, latency percentiles, and the write calls
+// per RPC of both ends (/proc/<pid>/io), which shows how many requests and
+// responses share a write.
+// usage: rpc_benchmark [seconds per depth] [request_bytes]
+
+using mymuduo::net::EventLoop;
+using mymuduo::net::InetAddress;
+using mymuduo::net::RpcChannel;
+using mymuduo::net::RpcServer;
+using mymuduo::net::RpcStatus;
+using mymuduo::net::TcpClient;
+using mymuduo::net::TcpConnectionPtr;
+using mymuduo::net::TimerQueue;
+
+namespace {
+
+double g_seconds = 1;
+size_t g_request_bytes = 64;
+const int kDepths[] = {1, 4, 16, 64, 256};
+
+int64_t WriteSyscalls(pid_t pid) {
+  char path[64];
+  snprintf(path, sizeof(path), "/proc/%d/io", static_cast<int>(pid));
+  FILE* fp = fopen(path, "r");
+  if (!fp) {
+    return 0;
+  }
+  char name[64];
+  long long value = 0;
+  int64_t total = 0;
+  while (fscanf(fp, "%63[^:]: %lld\n", name, &value) == 2) {
+    if (strcmp(name, "syscw") == 0) {
+      total = value;
+    }
+  }
+  fclose(fp);
+  return total;
+}
+
+// Runs in the forked child, never returns.
+void RunServer(int port_fd) {
+  EventLoop loop;
+  RpcServer server(&loop, InetAddress(0, true), "rpc_benchmark");
+  server.RegisterMethod("echo", [](std::string_view request, const RpcServer::Done& done) {
+    done(request);
+  });
+  server.Start();
+  const uint16_t port = server.listen_address().Port();
+  ::write(port_fd, &port, sizeof(port));
+  ::close(port_fd);
+  loop.Loop();
+  _exit(0);
+}
+
+// Keeps depth calls in flight until the time is up.
+class Driver {
+ public:
+  Driver(EventLoop* loop, RpcChannel* channel, pid_t server_pid)
+      : loop_(loop),
+        channel_(channel),
+        server_pid_(server_pid),
+        request_(g_request_bytes, 'r'),
+        depth_index_(0) {}
+
+  void Start() {
+    printf("%-8s %12s %10s %10s %10s %12s %12s\n", "depth", "calls/s", "p50 us", "p99 us",
+           "p999 us", "cli w/call", "srv w/call");
+    StartDepth();
+  }
+
+ private:
+  void StartDepth() {
+    latencies_.clear();
+    errors_ = 0;
+    client_writes_ = WriteSyscalls(::getpid());
+    server_writes_ = WriteSyscalls(server_pid_);
+    start_ = TimerQueue::Now();
+    end_ = start_ + static_cast<int64_t>(g_seconds * 1000000);
+    for (int i = 0; i < kDepths[depth_index_]; ++i) {
+      Issue();
+    }
+  }
+
+  void Issue() {
+    const int64_t issued = TimerQueue::Now();
+    channel_->Call("echo", request_, [this, issued](RpcStatus status, std::string_view) {
+      const int64_t now = TimerQueue::Now();
+      if (status == mymuduo::net::kRpcOk) {
+        latencies_.push_back(now - issued);
+      } else {
+        ++errors_;
+      }
+      if (now < end_) {
+        Issue();
+      } else if (channel_->pending() == 0) {
+        // Not from inside the channel's callback.
+        loop_->QueueInLoop([this]() { FinishDepth(); });
+      }
+    });
+  }
+
+  void FinishDepth() {
+    const double elapsed = static_cast<double>(TimerQueue::Now() - start_) / 1e6;
+    const double calls = static_cast<double>(latencies_.size());
+    const int64_t client_writes = WriteSyscalls(::getpid()) - client_writes_;
+    const int64_t server_writes = WriteSyscalls(server_pid_) - server_writes_;
+    std::sort(latencies_.begin(), latencies_.end());
+    auto percentile = [this](double p) {
+      return latencies_.empty() ? 0 : latencies_[static_cast<size_t>(p * (latencies_.size() - 1))];
+    };
+    printf("%-8d %12.0f %10lld %10lld %10lld %12.3f %12.3f", kDepths[depth_index_],
+           calls / elapsed, static_cast<long long>(percentile(0.5)),
+           static_cast<long long>(percentile(0.99)), static_cast<long long>(percentile(0.999)),
+           static_cast<double>(client_writes) / calls, static_cast<double>(server_writes) / calls);
+    printf(errors_ ? "  %d errors\n" : "\n", errors_);
+    if (++depth_index_ < static_cast<int>(sizeof(kDepths) / sizeof(kDepths[0]))) {
+      StartDepth();
+    } else {
+      loop_->Quit();
+    }
+  }
+
+ private:
+  EventLoop* loop_;
+  RpcChannel* channel_;
+  pid_t server_pid_;
+  std::string request_;
+  int depth_index_;
+  int64_t start_;
+  int64_t end_;
+  int errors_;
+  int64_t client_writes_;
+  int64_t server_writes_;
+  std::vector<int64_t> latencies_;
+};
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  if (argc > 1) {
+    g_seconds = atof(argv[1]);
+  }
+  if (argc > 2) {
+    g_request_bytes = static_cast<size_t>(atol(argv[2]));
+  }
+
+  int port_fds[2];
+  if (::pipe(port_fds) < 0) {
+    perror("pipe");
+    return 1;
+  }
+  pid_t pid = ::fork();
+  if (pid == 0) {
+    ::close(port_fds[0]);
+    RunServer(port_fds[1]);
+  }
+  ::close(port_fds[1]);
+  uint16_t port = 0;
+  if (::read(port_fds[0], &port, sizeof(port)) != sizeof(port)) {
+    fprintf(stderr, "server did not start\n");
+    return 1;
+  }
+  ::close(port_fds[0]);
+
+  EventLoop loop;
+  printf("rpc_benchmark: %s, %zu byte requests, %.1f s per depth\n", loop.PollerName(),
+         g_request_bytes, g_seconds);
+  // Outlive the client, whose destructor still reports the disconnect.
+  std::unique_ptr<RpcChannel> channel;
+  std::unique_ptr<Driver> driver;
+  TcpClient client(&loop, InetAddress("127.0.0.1", port), "rpc_benchmark");
+  client.SetConnectionCallback([&](const TcpConnectionPtr& conn) {
+    if (conn->Connected()) {
+      channel.reset(new RpcChannel(conn));
+      driver.reset(new Driver(&loop, channel.get(), pid));
+      driver->Start();
+    } else {
+      channel->HandleDisconnected();
+      loop.Quit();
+    }
+  });
+  client.SetConnectFailedCallback([&loop](int) { loop.Quit(); });
+  client.Connect();
+  loop.Loop();
+
+  ::kill(pid, SIGTERM);
+  ::waitpid(pid, nullptr, 0);
+  return 0;
+}
@@ -0,0 +1,125 @@
+#include "rpc_channel.h"
+
+#include <endian.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <vector>
+
+#include "buffer.h"
+#include "event_loop.h"
+#include "tcp_connection.h"
+
+namespace mymuduo {
+
+namespace net {
+
+namespace {
+
+const size_t kResponseHeaderLen = sizeof(int64_t) + sizeof(int16_t);
+
+}  // namespace
+
+RpcChannel::RpcChannel(const TcpConnectionPtr& conn)
+    : conn_(conn),
+      codec_([this](const TcpConnectionPtr&, std::string_view frame) { OnResponse(frame); }),
+      batch_(std::make_shared<FrameBatch>(conn)),
+      next_call_id_(1),
+      deadline_timer_(0),
+      timer_at_(0) {
+  conn_->GetLoop()->AssertInLoopThread();
+  conn_->SetTcpNoDelay(true);
+  conn_->SetMessageCallback([this](const TcpConnectionPtr& conn, Buffer* buffer) {
+    codec_.OnMessage(conn, buffer);
+  });
+}
+
+RpcChannel::~RpcChannel() {
+  conn_->SetMessageCallback(DefaultMessageCallback);
+  if (timer_at_ != 0) {
+    conn_->GetLoop()->Cancel(deadline_timer_);
+  }
+}
+
+void RpcChannel::Call(std::string_view method, std::string_view request, Done done,
+                      double timeout_seconds) {
+  conn_->GetLoop()->AssertInLoopThread();
+  if (!conn_->Connected()) {
+    done(kRpcDisconnected, std::string_view());
+    return;
+  }
+  const uint64_t call_id = next_call_id_++;
+  const int64_t deadline =
+      TimerQueue::Now() + static_cast<int64_t>(timeout_seconds * 1000000);
+  pending_.emplace(call_id, PendingCall{std::move(done), deadline});
+  deadlines_.insert({deadline, call_id});
+  batch_->AddRequest(call_id, method, request);
+  ArmDeadlineTimer();
+}
+
+void RpcChannel::OnResponse(std::string_view frame) {
+  if (frame.size() < kResponseHeaderLen) {
+    fprintf(stderr, "RpcChannel::OnResponse [%s]: short frame\n", conn_->name().c_str());
+    conn_->ForceClose();
+    return;
+  }
+  uint64_t be_call_id;
+  uint16_t be_status;
+  memcpy(&be_call_id, frame.data(), sizeof(be_call_id));
+  memcpy(&be_status, frame.data() + sizeof(be_call_id), sizeof(be_status));
+  auto it = pending_.find(be64toh(be_call_id));
+  if (it == pending_.end()) {
+    return;  // timed out already
+  }
+  Done done(std::move(it->second.done));
+  deadlines_.erase({it->second.deadline, it->first});
+  pending_.erase(it);
+  done(static_cast<RpcStatus>(be16toh(be_status)), frame.substr(kResponseHeaderLen));
+}
+
+void RpcChannel::HandleDisconnected() {
+  if (timer_at_ != 0) {
+    conn_->GetLoop()->Cancel(deadline_timer_);
+    timer_at_ = 0;
+  }
+  std::unordered_map<uint64_t, PendingCall> pending;
+  pending.swap(pending_);
+  deadlines_.clear();
+  for (auto& item : pending) {
+    item.second.done(kRpcDisconnected, std::string_view());
+  }
+}
+
+void RpcChannel::HandleDeadline() {
+  timer_at_ = 0;
+  const int64_t now = TimerQueue::Now();
+  std::vector<Done> expired;
+  while (!deadlines_.empty() && deadlines_.begin()->first <= now) {
+    auto it = pending_.find(deadlines_.begin()->second);
+    expired.push_back(std::move(it->second.done));
+    pending_.erase(it);
+    deadlines_.erase(deadlines_.begin());
+  }
+  // Before the callbacks, which may call again.
+  ArmDeadlineTimer();
+  for (Done& done : expired) {
+    done(kRpcTimeout, std::string_view());
+  }
+}
+
+void RpcChannel::ArmDeadlineTimer() {
+  // With one timeout for all calls deadlines come in order, and the timer
+  // is only touched when it fires.
+  if (deadlines_.empty() || (timer_at_ != 0 && timer_at_ <= deadlines_.begin()->first)) {
+    return;
+  }
+  if (timer_at_ != 0) {
+    conn_->GetLoop()->Cancel(deadline_timer_);
+  }
+  timer_at_ = deadlines_.begin()->first;
+  deadline_timer_ = conn_->GetLoop()->RunAt(timer_at_, [this]() { HandleDeadline(); });
+}
+
+}  // namespace net
+
+}  // namespace mymuduo
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <functional>
+#include <memory>
+#include <set>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+
+#include "callbacks.h"
+#include "length_header_codec.h"
+#include "rpc.h"
+#include "timer_queue.h"
+
+namespace mymuduo {
+
+namespace net {
+
+// Client end of the pipelined protocol of rpc.h, over one connection.
+//
+// Call never waits for earlier calls: it files the call under a new id in
+// the pending table and queues the request, requests of one loop iteration
+// go out in one write. Responses are matched by id, in any order. A call
+// that outlives its deadline completes with kRpcTimeout, a late response
+// for it is dropped; calls pending when the connection goes down complete
+// with kRpcDisconnected. One timer, set to the earliest deadline, covers
+// every pending call.
+//
+// Takes over the connection's message callback. Loop thread only.
+class RpcChannel {
+ public:
+  // response is only valid during the call.
+  using Done = std::function<void(RpcStatus status, std::string_view response)>;
+
+  static constexpr double kDefaultTimeoutSeconds = 5.0;
+
+  explicit RpcChannel(const TcpConnectionPtr& conn);
+  ~RpcChannel();
+
+  RpcChannel(const RpcChannel&) = delete;
+  RpcChannel& operator=(const RpcChannel&) = delete;
+
+  void Call(std::string_view method, std::string_view request, Done done,
+            double timeout_seconds = kDefaultTimeoutSeconds);
+  // Call from the connection callback when the connection goes down.
+  void HandleDisconnected();
+
+  size_t pending() const { return pending_.size(); }
+
+ private:
+  struct PendingCall {
+    Done done;
+    int64_t deadline;
+  };
+
+  void OnResponse(std::string_view frame);
+  void HandleDeadline();
+  void ArmDeadlineTimer();
+
+ private:
+  TcpConnectionPtr conn_;
+  LengthHeaderCodec codec_;
+  std::shared_ptr<FrameBatch> batch_;
+  uint64_t next_call_id_;
+  std::unordered_map<uint64_t, PendingCall> pending_;
+  std::set<std::pair<int64_t, uint64_t>> deadlines_;
+  TimerId deadline_timer_;
+  int64_t timer_at_;  // deadline the timer is set for, 0 if none
+};
+
+}  // namespace net
+
+}  // namespace mymuduo
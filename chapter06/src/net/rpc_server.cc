@@ -0,0 +1,145 @@
+#include "rpc_server.h"
+
+#include <endian.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <any>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "event_loop.h"
+#include "mutex.h"
+#include "tcp_connection.h"
+
+namespace mymuduo {
+
+namespace net {
+
+namespace {
+
+const size_t kRequestHeaderLen = sizeof(int64_t) + sizeof(int16_t);
+
+}  // namespace
+
+// Responses finished off the loop thread. The first one of a batch queues
+// the drain, the ones posted before it runs ride along.
+struct RpcServer::Completions {
+  struct Response {
+    std::shared_ptr<FrameBatch> batch;
+    uint64_t call_id;
+    std::string response;
+  };
+
+  void Post(EventLoop* loop, std::shared_ptr<FrameBatch> batch, uint64_t call_id,
+            std::string_view response, const std::shared_ptr<Completions>& self) {
+    bool first = false;
+    {
+      MutexLockGuard lock(mtx);
+      first = responses.empty();
+      responses.push_back(Response{std::move(batch), call_id, std::string(response)});
+    }
+    if (first) {
+      loop->QueueInLoop([self]() { self->Drain(); });
+    }
+  }
+
+  void Drain() {
+    std::vector<Response> drained;
+    {
+      MutexLockGuard lock(mtx);
+      drained.swap(responses);
+    }
+    for (Response& item : drained) {
+      item.batch->AddResponse(item.call_id, kRpcOk, item.response);
+    }
+  }
+
+  MutexLock mtx;
+  std::vector<Response> responses;
+};
+
+RpcServer::RpcServer(EventLoop* loop, const InetAddress& listen_addr, const std::string& name)
+    : server_(loop, listen_addr, name),
+      codec_([this](const TcpConnectionPtr& conn, std::string_view frame) {
+        OnRequest(conn, frame);
+      }),
+      compute_thread_num_(0),
+      compute_pool_(name + "-compute"),
+      completions_(std::make_shared<Completions>()) {
+  server_.SetConnectionCallback([this](const TcpConnectionPtr& conn) { OnConnection(conn); });
+  server_.SetMessageCallback([this](const TcpConnectionPtr& conn, Buffer* buffer) {
+    codec_.OnMessage(conn, buffer);
+  });
+}
+
+RpcServer::~RpcServer() {
+  compute_pool_.Stop();  // the calls still queued finish first
+}
+
+void RpcServer::Start() {
+  if (compute_thread_num_ > 0 && compute_pool_.thread_num() == 0) {
+    compute_pool_.Start(compute_thread_num_);
+  }
+  server_.Start();
+}
+
+void RpcServer::RegisterMethod(const std::string& name, Method method) {
+  methods_[name] = std::move(method);
+}
+
+void RpcServer::OnConnection(const TcpConnectionPtr& conn) {
+  if (conn->Connected()) {
+    conn->SetTcpNoDelay(true);
+    conn->SetContext(std::make_shared<FrameBatch>(conn));
+  }
+}
+
+void RpcServer::OnRequest(const TcpConnectionPtr& conn, std::string_view frame) {
+  if (frame.size() < kRequestHeaderLen) {
+    fprintf(stderr, "RpcServer::OnRequest [%s]: short frame\n", conn->name().c_str());
+    conn->ForceClose();
+    return;
+  }
+  uint64_t be_call_id;
+  uint16_t be_method_len;
+  memcpy(&be_call_id, frame.data(), sizeof(be_call_id));
+  memcpy(&be_method_len, frame.data() + sizeof(be_call_id), sizeof(be_method_len));
+  const uint64_t call_id = be64toh(be_call_id);
+  const size_t method_len = be16toh(be_method_len);
+  if (frame.size() < kRequestHeaderLen + method_len) {
+    fprintf(stderr, "RpcServer::OnRequest [%s]: bad method length\n", conn->name().c_str());
+    conn->ForceClose();
+    return;
+  }
+  const std::string_view method_name = frame.substr(kRequestHeaderLen, method_len);
+  const std::string_view request = frame.substr(kRequestHeaderLen + method_len);
+
+  auto batch = std::any_cast<std::shared_ptr<FrameBatch>>(conn->GetContext());
+  auto it = methods_.find(std::string(method_name));
+  if (it == methods_.end()) {
+    batch->AddResponse(call_id, kRpcNoSuchMethod, std::string_view());
+    return;
+  }
+  EventLoop* loop = conn->GetLoop();
+  Done done = [loop, batch, call_id, completions = completions_](std::string_view response) {
+    if (loop->IsInLoopThread()) {
+      batch->AddResponse(call_id, kRpcOk, response);
+    } else {
+      completions->Post(loop, batch, call_id, response, completions);
+    }
+  };
+  if (compute_pool_.thread_num() == 0) {
+    it->second(request, done);
+    return;
+  }
+  const Method* method = &it->second;
+  compute_pool_.Run([method, request = std::string(request), done = std::move(done)]() {
+    (*method)(request, done);
+  });
+}
+
+}  // namespace net
+
+}  // namespace mymuduo
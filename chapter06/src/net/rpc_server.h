@@ -0,0 +1,77 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "callbacks.h"
+#include "inet_address.h"
+#include "length_header_codec.h"
+#include "rpc.h"
+#include "tcp_server.h"
+#include "thread_pool.h"
+
+namespace mymuduo {
+
+namespace net {
+
+class EventLoop;
+
+// Serves registered methods over the pipelined protocol of rpc.h.
+// A method gets the request body and a Done to answer with, now or later
+// and from any thread, so a slow call does not hold up the ones behind it.
+// Responses completed in the same loop iteration go out in one write.
+//
+// With compute threads the loop only cuts and encodes frames: methods run
+// on a ThreadPool, so a call burning milliseconds of CPU does not stall
+// the other connections, and the responses finished meanwhile come back
+// to the loop in a batch, one wakeup for all of them.
+class RpcServer {
+ public:
+  // Call exactly once. The response is copied before Done returns.
+  using Done = std::function<void(std::string_view response)>;
+  using Method = std::function<void(std::string_view request, const Done& done)>;
+
+  RpcServer(EventLoop* loop, const InetAddress& listen_addr, const std::string& name);
+  ~RpcServer();
+
+  RpcServer(const RpcServer&) = delete;
+  RpcServer& operator=(const RpcServer&) = delete;
+
+  // Not thread safe, register before Start.
+  void RegisterMethod(const std::string& name, Method method);
+  // Runs the methods on num threads instead of the loop, set before Start.
+  void SetComputeThreadNum(int num) { compute_thread_num_ = num; }
+  // Pins the compute threads, see ThreadPool::SetThreadCpus. Set before Start.
+  void SetComputeThreadCpus(std::vector<int> cpus) {
+    compute_pool_.SetThreadCpus(std::move(cpus));
+  }
+  void Start();
+
+  InetAddress listen_address() const { return server_.listen_address(); }
+  // For connection level settings, e.g. SetEdgeTriggered.
+  TcpServer* server() { return &server_; }
+
+ private:
+  void OnConnection(const TcpConnectionPtr& conn);
+  void OnRequest(const TcpConnectionPtr& conn, std::string_view frame);
+
+ private:
+  struct Completions;
+
+  TcpServer server_;
+  LengthHeaderCodec codec_;
+  std::unordered_map<std::string, Method> methods_;
+  int compute_thread_num_;
+  ThreadPool compute_pool_;
+  // Shared with the functor that drains it, which may outlive the server.
+  std::shared_ptr<Completions> completions_;
+};
+
+}  // namespace net
+
+}  // namespace mymuduo
@@ -0,0 +1,68 @@
+#include "socket.h"
+
+#include <netinet/tcp.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+
+#include "inet_address.h"
+#include "sockets_ops.h"
+
+namespace mymuduo {
+
+namespace net {
+
+namespace {
+
+void SetOption(int sockfd, int level, int name, bool on) {
+  int optval = on ? 1 : 0;
+  ::setsockopt(sockfd, level, name, &optval, static_cast<socklen_t>(sizeof(optval)));
+}
+
+}  // namespace
+
+Socket::~Socket() {
+  sockets::Close(sockfd_);
+}
+
+void Socket::BindAddress(const InetAddress& local_addr) {
+  sockets::BindOrDie(sockfd_, local_addr.GetSockAddr());
+}
+
+void Socket::Listen() {
+  sockets::ListenOrDie(sockfd_);
+}
+
+int Socket::Accept(InetAddress* peer_addr) {
+  struct sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  int connfd = sockets::Accept(sockfd_, &addr);
+  if (connfd >= 0) {
+    peer_addr->SetSockAddr(addr);
+  }
+  return connfd;
+}
+
+void Socket::ShutdownWrite() {
+  sockets::ShutdownWrite(sockfd_);
+}
+
+void Socket::SetTcpNoDelay(bool on) {
+  SetOption(sockfd_, IPPROTO_TCP, TCP_NODELAY, on);
+}
+
+void Socket::SetReuseAddr(bool on) {
+  SetOption(sockfd_, SOL_SOCKET, SO_REUSEADDR, on);
+}
+
+void Socket::SetReusePort(bool on) {
+  SetOption(sockfd_, SOL_SOCKET, SO_REUSEPORT, on);
+}
+
+void Socket::SetKeepAlive(bool on) {
+  SetOption(sockfd_, SOL_SOCKET, SO_KEEPALIVE, on);
+}
+
+}  // namespace net
+
+}  // namespace mymuduo
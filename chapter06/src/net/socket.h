@@ -0,0 +1,40 @@
+#pragma once
+
+namespace mymuduo {
+
+namespace net {
+
+class InetAddress;
+
+// Owns a socket fd, closes it on destruction.
+class Socket {
+ public:
+  explicit Socket(int sockfd) : sockfd_(sockfd) {}
+  ~Socket();
+
+  Socket(const Socket&) = delete;
+  Socket& operator=(const Socket&) = delete;
+
+  int fd() const { return sockfd_; }
+
+  void BindAddress(const InetAddress& local_addr);
+  void Listen();
+
+  // On success returns a non-blocking connected fd and fills *peer_addr,
+  // otherwise returns -1.
+  int Accept(InetAddress* peer_addr);
+
+  void ShutdownWrite();
+
+  void SetTcpNoDelay(bool on);
+  void SetReuseAddr(bool on);
+  void SetReusePort(bool on);
+  void SetKeepAlive(bool on);
+
+ private:
+  const int sockfd_;
+};
+
+}  // namespace net
+
+}  // namespace mymuduo
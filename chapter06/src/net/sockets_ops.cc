@@ -0,0 +1,123 @@
+#include "sockets_ops.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace mymuduo {
+
+namespace net {
+
+namespace sockets {
+
+namespace {
+
+void Die(const char* what) {
+  fprintf(stderr, "sockets::%s: %s\n", what, strerror(errno));
+  abort();
+}
+
+}  // namespace
+
+int CreateNonblockingOrDie() {
+  int sockfd = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, IPPROTO_TCP);
+  if (sockfd < 0) {
+    Die("CreateNonblockingOrDie");
+  }
+  return sockfd;
+}
+
+void BindOrDie(int sockfd, const struct sockaddr* addr) {
+  if (::bind(sockfd, addr, sizeof(struct sockaddr_in)) < 0) {
+    Die("BindOrDie");
+  }
+}
+
+void ListenOrDie(int sockfd) {
+  if (::listen(sockfd, SOMAXCONN) < 0) {
+    Die("ListenOrDie");
+  }
+}
+
+int Accept(int sockfd, struct sockaddr_in* addr) {
+  socklen_t addrlen = sizeof(*addr);
+  int connfd = ::accept4(sockfd, reinterpret_cast<struct sockaddr*>(addr), &addrlen,
+                         SOCK_NONBLOCK | SOCK_CLOEXEC);
+  if (connfd < 0) {
+    int saved_errno = errno;
+    switch (saved_errno) {
+      case EAGAIN:
+      case ECONNABORTED:
+      case EINTR:
+      case EPROTO:
+      case EPERM:
+      case EMFILE:
+        break;
+      default:
+        // ENFILE, ENOBUFS, ENOMEM... or a bug of ours.
+        Die("Accept");
+    }
+    errno = saved_errno;
+  }
+  return connfd;
+}
+
+int Connect(int sockfd, const struct sockaddr* addr) {
+  return ::connect(sockfd, addr, sizeof(struct sockaddr_in));
+}
+
+void ShutdownWrite(int sockfd) {
+  if (::shutdown(sockfd, SHUT_WR) < 0) {
+    fprintf(stderr, "sockets::ShutdownWrite: %s\n", strerror(errno));
+  }
+}
+
+void Close(int sockfd) {
+  if (::close(sockfd) < 0) {
+    fprintf(stderr, "sockets::Close: %s\n", strerror(errno));
+  }
+}
+
+int GetSocketError(int sockfd) {
+  int optval = 0;
+  socklen_t optlen = sizeof(optval);
+  if (::getsockopt(sockfd, SOL_SOCKET, SO_ERROR, &optval, &optlen) < 0) {
+    return errno;
+  }
+  return optval;
+}
+
+struct sockaddr_in GetLocalAddr(int sockfd) {
+  struct sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  socklen_t addrlen = sizeof(addr);
+  if (::getsockname(sockfd, reinterpret_cast<struct sockaddr*>(&addr), &addrlen) < 0) {
+    fprintf(stderr, "sockets::GetLocalAddr: %s\n", strerror(errno));
+  }
+  return addr;
+}
+
+struct sockaddr_in GetPeerAddr(int sockfd) {
+  struct sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  socklen_t addrlen = sizeof(addr);
+  if (::getpeername(sockfd, reinterpret_cast<struct sockaddr*>(&addr), &addrlen) < 0) {
+    fprintf(stderr, "sockets::GetPeerAddr: %s\n", strerror(errno));
+  }
+  return addr;
+}
+
+bool IsSelfConnect(int sockfd) {
+  struct sockaddr_in local = GetLocalAddr(sockfd);
+  struct sockaddr_in peer = GetPeerAddr(sockfd);
+  return local.sin_port == peer.sin_port && local.sin_addr.s_addr == peer.sin_addr.s_addr;
+}
+
+}  // namespace sockets
+
+}  // namespace net
+
+}  // namespace mymuduo
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <netinet/in.h>
+
+namespace mymuduo {
+
+namespace net {
+
+// Thin wrappers of the socket syscalls.
+// The *OrDie ones abort, the rest return what the syscall returns.
+namespace sockets {
+
+int CreateNonblockingOrDie();
+
+void BindOrDie(int sockfd, const struct sockaddr* addr);
+void ListenOrDie(int sockfd);
+
+// Returns a non-blocking, close-on-exec fd, or -1 with errno set
+// when the error is one a server should survive (EAGAIN, EMFILE...).
+int Accept(int sockfd, struct sockaddr_in* addr);
+
+int Connect(int sockfd, const struct sockaddr* addr);
+void ShutdownWrite(int sockfd);
+void Close(int sockfd);
+
+int GetSocketError(int sockfd);
+struct sockaddr_in GetLocalAddr(int sockfd);
+struct sockaddr_in GetPeerAddr(int sockfd);
+bool IsSelfConnect(int sockfd);
+
+}  // namespace sockets
+
+}  // namespace net
+
+}  // namespace mymuduo
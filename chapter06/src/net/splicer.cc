@@ -0,0 +1,55 @@
+#include "splicer.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+namespace mymuduo {
+
+namespace net {
+
+Splicer::Splicer() : pending_(0) {
+  if (::pipe2(pipe_fds_, O_NONBLOCK | O_CLOEXEC) < 0) {
+    fprintf(stderr, "Splicer: pipe2: %s\n", strerror(errno));
+    pipe_fds_[0] = pipe_fds_[1] = -1;
+    return;
+  }
+  // A larger pipe means fewer round trips per pull, best effort.
+  ::fcntl(pipe_fds_[1], F_SETPIPE_SZ, static_cast<int>(kPipeSize));
+}
+
+Splicer::~Splicer() {
+  if (Valid()) {
+    ::close(pipe_fds_[0]);
+    ::close(pipe_fds_[1]);
+  }
+}
+
+ssize_t Splicer::Pull(int from_fd, size_t len) {
+  ssize_t n = ::splice(from_fd, nullptr, pipe_fds_[1], nullptr, len,
+                       SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+  if (n > 0) {
+    pending_ += n;
+  }
+  return n;
+}
+
+ssize_t Splicer::Push(int to_fd) {
+  ssize_t total = 0;
+  while (pending_ > 0) {
+    ssize_t n = ::splice(pipe_fds_[0], nullptr, to_fd, nullptr, pending_,
+                         SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+    if (n <= 0) {
+      return total > 0 ? total : n;
+    }
+    pending_ -= n;
+    total += n;
+  }
+  return total;
+}
+
+}  // namespace net
+
+}  // namespace mymuduo
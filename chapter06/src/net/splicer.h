@@ -0,0 +1,48 @@
+#pragma once
+
+#include <stddef.h>
+#include <sys/types.h>
+
+namespace mymuduo {
+
+namespace net {
+
+// Moves bytes from one fd to another through a pipe with splice(2), e.g.
+// socket to socket in a proxy, without copying them into user space.
+// Both ends may be non-blocking: whatever the sink does not take stays in
+// the pipe, the caller stops pulling until Push empties it again.
+//
+//   if (splicer.pending() == 0 && splicer.Pull(from_fd) == 0) { /* EOF */ }
+//   splicer.Push(to_fd);
+//   if (splicer.pending() > 0) { /* wait for to_fd writable */ }
+class Splicer {
+ public:
+  static constexpr size_t kPipeSize = 1024 * 1024;
+
+  Splicer();
+  ~Splicer();
+
+  Splicer(const Splicer&) = delete;
+  Splicer& operator=(const Splicer&) = delete;
+
+  // False if the pipe could not be created.
+  bool Valid() const { return pipe_fds_[0] >= 0; }
+
+  // Moves up to len bytes of from_fd into the pipe.
+  // Returns what splice(2) returns: 0 at EOF, -1 with errno (EAGAIN...).
+  ssize_t Pull(int from_fd, size_t len = kPipeSize);
+
+  // Moves bytes of the pipe into to_fd, returns what splice(2) returns.
+  ssize_t Push(int to_fd);
+
+  // Bytes pulled but not pushed yet.
+  size_t pending() const { return pending_; }
+
+ private:
+  int pipe_fds_[2];
+  size_t pending_;
+};
+
+}  // namespace net
+
+}  // namespace mymuduo
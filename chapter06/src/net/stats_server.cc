@@ -0,0 +1,67 @@
+#include "stats_server.h"
+
+#include <string>
+#include <string_view>
+
+#include "buffer.h"
+#include "stats.h"
+#include "tcp_connection.h"
+
+namespace mymuduo {
+
+namespace net {
+
+namespace {
+
+// Enough for a request line and the headers curl sends.
+const size_t kMaxRequestBytes = 8192;
+
+std::string Response(const char* status, const char* content_type, const std::string& body) {
+  std::string response = "HTTP/1.0 ";
+  response.append(status).append("\r\nContent-Type: ").append(content_type);
+  response.append("\r\nContent-Length: ").append(std::to_string(body.size()));
+  response.append("\r\nConnection: close\r\n\r\n").append(body);
+  return response;
+}
+
+}  // namespace
+
+StatsServer::StatsServer(EventLoop* loop, uint16_t port)
+    : server_(loop, InetAddress(port, true), "StatsServer") {
+  server_.SetConnectionCallback([](const TcpConnectionPtr&) {});  // no line per request
+  server_.SetMessageCallback(
+      [this](const TcpConnectionPtr& conn, Buffer* buffer) { OnMessage(conn, buffer); });
+}
+
+void StatsServer::OnMessage(const TcpConnectionPtr& conn, Buffer* buffer) {
+  const std::string_view request = buffer->ToStringView();
+  if (request.find("\r\n\r\n") == std::string_view::npos &&
+      request.find("\n\n") == std::string_view::npos) {
+    if (request.size() > kMaxRequestBytes) {
+      conn->Send(Response("431 Request Header Fields Too Large", "text/plain", "too large\n"));
+      conn->Shutdown();
+      buffer->RetrieveAll();
+    }
+    return;
+  }
+  // GET <path> HTTP/1.x
+  const size_t path_begin = request.find(' ') + 1;
+  const size_t path_end = request.find_first_of(" ?\r\n", path_begin);
+  const std::string_view method = request.substr(0, path_begin - 1);
+  const std::string_view path = request.substr(path_begin, path_end - path_begin);
+  if (method != "GET") {
+    conn->Send(Response("405 Method Not Allowed", "text/plain", "GET only\n"));
+  } else if (path == "/" || path == "/stats") {
+    conn->Send(Response("200 OK", "text/plain", Stats::DumpText()));
+  } else if (path == "/stats.json") {
+    conn->Send(Response("200 OK", "application/json", Stats::DumpJson()));
+  } else {
+    conn->Send(Response("404 Not Found", "text/plain", "try /stats or /stats.json\n"));
+  }
+  buffer->RetrieveAll();
+  conn->Shutdown();
+}
+
+}  // namespace net
+
+}  // namespace mymuduo
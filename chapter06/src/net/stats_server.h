@@ -0,0 +1,42 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "callbacks.h"
+#include "inet_address.h"
+#include "tcp_server.h"
+
+namespace mymuduo {
+
+namespace net {
+
+class Buffer;
+class EventLoop;
+
+// Dumps Stats over HTTP on the loopback interface, to look inside a
+// running process with nothing but curl:
+//   curl http://127.0.0.1:port/stats       one series per line
+//   curl http://127.0.0.1:port/stats.json  the same as JSON
+// One GET per connection, answered then closed. The dump runs on the
+// loop, so give it a loop with little else to do.
+class StatsServer {
+ public:
+  // Port 0 picks a free one, see listen_address().
+  StatsServer(EventLoop* loop, uint16_t port);
+
+  StatsServer(const StatsServer&) = delete;
+  StatsServer& operator=(const StatsServer&) = delete;
+
+  void Start() { server_.Start(); }
+  InetAddress listen_address() const { return server_.listen_address(); }
+
+ private:
+  void OnMessage(const TcpConnectionPtr& conn, Buffer* buffer);
+
+ private:
+  TcpServer server_;
+};
+
+}  // namespace net
+
+}  // namespace mymuduo
@@ -0,0 +1,130 @@
+#include "tcp_client.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "channel.h"
+#include "event_loop.h"
+#include "sockets_ops.h"
+#include "tcp_connection.h"
+
+namespace mymuduo {
+
+namespace net {
+
+TcpClient::TcpClient(EventLoop* loop, const InetAddress& server_addr, const std::string& name)
+    : loop_(loop),
+      server_addr_(server_addr),
+      name_(name),
+      connection_callback_(DefaultConnectionCallback),
+      message_callback_(DefaultMessageCallback),
+      next_conn_id_(1) {}
+
+TcpClient::~TcpClient() {
+  loop_->AssertInLoopThread();
+  if (connecting_channel_) {
+    int sockfd = connecting_channel_->fd();
+    connecting_channel_->DisableAll();
+    connecting_channel_->Remove();
+    sockets::Close(sockfd);
+  }
+  if (connection_) {
+    TcpConnectionPtr conn(std::move(connection_));
+    loop_->RunInLoop([conn]() { conn->ConnectDestroyed(); });
+  }
+}
+
+void TcpClient::Connect() {
+  loop_->RunInLoop([this]() { ConnectInLoop(); });
+}
+
+void TcpClient::Disconnect() {
+  loop_->RunInLoop([this]() {
+    if (connection_) {
+      connection_->Shutdown();
+    }
+  });
+}
+
+void TcpClient::ConnectInLoop() {
+  loop_->AssertInLoopThread();
+  if (connecting_channel_ || connection_) {
+    return;
+  }
+  int sockfd = sockets::CreateNonblockingOrDie();
+  if (sockets::Connect(sockfd, server_addr_.GetSockAddr()) == 0) {
+    NewConnection(sockfd);
+    return;
+  }
+  if (errno != EINPROGRESS && errno != EINTR) {
+    ConnectFailed(sockfd, errno);
+    return;
+  }
+  // Writable once the handshake is over, either way.
+  connecting_channel_.reset(new Channel(loop_, sockfd));
+  connecting_channel_->SetWriteCallback([this]() { HandleConnected(); });
+  connecting_channel_->SetErrorCallback([this]() { HandleConnected(); });
+  connecting_channel_->EnableWriting();
+}
+
+void TcpClient::HandleConnected() {
+  if (!connecting_channel_ || !connecting_channel_->IsWriting()) {
+    return;  // write and error callbacks of the same event
+  }
+  int sockfd = connecting_channel_->fd();
+  connecting_channel_->DisableAll();
+  connecting_channel_->Remove();
+  ReleaseConnectingChannel();
+
+  int err = sockets::GetSocketError(sockfd);
+  if (err == 0 && sockets::IsSelfConnect(sockfd)) {
+    err = ECONNREFUSED;
+  }
+  if (err != 0) {
+    ConnectFailed(sockfd, err);
+    return;
+  }
+  NewConnection(sockfd);
+}
+
+void TcpClient::ConnectFailed(int sockfd, int err) {
+  fprintf(stderr, "TcpClient::Connect [%s] to %s: %s\n", name_.c_str(),
+          server_addr_.ToIpPort().c_str(), strerror(err));
+  sockets::Close(sockfd);
+  if (connect_failed_callback_) {
+    connect_failed_callback_(err);
+  }
+}
+
+void TcpClient::ReleaseConnectingChannel() {
+  // The channel is still in its own HandleEvent.
+  Channel* channel = connecting_channel_.release();
+  loop_->QueueInLoop([channel]() { delete channel; });
+}
+
+void TcpClient::NewConnection(int sockfd) {
+  loop_->AssertInLoopThread();
+  std::string conn_name = name_ + "-" + server_addr_.ToIpPort() + "#" +
+                          std::to_string(next_conn_id_++);
+  InetAddress local_addr(sockets::GetLocalAddr(sockfd));
+  auto conn = std::make_shared<TcpConnection>(loop_, conn_name, sockfd, local_addr, server_addr_);
+  connection_ = conn;
+  conn->SetConnectionCallback(connection_callback_);
+  conn->SetMessageCallback(message_callback_);
+  conn->SetWriteCompleteCallback(write_complete_callback_);
+  conn->SetCloseCallback([this](const TcpConnectionPtr& conn) { RemoveConnection(conn); });
+  conn->ConnectEstablished();
+}
+
+void TcpClient::RemoveConnection(const TcpConnectionPtr& conn) {
+  loop_->AssertInLoopThread();
+  if (connection_ == conn) {
+    connection_.reset();
+  }
+  loop_->QueueInLoop([conn]() { conn->ConnectDestroyed(); });
+}
+
+}  // namespace net
+
+}  // namespace mymuduo
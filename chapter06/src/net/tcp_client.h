@@ -0,0 +1,70 @@
+#pragma once
+
+#include <memory>
+#include <string>
+
+#include "callbacks.h"
+#include "inet_address.h"
+
+namespace mymuduo {
+
+namespace net {
+
+class Channel;
+class EventLoop;
+
+// Single connection TCP client, the counterpart of TcpServer.
+// Connects without blocking the loop, once: a refused or failed connect is
+// reported on stderr and through ConnectFailedCallback, there is no retry.
+// The connection is served in the loop the client was created with.
+class TcpClient {
+ public:
+  using ConnectFailedCallback = std::function<void(int err)>;
+
+  TcpClient(EventLoop* loop, const InetAddress& server_addr, const std::string& name);
+  ~TcpClient();
+
+  TcpClient(const TcpClient&) = delete;
+  TcpClient& operator=(const TcpClient&) = delete;
+
+  const std::string& name() const { return name_; }
+  EventLoop* GetLoop() const { return loop_; }
+  // Null until connected and after the connection closed. Loop thread only.
+  TcpConnectionPtr connection() const { return connection_; }
+
+  // Thread safe.
+  void Connect();
+  // Shuts the write half down, the connection closes when the peer does.
+  void Disconnect();
+
+  // Not thread safe, set them before Connect.
+  void SetConnectionCallback(const ConnectionCallback& cb) { connection_callback_ = cb; }
+  void SetMessageCallback(const MessageCallback& cb) { message_callback_ = cb; }
+  void SetWriteCompleteCallback(const WriteCompleteCallback& cb) { write_complete_callback_ = cb; }
+  void SetConnectFailedCallback(const ConnectFailedCallback& cb) { connect_failed_callback_ = cb; }
+
+ private:
+  void ConnectInLoop();
+  void HandleConnected();
+  void ConnectFailed(int sockfd, int err);
+  // Drops connecting_channel_ once its event handling is over.
+  void ReleaseConnectingChannel();
+  void NewConnection(int sockfd);
+  void RemoveConnection(const TcpConnectionPtr& conn);
+
+ private:
+  EventLoop* loop_;
+  const InetAddress server_addr_;
+  const std::string name_;
+  std::unique_ptr<Channel> connecting_channel_;
+  ConnectionCallback connection_callback_;
+  MessageCallback message_callback_;
+  WriteCompleteCallback write_complete_callback_;
+  ConnectFailedCallback connect_failed_callback_;
+  int next_conn_id_;
+  TcpConnectionPtr connection_;
+};
+
+}  // namespace net
+
+}  // namespace mymuduo
@@ -0,0 +1,503 @@
+#include "tcp_connection.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/sendfile.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+#include "channel.h"
+#include "event_loop.h"
+#include "socket.h"
+#include "sockets_ops.h"
+
+namespace mymuduo {
+
+namespace net {
+
+namespace {
+
+// Caps one sendfile call, so a huge range does not starve other connections.
+const size_t kMaxSendFileChunk = 1024 * 1024;
+const size_t kBufferedFileChunk = 64 * 1024;
+
+}  // namespace
+
+void DefaultConnectionCallback(const TcpConnectionPtr& conn) {
+  printf("%s -> %s is %s\n", conn->local_address().ToIpPort().c_str(),
+         conn->peer_address().ToIpPort().c_str(), conn->Connected() ? "UP" : "DOWN");
+}
+
+void DefaultMessageCallback(const TcpConnectionPtr&, Buffer* buffer) {
+  buffer->RetrieveAll();
+}
+
+TcpConnection::TcpConnection(EventLoop* loop, const std::string& name, int sockfd,
+                             const InetAddress& local_addr, const InetAddress& peer_addr)
+    : loop_(loop),
+      name_(name),
+      state_(kConnecting),
+      reading_(true),
+      socket_(new Socket(sockfd)),
+      channel_(new Channel(loop, sockfd)),
+      local_addr_(local_addr),
+      peer_addr_(peer_addr),
+      high_water_mark_(kDefaultHighWaterMark),
+      low_water_mark_(0),
+      above_high_water_mark_(false),
+      read_budget_(0),
+      read_error_(0),
+      peer_closing_(false) {
+  if (loop->SupportsCompletionReads()) {
+    channel_->SetDataCallback([this](const char* data, ssize_t n) { HandleData(data, n); });
+    channel_->SetReadCallback([this]() { HandleCompletedRead(); });
+  } else {
+    channel_->SetReadCallback([this]() { HandleRead(); });
+  }
+  channel_->SetWriteCallback([this]() { HandleWrite(); });
+  channel_->SetCloseCallback([this]() { HandleClose(); });
+  channel_->SetErrorCallback([this]() { HandleError(); });
+  socket_->SetKeepAlive(true);
+}
+
+TcpConnection::~TcpConnection() {
+  assert(state_ == kDisconnected);
+  for (const FileSegment& segment : file_segments_) {
+    ::close(segment.fd);
+  }
+}
+
+void TcpConnection::Send(std::string_view message) {
+  if (state_ != kConnected) {
+    return;
+  }
+  if (loop_->IsInLoopThread()) {
+    SendInLoop(message.data(), message.size());
+  } else {
+    loop_->RunInLoop([self = shared_from_this(), data = std::string(message)]() {
+      self->SendInLoop(data.data(), data.size());
+    });
+  }
+}
+
+void TcpConnection::Send(Buffer* buffer) {
+  if (state_ != kConnected) {
+    return;
+  }
+  if (loop_->IsInLoopThread()) {
+    SendInLoop(buffer->Peek(), buffer->ReadableBytes());
+    buffer->RetrieveAll();
+  } else {
+    loop_->RunInLoop([self = shared_from_this(), data = buffer->RetrieveAllAsString()]() {
+      self->SendInLoop(data.data(), data.size());
+    });
+  }
+}
+
+void TcpConnection::SendInLoop(const void* data, size_t len) {
+  loop_->AssertInLoopThread();
+  if (state_ == kDisconnected) {
+    return;
+  }
+  ssize_t nwrote = 0;
+  size_t remaining = len;
+  bool fault_error = false;
+  // Nothing queued, try the socket first.
+  if (!channel_->IsWriting() && output_buffer_.ReadableBytes() == 0 && file_segments_.empty()) {
+    nwrote = ::write(channel_->fd(), data, len);
+    if (nwrote >= 0) {
+      remaining = len - nwrote;
+      if (remaining == 0 && write_complete_callback_) {
+        loop_->QueueInLoop([self = shared_from_this()]() {
+          self->write_complete_callback_(self);
+        });
+      }
+    } else {
+      nwrote = 0;
+      if (errno != EWOULDBLOCK) {
+        if (errno == EPIPE || errno == ECONNRESET) {
+          fault_error = true;
+        }
+      }
+    }
+  }
+
+  if (fault_error || remaining == 0) {
+    return;
+  }
+  const size_t old_len = BufferedBytes();
+  // Bytes sent after a queued file range wait behind it.
+  Buffer* tail = file_segments_.empty() ? &output_buffer_ : &file_segments_.back().trailer;
+  tail->Append(static_cast<const char*>(data) + nwrote, remaining);
+  if (!channel_->IsWriting()) {
+    channel_->EnableWriting();
+  }
+  if (old_len < high_water_mark_ && old_len + remaining >= high_water_mark_) {
+    above_high_water_mark_ = true;
+    if (high_water_mark_callback_) {
+      high_water_mark_callback_(shared_from_this(), old_len + remaining);
+    }
+  }
+}
+
+void TcpConnection::SendFile(int file_fd, off_t offset, size_t len) {
+  if (state_ != kConnected || len == 0) {
+    return;
+  }
+  if (loop_->IsInLoopThread()) {
+    SendFileInLoop(file_fd, offset, len, false);
+  } else {
+    int owned_fd = ::dup(file_fd);
+    if (owned_fd < 0) {
+      fprintf(stderr, "TcpConnection::SendFile [%s]: dup: %s\n", name_.c_str(), strerror(errno));
+      return;
+    }
+    loop_->RunInLoop([self = shared_from_this(), owned_fd, offset, len]() {
+      self->SendFileInLoop(owned_fd, offset, len, true);
+    });
+  }
+}
+
+void TcpConnection::SendFileInLoop(int file_fd, off_t offset, size_t len, bool owned) {
+  loop_->AssertInLoopThread();
+  if (state_ == kDisconnected) {
+    if (owned) {
+      ::close(file_fd);
+    }
+    return;
+  }
+  // Nothing queued, try the socket first.
+  if (!channel_->IsWriting() && output_buffer_.ReadableBytes() == 0 && file_segments_.empty()) {
+    while (len > 0) {
+      ssize_t n = ::sendfile(channel_->fd(), file_fd, &offset, std::min(len, kMaxSendFileChunk));
+      if (n <= 0) {
+        break;  // would block, or left to WriteOutput to sort out
+      }
+      len -= n;
+    }
+    if (len == 0) {
+      if (owned) {
+        ::close(file_fd);
+      }
+      if (write_complete_callback_) {
+        loop_->QueueInLoop([self = shared_from_this()]() {
+          self->write_complete_callback_(self);
+        });
+      }
+      return;
+    }
+  }
+
+  if (!owned) {
+    file_fd = ::dup(file_fd);
+    if (file_fd < 0) {
+      fprintf(stderr, "TcpConnection::SendFile [%s]: dup: %s\n", name_.c_str(), strerror(errno));
+      return;
+    }
+  }
+  file_segments_.push_back(FileSegment{file_fd, offset, len, false, Buffer()});
+  if (!channel_->IsWriting()) {
+    channel_->EnableWriting();
+  }
+}
+
+size_t TcpConnection::BufferedBytes() const {
+  size_t bytes = output_buffer_.ReadableBytes();
+  for (const FileSegment& segment : file_segments_) {
+    bytes += segment.trailer.ReadableBytes();
+  }
+  return bytes;
+}
+
+void TcpConnection::Shutdown() {
+  State expected = kConnected;
+  if (state_.compare_exchange_strong(expected, kDisconnecting)) {
+    loop_->RunInLoop([self = shared_from_this()]() { self->ShutdownInLoop(); });
+  }
+}
+
+void TcpConnection::ShutdownInLoop() {
+  loop_->AssertInLoopThread();
+  // Otherwise HandleWrite shuts down once the output buffer drains.
+  if (!channel_->IsWriting()) {
+    socket_->ShutdownWrite();
+  }
+}
+
+void TcpConnection::ForceClose() {
+  if (state_ == kConnected || state_ == kDisconnecting) {
+    set_state(kDisconnecting);
+    loop_->QueueInLoop([self = shared_from_this()]() { self->ForceCloseInLoop(); });
+  }
+}
+
+void TcpConnection::ForceCloseInLoop() {
+  loop_->AssertInLoopThread();
+  if (state_ == kConnected || state_ == kDisconnecting) {
+    HandleClose();
+  }
+}
+
+void TcpConnection::SetTcpNoDelay(bool on) {
+  socket_->SetTcpNoDelay(on);
+}
+
+void TcpConnection::SetEdgeTriggered(size_t read_budget) {
+  assert(state_ == kConnecting);
+  read_budget_ = read_budget;
+  channel_->SetEdgeTriggered(read_budget > 0);
+}
+
+void TcpConnection::StartRead() {
+  loop_->RunInLoop([self = shared_from_this()]() { self->StartReadInLoop(); });
+}
+
+void TcpConnection::StartReadInLoop() {
+  loop_->AssertInLoopThread();
+  if (!reading_ || !channel_->IsReading()) {
+    channel_->EnableReading();
+    reading_ = true;
+  }
+}
+
+void TcpConnection::StopRead() {
+  loop_->RunInLoop([self = shared_from_this()]() { self->StopReadInLoop(); });
+}
+
+void TcpConnection::StopReadInLoop() {
+  loop_->AssertInLoopThread();
+  if (reading_ || channel_->IsReading()) {
+    channel_->DisableReading();
+    reading_ = false;
+  }
+}
+
+void TcpConnection::ConnectEstablished() {
+  loop_->AssertInLoopThread();
+  assert(state_ == kConnecting);
+  set_state(kConnected);
+  channel_->Tie(shared_from_this());
+  channel_->EnableReading();
+  connection_callback_(shared_from_this());
+}
+
+void TcpConnection::ConnectDestroyed() {
+  loop_->AssertInLoopThread();
+  // Shut down but not closed yet: its server is going away first.
+  if (state_ == kConnected || state_ == kDisconnecting) {
+    set_state(kDisconnected);
+    channel_->DisableAll();
+    connection_callback_(shared_from_this());
+  }
+  channel_->Remove();
+}
+
+void TcpConnection::HandleRead() {
+  loop_->AssertInLoopThread();
+  if (read_budget_ > 0) {
+    HandleReadUntilAgain();
+    return;
+  }
+  int saved_errno = 0;
+  ssize_t n = input_buffer_.ReadFd(channel_->fd(), &saved_errno);
+  if (n > 0) {
+    message_callback_(shared_from_this(), &input_buffer_);
+  } else if (n == 0) {
+    HandleClose();
+  } else {
+    errno = saved_errno;
+    HandleError();
+  }
+}
+
+void TcpConnection::HandleReadUntilAgain() {
+  size_t total = 0;
+  bool closed = false;
+  if (channel_->revents() & (EPOLLRDHUP | EPOLLHUP)) {
+    peer_closing_ = true;
+  }
+  while (total < read_budget_) {
+    int saved_errno = 0;
+    const size_t capacity = input_buffer_.ReadFdCapacity();
+    ssize_t n = input_buffer_.ReadFd(channel_->fd(), &saved_errno);
+    if (n > 0) {
+      total += n;
+      // A short read drained the socket, skip the read that would
+      // only return EAGAIN. Data arriving later raises a new edge, but
+      // once the peer has shut down there is an EOF left to read.
+      if (static_cast<size_t>(n) < capacity && !peer_closing_) {
+        break;
+      }
+    } else if (n == 0) {
+      closed = true;
+      break;
+    } else {
+      if (saved_errno != EAGAIN && saved_errno != EINTR) {
+        errno = saved_errno;
+        HandleError();
+      }
+      if (saved_errno != EINTR) {
+        break;
+      }
+    }
+  }
+  if (total > 0) {
+    message_callback_(shared_from_this(), &input_buffer_);
+  }
+  if (closed) {
+    if (state_ == kConnected || state_ == kDisconnecting) {
+      HandleClose();
+    }
+  } else if (total >= read_budget_ && channel_->IsReading()) {
+    // Not drained, no new edge will come for what is left.
+    loop_->RequeueReadable(channel_.get());
+  }
+}
+
+void TcpConnection::HandleData(const char* data, ssize_t n) {
+  loop_->AssertInLoopThread();
+  if (state_ == kDisconnected) {
+    return;  // completed before the recv was cancelled
+  }
+  if (n > 0) {
+    input_buffer_.Append(data, n);
+  } else if (read_error_ == 0) {
+    read_error_ = n == 0 ? -1 : static_cast<int>(-n);
+  }
+}
+
+void TcpConnection::HandleCompletedRead() {
+  loop_->AssertInLoopThread();
+  if (state_ == kDisconnected) {
+    return;
+  }
+  if (input_buffer_.ReadableBytes() > 0) {
+    message_callback_(shared_from_this(), &input_buffer_);
+  }
+  if (read_error_ != 0 && (state_ == kConnected || state_ == kDisconnecting)) {
+    if (read_error_ > 0) {
+      errno = read_error_;
+      HandleError();
+    }
+    // The recv is not re-armed after EOF or an error.
+    HandleClose();
+  }
+}
+
+void TcpConnection::HandleWrite() {
+  loop_->AssertInLoopThread();
+  if (!channel_->IsWriting()) {
+    return;
+  }
+  WriteOutput();
+  const size_t remaining = BufferedBytes();
+  if (above_high_water_mark_ && remaining <= low_water_mark_) {
+    above_high_water_mark_ = false;
+    if (low_water_mark_callback_) {
+      low_water_mark_callback_(shared_from_this(), remaining);
+    }
+  }
+  // The low water mark callback may have queued more.
+  if (output_buffer_.ReadableBytes() == 0 && file_segments_.empty()) {
+    channel_->DisableWriting();
+    if (write_complete_callback_) {
+      loop_->QueueInLoop([self = shared_from_this()]() {
+        self->write_complete_callback_(self);
+      });
+    }
+    if (state_ == kDisconnecting) {
+      ShutdownInLoop();
+    }
+  }
+}
+
+void TcpConnection::WriteOutput() {
+  for (;;) {
+    if (output_buffer_.ReadableBytes() > 0) {
+      ssize_t n = ::write(channel_->fd(), output_buffer_.Peek(), output_buffer_.ReadableBytes());
+      if (n < 0) {
+        if (errno != EWOULDBLOCK) {
+          fprintf(stderr, "TcpConnection::HandleWrite [%s]: %s\n", name_.c_str(), strerror(errno));
+        }
+        return;
+      }
+      output_buffer_.Retrieve(n);
+      if (output_buffer_.ReadableBytes() > 0) {
+        return;
+      }
+    }
+    if (file_segments_.empty() || !SendFileSegment()) {
+      return;
+    }
+  }
+}
+
+bool TcpConnection::SendFileSegment() {
+  FileSegment& segment = file_segments_.front();
+  bool more = true;
+  if (!segment.buffered) {
+    const size_t chunk = std::min(segment.remaining, kMaxSendFileChunk);
+    ssize_t n = ::sendfile(channel_->fd(), segment.fd, &segment.offset, chunk);
+    if (n > 0) {
+      segment.remaining -= n;
+      more = static_cast<size_t>(n) == chunk;
+    } else if (n == 0) {
+      segment.remaining = 0;  // the file is shorter than promised
+    } else if (errno == EAGAIN) {
+      return false;
+    } else if (errno == EINVAL || errno == ENOSYS || errno == ESPIPE) {
+      segment.buffered = true;
+    } else {
+      fprintf(stderr, "TcpConnection::SendFile [%s]: %s\n", name_.c_str(), strerror(errno));
+      segment.remaining = 0;
+    }
+  } else {
+    const size_t chunk = std::min(segment.remaining, kBufferedFileChunk);
+    output_buffer_.EnsureWritableBytes(chunk);
+    ssize_t n = ::pread(segment.fd, output_buffer_.BeginWrite(), chunk, segment.offset);
+    if (n < 0 && errno == ESPIPE) {
+      n = ::read(segment.fd, output_buffer_.BeginWrite(), chunk);
+    }
+    if (n > 0) {
+      output_buffer_.HasWritten(n);
+      segment.offset += n;
+      segment.remaining -= n;
+    } else {
+      if (n < 0) {
+        fprintf(stderr, "TcpConnection::SendFile [%s]: %s\n", name_.c_str(), strerror(errno));
+      }
+      segment.remaining = 0;
+    }
+  }
+
+  if (segment.remaining == 0) {
+    ::close(segment.fd);
+    output_buffer_.Append(segment.trailer.ToStringView());
+    file_segments_.pop_front();
+  }
+  return more;
+}
+
+void TcpConnection::HandleClose() {
+  loop_->AssertInLoopThread();
+  assert(state_ == kConnected || state_ == kDisconnecting);
+  set_state(kDisconnected);
+  channel_->DisableAll();
+
+  TcpConnectionPtr guard(shared_from_this());
+  connection_callback_(guard);
+  // Must be the last line, it drops the owner's reference.
+  close_callback_(guard);
+}
+
+void TcpConnection::HandleError() {
+  int err = sockets::GetSocketError(channel_->fd());
+  fprintf(stderr, "TcpConnection::HandleError [%s]: %s\n", name_.c_str(), strerror(err));
+}
+
+}  // namespace net
+
+}  // namespace mymuduo
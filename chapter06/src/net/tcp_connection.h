@@ -0,0 +1,177 @@
+#pragma once
+
+#include <stddef.h>
+#include <sys/types.h>
+
+#include <any>
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <string>
+#include <string_view>
+
+#include "buffer.h"
+#include "callbacks.h"
+#include "inet_address.h"
+
+namespace mymuduo {
+
+namespace net {
+
+class Channel;
+class EventLoop;
+class Socket;
+
+// A TCP connection, for both the server and the client side.
+//
+// Always held by shared_ptr: the server (or client) keeps one reference in
+// its connection map until the connection closes, the channel is tied to
+// it with a weak_ptr so it survives its own event handling, and users who
+// keep connections around should hold a weak_ptr the way chapter01's
+// StockFactory does. Send, Shutdown and ForceClose are thread safe, the
+// rest is called in the loop thread.
+//
+// Output backpressure: Send writes directly to the socket when nothing is
+// queued, and buffers only what the kernel does not take. When the buffered
+// bytes cross the high water mark the HighWaterMarkCallback runs, when they
+// drain back to the low water mark the LowWaterMarkCallback runs, so a fast
+// producer can pause (e.g. StopRead on its source) instead of growing the
+// buffer without bound.
+//
+// SendFile queues a byte range of a file behind whatever was sent before it
+// and hands it to sendfile(2), so the bytes never pass through user space.
+// Only Send buffers count toward the water marks, file ranges take no memory.
+class TcpConnection : public std::enable_shared_from_this<TcpConnection> {
+ public:
+  static constexpr size_t kDefaultHighWaterMark = 64 * 1024 * 1024;
+
+  TcpConnection(EventLoop* loop, const std::string& name, int sockfd,
+                const InetAddress& local_addr, const InetAddress& peer_addr);
+  ~TcpConnection();
+
+  TcpConnection(const TcpConnection&) = delete;
+  TcpConnection& operator=(const TcpConnection&) = delete;
+
+  EventLoop* GetLoop() const { return loop_; }
+  const std::string& name() const { return name_; }
+  const InetAddress& local_address() const { return local_addr_; }
+  const InetAddress& peer_address() const { return peer_addr_; }
+  bool Connected() const { return state_ == kConnected; }
+  bool Disconnected() const { return state_ == kDisconnected; }
+
+  void Send(std::string_view message);
+  // Takes the readable bytes of buffer.
+  void Send(Buffer* buffer);
+  // Sends len bytes of file_fd starting at offset, ordered with Send.
+  // file_fd is dup'ed when the range cannot go out at once, so the caller
+  // may close it as soon as SendFile returns. Falls back to pread and
+  // buffered writes when the file does not support sendfile.
+  void SendFile(int file_fd, off_t offset, size_t len);
+  // Closes the write half once the output buffer is flushed.
+  void Shutdown();
+  void ForceClose();
+  void SetTcpNoDelay(bool on);
+
+  // Registers the socket edge triggered, before ConnectEstablished.
+  // Every readable event then reads until EAGAIN, but at most read_budget
+  // bytes; the rest waits for the next iteration (EventLoop::RequeueReadable)
+  // so a streaming peer cannot starve the other connections of the loop.
+  void SetEdgeTriggered(size_t read_budget);
+
+  // Pauses and resumes reading from the socket, for flow control.
+  void StartRead();
+  void StopRead();
+  bool IsReading() const { return reading_; }
+
+  void SetContext(const std::any& context) { context_ = context; }
+  const std::any& GetContext() const { return context_; }
+  std::any* GetMutableContext() { return &context_; }
+
+  void SetConnectionCallback(const ConnectionCallback& cb) { connection_callback_ = cb; }
+  void SetMessageCallback(const MessageCallback& cb) { message_callback_ = cb; }
+  void SetWriteCompleteCallback(const WriteCompleteCallback& cb) { write_complete_callback_ = cb; }
+  // Both water mark callbacks run in the loop thread, right when the mark is
+  // crossed, with the buffered bytes at that moment.
+  void SetHighWaterMarkCallback(const HighWaterMarkCallback& cb, size_t high_water_mark) {
+    high_water_mark_callback_ = cb;
+    high_water_mark_ = high_water_mark;
+  }
+  void SetLowWaterMarkCallback(const LowWaterMarkCallback& cb, size_t low_water_mark) {
+    low_water_mark_callback_ = cb;
+    low_water_mark_ = low_water_mark;
+  }
+
+  Buffer* input_buffer() { return &input_buffer_; }
+  Buffer* output_buffer() { return &output_buffer_; }
+
+  // Internal use only.
+  void SetCloseCallback(const CloseCallback& cb) { close_callback_ = cb; }
+  void ConnectEstablished();
+  void ConnectDestroyed();
+
+ private:
+  enum State { kDisconnected, kConnecting, kConnected, kDisconnecting };
+
+  // A queued SendFile range, plus what was Sent after it.
+  struct FileSegment {
+    int fd;  // owned
+    off_t offset;
+    size_t remaining;
+    bool buffered;  // sendfile unsupported, pread into output_buffer_
+    Buffer trailer;
+  };
+
+  void HandleRead();
+  void HandleReadUntilAgain();
+  void HandleData(const char* data, ssize_t n);
+  void HandleCompletedRead();
+  void HandleWrite();
+  void HandleClose();
+  void HandleError();
+
+  void SendInLoop(const void* data, size_t len);
+  void SendFileInLoop(int file_fd, off_t offset, size_t len, bool owned);
+  // Writes queued output until the socket would block.
+  void WriteOutput();
+  // Moves the front file segment along, returns false when the socket is full.
+  bool SendFileSegment();
+  size_t BufferedBytes() const;
+  void ShutdownInLoop();
+  void ForceCloseInLoop();
+  void StartReadInLoop();
+  void StopReadInLoop();
+
+  void set_state(State state) { state_ = state; }
+
+ private:
+  EventLoop* loop_;
+  const std::string name_;
+  std::atomic<State> state_;
+  bool reading_;
+  std::unique_ptr<Socket> socket_;
+  std::unique_ptr<Channel> channel_;
+  const InetAddress local_addr_;
+  const InetAddress peer_addr_;
+
+  ConnectionCallback connection_callback_;
+  MessageCallback message_callback_;
+  WriteCompleteCallback write_complete_callback_;
+  HighWaterMarkCallback high_water_mark_callback_;
+  LowWaterMarkCallback low_water_mark_callback_;
+  CloseCallback close_callback_;
+  size_t high_water_mark_;
+  size_t low_water_mark_;
+  bool above_high_water_mark_;
+  size_t read_budget_;  // 0: level triggered, one read per event
+  int read_error_;      // completion reads: 0, or -1 after EOF, or an errno
+  bool peer_closing_;   // edge triggered: EPOLLRDHUP seen, read to EOF
+
+  Buffer input_buffer_;
+  Buffer output_buffer_;
+  std::deque<FileSegment> file_segments_;
+  std::any context_;
+};
+
+}  // namespace net
+
+}  // namespace mymuduo
@@ -0,0 +1,105 @@
+#include "tcp_server.h"
+
+#include <assert.h>
+#include <stdio.h>
+
+#include "acceptor.h"
+#include "event_loop.h"
+#include "sockets_ops.h"
+#include "tcp_connection.h"
+
+namespace mymuduo {
+
+namespace net {
+
+TcpServer::TcpServer(EventLoop* loop, const InetAddress& listen_addr, const std::string& name,
+                     Option option)
+    : loop_(loop),
+      ip_port_(listen_addr.ToIpPort()),
+      name_(name),
+      acceptor_(new Acceptor(loop, listen_addr, option == kReusePort)),
+      connection_callback_(DefaultConnectionCallback),
+      message_callback_(DefaultMessageCallback),
+      started_(false),
+      next_conn_id_(1),
+      read_budget_(0) {
+  acceptor_->SetNewConnectionCallback([this](int sockfd, const InetAddress& peer_addr) {
+    NewConnection(sockfd, peer_addr);
+  });
+}
+
+TcpServer::TcpServer(EventLoop* loop, int listen_fd, const std::string& name)
+    : loop_(loop),
+      ip_port_(InetAddress(sockets::GetLocalAddr(listen_fd)).ToIpPort()),
+      name_(name),
+      acceptor_(new Acceptor(loop, listen_fd)),
+      connection_callback_(DefaultConnectionCallback),
+      message_callback_(DefaultMessageCallback),
+      started_(false),
+      next_conn_id_(1),
+      read_budget_(0) {
+  acceptor_->SetNewConnectionCallback([this](int sockfd, const InetAddress& peer_addr) {
+    NewConnection(sockfd, peer_addr);
+  });
+}
+
+TcpServer::~TcpServer() {
+  loop_->AssertInLoopThread();
+  for (auto& item : connections_) {
+    TcpConnectionPtr conn(item.second);
+    item.second.reset();
+    conn->GetLoop()->RunInLoop([conn]() { conn->ConnectDestroyed(); });
+  }
+}
+
+InetAddress TcpServer::listen_address() const {
+  return InetAddress(sockets::GetLocalAddr(acceptor_->fd()));
+}
+
+void TcpServer::SetEdgeTriggered(size_t read_budget) {
+  read_budget_ = read_budget;
+  acceptor_->SetEdgeTriggered(read_budget > 0);
+}
+
+void TcpServer::SetExclusiveAccept(bool on) {
+  acceptor_->SetExclusive(on);
+}
+
+void TcpServer::Start() {
+  if (!started_.exchange(true)) {
+    loop_->RunInLoop([this]() { acceptor_->Listen(); });
+  }
+}
+
+void TcpServer::NewConnection(int sockfd, const InetAddress& peer_addr) {
+  loop_->AssertInLoopThread();
+  std::string conn_name = name_ + "-" + ip_port_ + "#" + std::to_string(next_conn_id_++);
+  InetAddress local_addr(sockets::GetLocalAddr(sockfd));
+  auto conn = std::make_shared<TcpConnection>(loop_, conn_name, sockfd, local_addr, peer_addr);
+  connections_[conn_name] = conn;
+  conn->SetConnectionCallback(connection_callback_);
+  conn->SetMessageCallback(message_callback_);
+  conn->SetWriteCompleteCallback(write_complete_callback_);
+  conn->SetCloseCallback([this](const TcpConnectionPtr& conn) { RemoveConnection(conn); });
+  if (read_budget_ > 0) {
+    conn->SetEdgeTriggered(read_budget_);
+  }
+  conn->ConnectEstablished();
+}
+
+void TcpServer::RemoveConnection(const TcpConnectionPtr& conn) {
+  loop_->RunInLoop([this, conn]() { RemoveConnectionInLoop(conn); });
+}
+
+void TcpServer::RemoveConnectionInLoop(const TcpConnectionPtr& conn) {
+  loop_->AssertInLoopThread();
+  size_t n = connections_.erase(conn->name());
+  assert(n == 1);
+  (void) n;
+  // The channel is still handling this event, destroy it afterwards.
+  conn->GetLoop()->QueueInLoop([conn]() { conn->ConnectDestroyed(); });
+}
+
+}  // namespace net
+
+}  // namespace mymuduo
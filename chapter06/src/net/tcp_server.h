@@ -0,0 +1,80 @@
+#pragma once
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <string>
+
+#include "callbacks.h"
+#include "inet_address.h"
+
+namespace mymuduo {
+
+namespace net {
+
+class Acceptor;
+class EventLoop;
+
+// Single loop TCP server, accepts and serves every connection in the loop
+// it was created with. It owns its connections until they close.
+class TcpServer {
+ public:
+  enum Option { kNoReusePort, kReusePort };
+
+  TcpServer(EventLoop* loop, const InetAddress& listen_addr, const std::string& name,
+            Option option = kNoReusePort);
+  // Serves a socket bound elsewhere and owns it from now on, see
+  // PreforkServer.
+  TcpServer(EventLoop* loop, int listen_fd, const std::string& name);
+  ~TcpServer();
+
+  TcpServer(const TcpServer&) = delete;
+  TcpServer& operator=(const TcpServer&) = delete;
+
+  const std::string& name() const { return name_; }
+  const std::string& ip_port() const { return ip_port_; }
+  EventLoop* GetLoop() const { return loop_; }
+  // The bound address, tells the port picked when listening on port 0.
+  InetAddress listen_address() const;
+
+  // Starts listening, thread safe and idempotent.
+  void Start();
+
+  // Not thread safe, set them before Start.
+  void SetConnectionCallback(const ConnectionCallback& cb) { connection_callback_ = cb; }
+  void SetMessageCallback(const MessageCallback& cb) { message_callback_ = cb; }
+  void SetWriteCompleteCallback(const WriteCompleteCallback& cb) { write_complete_callback_ = cb; }
+
+  // Registers the listener and every connection edge triggered, see
+  // TcpConnection::SetEdgeTriggered. Set before Start.
+  void SetEdgeTriggered(size_t read_budget = kDefaultReadBudget);
+  // EPOLLEXCLUSIVE on the listener, for a listening fd shared across loops.
+  void SetExclusiveAccept(bool on);
+
+  static constexpr size_t kDefaultReadBudget = 256 * 1024;
+
+ private:
+  void NewConnection(int sockfd, const InetAddress& peer_addr);
+  // Thread safe.
+  void RemoveConnection(const TcpConnectionPtr& conn);
+  void RemoveConnectionInLoop(const TcpConnectionPtr& conn);
+
+ private:
+  using ConnectionMap = std::map<std::string, TcpConnectionPtr>;
+
+  EventLoop* loop_;
+  const std::string ip_port_;
+  const std::string name_;
+  std::unique_ptr<Acceptor> acceptor_;
+  ConnectionCallback connection_callback_;
+  MessageCallback message_callback_;
+  WriteCompleteCallback write_complete_callback_;
+  std::atomic<bool> started_;
+  int next_conn_id_;
+  size_t read_budget_;  // 0: level triggered
+  ConnectionMap connections_;
+};
+
+}  // namespace net
+
+}  // namespace mymuduo
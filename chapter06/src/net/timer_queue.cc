@@ -0,0 +1,135 @@
+#include "timer_queue.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/timerfd.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <vector>
+
+#include "channel.h"
+#include "event_loop.h"
+
+namespace mymuduo {
+
+namespace net {
+
+namespace {
+
+int CreateTimerFd() {
+  int timerfd = ::timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+  if (timerfd < 0) {
+    fprintf(stderr, "TimerQueue: timerfd_create: %s\n", strerror(errno));
+    abort();
+  }
+  return timerfd;
+}
+
+}  // namespace
+
+TimerQueue::TimerQueue(EventLoop* loop)
+    : loop_(loop),
+      timerfd_(CreateTimerFd()),
+      timerfd_channel_(new Channel(loop, timerfd_)),
+      next_id_(1),
+      armed_at_(0) {
+  timerfd_channel_->SetReadCallback([this]() { HandleRead(); });
+  timerfd_channel_->EnableReading();
+}
+
+TimerQueue::~TimerQueue() {
+  timerfd_channel_->DisableAll();
+  timerfd_channel_->Remove();
+  ::close(timerfd_);
+}
+
+int64_t TimerQueue::Now() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<int64_t>(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+}
+
+TimerId TimerQueue::AddTimer(TimerCallback cb, int64_t when, int64_t interval_us) {
+  loop_->AssertInLoopThread();
+  TimerId id = next_id_++;
+  timers_[id] = Timer{std::move(cb), when, interval_us};
+  queue_.insert({when, id});
+  if (armed_at_ == 0 || when < armed_at_) {
+    ResetTimerFd();
+  }
+  return id;
+}
+
+void TimerQueue::Cancel(TimerId id) {
+  loop_->AssertInLoopThread();
+  auto it = timers_.find(id);
+  if (it == timers_.end()) {
+    return;
+  }
+  // The timerfd may still fire for it, HandleRead then just re-arms.
+  queue_.erase({it->second.when, id});
+  timers_.erase(it);
+}
+
+void TimerQueue::HandleRead() {
+  uint64_t expirations = 0;
+  ssize_t n = ::read(timerfd_, &expirations, sizeof(expirations));
+  (void) n;
+  armed_at_ = 0;
+
+  const int64_t now = Now();
+  std::vector<TimerId> expired;
+  while (!queue_.empty() && queue_.begin()->first <= now) {
+    expired.push_back(queue_.begin()->second);
+    queue_.erase(queue_.begin());
+  }
+  for (TimerId id : expired) {
+    // An earlier callback may have cancelled it.
+    auto it = timers_.find(id);
+    if (it == timers_.end()) {
+      continue;
+    }
+    if (it->second.interval_us <= 0) {
+      TimerCallback cb(std::move(it->second.cb));
+      timers_.erase(it);
+      cb();
+      continue;
+    }
+    TimerCallback cb(it->second.cb);  // survives a Cancel from inside cb
+    cb();
+    it = timers_.find(id);
+    if (it != timers_.end()) {
+      it->second.when = now + it->second.interval_us;
+      queue_.insert({it->second.when, id});
+    }
+  }
+  ResetTimerFd();
+}
+
+void TimerQueue::ResetTimerFd() {
+  struct itimerspec spec;
+  memset(&spec, 0, sizeof(spec));
+  if (!queue_.empty()) {
+    const int64_t when = queue_.begin()->first;
+    if (when == armed_at_) {
+      return;
+    }
+    spec.it_value.tv_sec = when / 1000000;
+    spec.it_value.tv_nsec = (when % 1000000) * 1000 + 1;  // 0 would disarm
+    armed_at_ = when;
+  } else if (armed_at_ == 0) {
+    return;
+  } else {
+    armed_at_ = 0;
+  }
+  if (::timerfd_settime(timerfd_, TFD_TIMER_ABSTIME, &spec, nullptr) < 0) {
+    fprintf(stderr, "TimerQueue: timerfd_settime: %s\n", strerror(errno));
+  }
+}
+
+}  // namespace net
+
+}  // namespace mymuduo
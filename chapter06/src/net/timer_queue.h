@@ -0,0 +1,63 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <functional>
+#include <memory>
+#include <set>
+#include <unordered_map>
+#include <utility>
+
+namespace mymuduo {
+
+namespace net {
+
+class Channel;
+class EventLoop;
+
+using TimerId = uint64_t;
+
+// Timers of one loop, on a timerfd that is always set to the earliest
+// expiration, so a loop with timers still blocks in a single poll.
+// Times are microseconds of CLOCK_MONOTONIC. Loop thread only, go through
+// EventLoop::RunAt/RunAfter/RunEvery/Cancel.
+class TimerQueue {
+ public:
+  using TimerCallback = std::function<void()>;
+
+  explicit TimerQueue(EventLoop* loop);
+  ~TimerQueue();
+
+  TimerQueue(const TimerQueue&) = delete;
+  TimerQueue& operator=(const TimerQueue&) = delete;
+
+  // Runs cb at when, then every interval_us if it is positive.
+  TimerId AddTimer(TimerCallback cb, int64_t when, int64_t interval_us);
+  // Cancelling a timer that already ran, or the one running, is fine.
+  void Cancel(TimerId id);
+
+  static int64_t Now();
+
+ private:
+  struct Timer {
+    TimerCallback cb;
+    int64_t when;
+    int64_t interval_us;
+  };
+
+  void HandleRead();
+  void ResetTimerFd();
+
+ private:
+  EventLoop* loop_;
+  const int timerfd_;
+  std::unique_ptr<Channel> timerfd_channel_;
+  TimerId next_id_;
+  int64_t armed_at_;  // expiration the timerfd is set to, 0 if disarmed
+  std::set<std::pair<int64_t, TimerId>> queue_;  // by expiration
+  std::unordered_map<TimerId, Timer> timers_;
+};
+
+}  // namespace net
+
+}  // namespace mymuduo